@@ -0,0 +1,418 @@
+// Copyright 2017-2019 Elias Kosunen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// This file is a part of picorange:
+//     https://github.com/eliaskosunen/picorange
+
+// Compile-time benchmarks for the concept emulation.
+//
+// Usage:
+//     picorange-compile-bench [--std=c++11] [--counts=0,10,100,500]
+//                             [--runs=3] [--flags="..."] [--keep]
+//
+// For every N in --counts, a translation unit is generated that defines N
+// distinct iterator and range types (cycling through the input, forward,
+// bidirectional, random access and contiguous categories, sized and unsized)
+// and pushes each of them through the picorange traits: range, sized_range,
+// contiguous_range, view, forwarding_range, sentinel_for,
+// sized_sentinel_for, bidirectional_iterator, random_access_iterator,
+// iterator_t, range_difference_t and subrange.
+//
+// The TU is compiled with the same compiler CMake uses for picorange, and
+// the best wall time out of --runs, the peak resident memory of the compiler
+// (POSIX only) and, with Clang, the number of template instantiations
+// (counted from -ftime-trace) are reported as CSV.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define PICORANGE_BENCH_POSIX 1
+#else
+#define PICORANGE_BENCH_POSIX 0
+#endif
+
+#ifndef PICORANGE_BENCH_CXX
+#define PICORANGE_BENCH_CXX "c++"
+#endif
+#ifndef PICORANGE_BENCH_CXX_ID
+#define PICORANGE_BENCH_CXX_ID ""
+#endif
+#ifndef PICORANGE_BENCH_INCLUDE_DIR
+#define PICORANGE_BENCH_INCLUDE_DIR "."
+#endif
+#ifndef PICORANGE_BENCH_WORK_DIR
+#define PICORANGE_BENCH_WORK_DIR "."
+#endif
+
+namespace {
+    struct options {
+        std::string std{"c++11"};
+        std::vector<unsigned> counts{0, 10, 100, 500};
+        unsigned runs{3};
+        std::vector<std::string> flags{};
+        bool keep{false};
+    };
+
+    std::vector<std::string> split(const std::string& str, char delim)
+    {
+        std::vector<std::string> result;
+        std::istringstream iss{str};
+        std::string item;
+        while (std::getline(iss, item, delim)) {
+            if (!item.empty()) {
+                result.push_back(item);
+            }
+        }
+        return result;
+    }
+
+    bool parse_option(const char* arg,
+                      const char* name,
+                      std::string& value)
+    {
+        const auto len = std::strlen(name);
+        if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') {
+            return false;
+        }
+        value = arg + len + 1;
+        return true;
+    }
+
+    options parse_options(int argc, char** argv)
+    {
+        options opt{};
+        for (int i = 1; i < argc; ++i) {
+            std::string value;
+            if (parse_option(argv[i], "--std", value)) {
+                opt.std = value;
+            }
+            else if (parse_option(argv[i], "--counts", value)) {
+                opt.counts.clear();
+                for (const auto& c : split(value, ',')) {
+                    opt.counts.push_back(static_cast<unsigned>(
+                        std::strtoul(c.c_str(), nullptr, 10)));
+                }
+            }
+            else if (parse_option(argv[i], "--runs", value)) {
+                opt.runs = std::max(
+                    1u, static_cast<unsigned>(
+                            std::strtoul(value.c_str(), nullptr, 10)));
+            }
+            else if (parse_option(argv[i], "--flags", value)) {
+                opt.flags = split(value, ' ');
+            }
+            else if (std::strcmp(argv[i], "--keep") == 0) {
+                opt.keep = true;
+            }
+            else {
+                std::fprintf(stderr,
+                             "usage: %s [--std=c++11] [--counts=0,10,100,500] "
+                             "[--runs=3] [--flags=\"...\"] [--keep]\n",
+                             argv[0]);
+                std::exit(EXIT_FAILURE);
+            }
+        }
+        return opt;
+    }
+
+    bool is_clang()
+    {
+        return std::strstr(PICORANGE_BENCH_CXX_ID, "Clang") != nullptr;
+    }
+
+    enum class category { input, forward, bidirectional, random, contiguous };
+
+    void write_iterator(std::ostream& os, unsigned k, category cat)
+    {
+        static const char* const tags[] = {
+            "std::input_iterator_tag", "std::forward_iterator_tag",
+            "std::bidirectional_iterator_tag",
+            "std::random_access_iterator_tag",
+            "std::random_access_iterator_tag"};
+        const auto at_least = [cat](category c) { return cat >= c; };
+
+        os << "    struct it_" << k << " {\n"
+           << "        using value_type = int;\n"
+           << "        using difference_type = std::ptrdiff_t;\n"
+           << "        using reference = int&;\n"
+           << "        using pointer = int*;\n"
+           << "        using iterator_category = "
+           << tags[static_cast<int>(cat)] << ";\n"
+           << "        int* p;\n"
+           << "        int& operator*() const { return *p; }\n"
+           << "        it_" << k << "& operator++() { ++p; return *this; }\n"
+           << "        it_" << k << " operator++(int) { auto t = *this; ++p; "
+           << "return t; }\n"
+           << "        friend bool operator==(const it_" << k
+           << "& a, const it_" << k << "& b) { return a.p == b.p; }\n"
+           << "        friend bool operator!=(const it_" << k
+           << "& a, const it_" << k << "& b) { return a.p != b.p; }\n";
+        if (at_least(category::bidirectional)) {
+            os << "        it_" << k << "& operator--() { --p; return *this; }\n"
+               << "        it_" << k << " operator--(int) { auto t = *this; "
+               << "--p; return t; }\n";
+        }
+        if (at_least(category::random)) {
+            os << "        it_" << k << "& operator+=(std::ptrdiff_t n) { "
+               << "p += n; return *this; }\n"
+               << "        it_" << k << "& operator-=(std::ptrdiff_t n) { "
+               << "p -= n; return *this; }\n"
+               << "        int& operator[](std::ptrdiff_t n) const { "
+               << "return p[n]; }\n"
+               << "        friend it_" << k << " operator+(it_" << k
+               << " i, std::ptrdiff_t n) { i.p += n; return i; }\n"
+               << "        friend it_" << k << " operator+(std::ptrdiff_t n, "
+               << "it_" << k << " i) { i.p += n; return i; }\n"
+               << "        friend it_" << k << " operator-(it_" << k
+               << " i, std::ptrdiff_t n) { i.p -= n; return i; }\n"
+               << "        friend std::ptrdiff_t operator-(const it_" << k
+               << "& a, const it_" << k << "& b) { return a.p - b.p; }\n";
+            for (const char* op : {"<", ">", "<=", ">="}) {
+                os << "        friend bool operator" << op << "(const it_" << k
+                   << "& a, const it_" << k << "& b) { return a.p " << op
+                   << " b.p; }\n";
+            }
+        }
+        os << "    };\n";
+    }
+
+    void write_range(std::ostream& os, unsigned k, category cat, bool sized)
+    {
+        os << "    struct range_" << k << " {\n"
+           << "        int* b{nullptr};\n"
+           << "        int* e{nullptr};\n"
+           << "        it_" << k << " begin() const { return it_" << k
+           << "{b}; }\n"
+           << "        it_" << k << " end() const { return it_" << k
+           << "{e}; }\n";
+        if (sized) {
+            os << "        std::size_t size() const { "
+               << "return static_cast<std::size_t>(e - b); }\n";
+        }
+        if (cat == category::contiguous) {
+            os << "        int* data() const { return b; }\n";
+        }
+        os << "    };\n";
+    }
+
+    void write_checks(std::ostream& os, unsigned k)
+    {
+        const auto it = "gen::it_" + std::to_string(k);
+        const auto rng = "gen::range_" + std::to_string(k);
+
+        os << "static_assert(picorange::range<" << rng << ">::value, \"\");\n"
+           << "constexpr bool check_" << k << "[] = {\n"
+           << "    picorange::sized_range<" << rng << ">::value,\n"
+           << "    picorange::contiguous_range<" << rng << ">::value,\n"
+           << "    picorange::view<" << rng << ">::value,\n"
+           << "    picorange::forwarding_range<" << rng << ">::value,\n"
+           << "    picorange::sentinel_for<" << it << ", " << it
+           << ">::value,\n"
+           << "    picorange::sized_sentinel_for<" << it << ", " << it
+           << ">::value,\n"
+           << "    picorange::bidirectional_iterator<" << it << ">::value,\n"
+           << "    picorange::random_access_iterator<" << it << ">::value,\n"
+           << "    std::is_same<picorange::iterator_t<" << rng << ">, " << it
+           << ">::value,\n"
+           << "    sizeof(picorange::range_difference_t<" << rng
+           << ">) != 0,\n"
+           << "    sizeof(picorange::subrange<" << it << ">) != 0,\n"
+           << "};\n";
+    }
+
+    void write_tu(const std::string& path, unsigned count)
+    {
+        static const category categories[] = {
+            category::input, category::forward, category::bidirectional,
+            category::random, category::contiguous};
+
+        std::ofstream os{path};
+        os << "// Generated by picorange-compile-bench\n"
+           << "#include <picorange/picorange.h>\n\n"
+           << "#include <cstddef>\n"
+           << "#include <iterator>\n\n"
+           << "namespace gen {\n";
+        for (unsigned k = 0; k < count; ++k) {
+            const auto cat = categories[k % 5];
+            write_iterator(os, k, cat);
+            write_range(os, k, cat, (k / 5) % 2 == 0);
+        }
+        os << "}  // namespace gen\n\n";
+        for (unsigned k = 0; k < count; ++k) {
+            write_checks(os, k);
+        }
+    }
+
+    struct measurement {
+        double seconds{0.0};
+        long peak_kib{-1};
+        bool ok{false};
+    };
+
+    measurement run_command(const std::vector<std::string>& args)
+    {
+        measurement m{};
+        const auto start = std::chrono::steady_clock::now();
+#if PICORANGE_BENCH_POSIX
+        std::vector<char*> argv;
+        for (const auto& a : args) {
+            argv.push_back(const_cast<char*>(a.c_str()));
+        }
+        argv.push_back(nullptr);
+
+        const pid_t pid = fork();
+        if (pid == 0) {
+            execvp(argv[0], argv.data());
+            _exit(127);
+        }
+        if (pid < 0) {
+            return m;
+        }
+        int status = 0;
+        struct rusage usage {};
+        if (wait4(pid, &status, 0, &usage) < 0) {
+            return m;
+        }
+        m.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#if defined(__APPLE__)
+        // ru_maxrss is in bytes on macOS
+        m.peak_kib = static_cast<long>(usage.ru_maxrss / 1024);
+#else
+        m.peak_kib = static_cast<long>(usage.ru_maxrss);
+#endif
+#else
+        std::string cmd;
+        for (const auto& a : args) {
+            cmd += '"' + a + "\" ";
+        }
+        m.ok = std::system(cmd.c_str()) == 0;
+#endif
+        const auto stop = std::chrono::steady_clock::now();
+        m.seconds = std::chrono::duration<double>(stop - start).count();
+        return m;
+    }
+
+    long count_substr(const std::string& haystack, const std::string& needle)
+    {
+        long n = 0;
+        for (auto pos = haystack.find(needle); pos != std::string::npos;
+             pos = haystack.find(needle, pos + needle.size())) {
+            ++n;
+        }
+        return n;
+    }
+
+    // Counts InstantiateClass and InstantiateFunction events in a Clang
+    // -ftime-trace file, or returns -1 if there isn't one
+    long count_instantiations(const std::string& trace_path)
+    {
+        std::ifstream is{trace_path};
+        if (!is) {
+            return -1;
+        }
+        const std::string trace{std::istreambuf_iterator<char>{is},
+                                std::istreambuf_iterator<char>{}};
+        return count_substr(trace, "\"name\":\"InstantiateClass\"") +
+               count_substr(trace, "\"name\":\"InstantiateFunction\"");
+    }
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    const auto opt = parse_options(argc, argv);
+    const std::string work_dir = PICORANGE_BENCH_WORK_DIR;
+
+    std::printf("compiler: %s (%s), -std=%s\n", PICORANGE_BENCH_CXX,
+                PICORANGE_BENCH_CXX_ID, opt.std.c_str());
+    std::printf("types,seconds,delta_seconds,peak_mib,instantiations\n");
+
+    double baseline = -1.0;
+    for (const auto count : opt.counts) {
+        const auto stem =
+            work_dir + "/picorange-compile-bench-" + std::to_string(count);
+        const auto source = stem + ".cpp";
+        const auto object = stem + ".o";
+        write_tu(source, count);
+
+        std::vector<std::string> args{PICORANGE_BENCH_CXX, "-std=" + opt.std,
+                                      "-I", PICORANGE_BENCH_INCLUDE_DIR};
+        args.insert(args.end(), opt.flags.begin(), opt.flags.end());
+        if (is_clang()) {
+            // -ftime-trace needs an object file to write its output next to
+            args.insert(args.end(), {"-ftime-trace",
+                                     "-ftime-trace-granularity=0", "-c",
+                                     source, "-o", object});
+        }
+        else {
+            args.insert(args.end(), {"-fsyntax-only", source});
+        }
+
+        measurement best{};
+        for (unsigned run = 0; run < opt.runs; ++run) {
+            const auto m = run_command(args);
+            if (!m.ok) {
+                std::fprintf(stderr, "compilation of %s failed\n",
+                             source.c_str());
+                return EXIT_FAILURE;
+            }
+            if (!best.ok || m.seconds < best.seconds) {
+                best.seconds = m.seconds;
+                best.ok = true;
+            }
+            best.peak_kib = std::max(best.peak_kib, m.peak_kib);
+        }
+        if (baseline < 0.0) {
+            baseline = best.seconds;
+        }
+
+        const long instantiations =
+            is_clang() ? count_instantiations(stem + ".json") : -1;
+
+        std::printf("%u,%.3f,%.3f,", count, best.seconds,
+                    best.seconds - baseline);
+        if (best.peak_kib >= 0) {
+            std::printf("%.1f,", static_cast<double>(best.peak_kib) / 1024.0);
+        }
+        else {
+            std::printf("-,");
+        }
+        if (instantiations >= 0) {
+            std::printf("%ld\n", instantiations);
+        }
+        else {
+            std::printf("-\n");
+        }
+        std::fflush(stdout);
+
+        if (!opt.keep) {
+            std::remove(source.c_str());
+            std::remove(object.c_str());
+            std::remove((stem + ".json").c_str());
+        }
+    }
+}
@@ -0,0 +1,578 @@
+// Copyright 2017-2019 Elias Kosunen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// This file is a part of picorange:
+//     https://github.com/eliaskosunen/picorange
+
+// Runtime microbenchmarks for the customization point objects and the
+// iterator algorithms.
+//
+// Usage:
+//     picorange-bench [--max-bytes=N] [--max-node-bytes=N]
+//                     [--min-time-ms=N] [--filter=SUBSTR]
+//
+// Every operation is measured over every range kind at sizes from 8 bytes to
+// --max-bytes (default 1 GiB), growing by a factor of 8. Node-based
+// containers allocate a lot more than one byte per element, so they are
+// capped separately by --max-node-bytes (default 16 MiB).
+// Output is one CSV row per measurement: operation, range, bytes, ns/op.
+
+#include <picorange/algorithm.h>
+#include <picorange/parallel.h>
+#include <picorange/views.h>
+#include <picorange/picorange.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <forward_list>
+#include <list>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+    // Optimization barriers
+#if defined(__GNUC__) || defined(__clang__)
+    template <typename T>
+    inline void do_not_optimize(T const& value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+    inline void clobber_memory()
+    {
+        asm volatile("" : : : "memory");
+    }
+#else
+    volatile const void* g_sink;
+
+    template <typename T>
+    inline void do_not_optimize(T const& value)
+    {
+        g_sink = &value;
+    }
+    inline void clobber_memory()
+    {
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    }
+#endif
+
+    struct options {
+        std::uint64_t max_bytes{std::uint64_t{1} << 30};
+        std::uint64_t max_node_bytes{std::uint64_t{1} << 24};
+        double min_time{0.05};
+        std::string filter{};
+    };
+
+    bool parse_option(const char* arg,
+                      const char* name,
+                      std::string& value)
+    {
+        const auto len = std::strlen(name);
+        if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') {
+            return false;
+        }
+        value = arg + len + 1;
+        return true;
+    }
+
+    options parse_options(int argc, char** argv)
+    {
+        options opt{};
+        for (int i = 1; i < argc; ++i) {
+            std::string value;
+            if (parse_option(argv[i], "--max-bytes", value)) {
+                opt.max_bytes = std::strtoull(value.c_str(), nullptr, 10);
+            }
+            else if (parse_option(argv[i], "--max-node-bytes", value)) {
+                opt.max_node_bytes =
+                    std::strtoull(value.c_str(), nullptr, 10);
+            }
+            else if (parse_option(argv[i], "--min-time-ms", value)) {
+                opt.min_time = std::strtod(value.c_str(), nullptr) / 1000.0;
+            }
+            else if (parse_option(argv[i], "--filter", value)) {
+                opt.filter = value;
+            }
+            else {
+                std::fprintf(stderr,
+                             "usage: %s [--max-bytes=N] [--max-node-bytes=N] "
+                             "[--min-time-ms=N] [--filter=SUBSTR]\n",
+                             argv[0]);
+                std::exit(EXIT_FAILURE);
+            }
+        }
+        return opt;
+    }
+
+    using clock_type = std::chrono::steady_clock;
+
+    template <typename F>
+    double time_once(F& f, std::uint64_t iterations)
+    {
+        const auto start = clock_type::now();
+        f(iterations);
+        const auto stop = clock_type::now();
+        return std::chrono::duration<double>(stop - start).count();
+    }
+
+    // Returns the best observed time per call to f, in nanoseconds.
+    // f(n) is expected to perform the operation n times.
+    template <typename F>
+    double measure(const options& opt, F f)
+    {
+        std::uint64_t iterations = 1;
+        double elapsed = time_once(f, iterations);
+        while (elapsed < opt.min_time &&
+               iterations < (std::uint64_t{1} << 40)) {
+            const double factor =
+                elapsed <= 0.0
+                    ? 10.0
+                    : std::min(10.0,
+                               std::max(2.0, opt.min_time / elapsed * 1.2));
+            iterations = static_cast<std::uint64_t>(
+                static_cast<double>(iterations) * factor);
+            elapsed = time_once(f, iterations);
+        }
+
+        double best = elapsed;
+        for (int rep = 0; rep < 2; ++rep) {
+            best = std::min(best, time_once(f, iterations));
+        }
+        return best / static_cast<double>(iterations) * 1e9;
+    }
+
+    class runner {
+    public:
+        runner(const options& opt, const char* range_name, std::uint64_t bytes)
+            : m_opt(opt), m_range(range_name), m_bytes(bytes)
+        {
+        }
+
+        template <typename F>
+        void run(const char* op, F f) const
+        {
+            if (!m_opt.filter.empty()) {
+                const auto label = std::string{op} + ' ' + m_range;
+                if (label.find(m_opt.filter) == std::string::npos) {
+                    return;
+                }
+            }
+            const double ns = measure(m_opt, f);
+            std::printf("%s,%s,%llu,%.3f\n", op, m_range,
+                        static_cast<unsigned long long>(m_bytes), ns);
+            std::fflush(stdout);
+        }
+
+    private:
+        const options& m_opt;
+        const char* m_range;
+        std::uint64_t m_bytes;
+    };
+
+    // An iterator that only models input_iterator, over contiguous storage
+    template <typename T>
+    class input_iterator {
+    public:
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using reference = const T&;
+        using pointer = const T*;
+        using iterator_category = std::input_iterator_tag;
+
+        input_iterator() = default;
+        explicit input_iterator(const T* p) : m_ptr(p) {}
+
+        reference operator*() const
+        {
+            return *m_ptr;
+        }
+
+        input_iterator& operator++()
+        {
+            ++m_ptr;
+            return *this;
+        }
+        input_iterator operator++(int)
+        {
+            auto tmp = *this;
+            ++m_ptr;
+            return tmp;
+        }
+
+        friend bool operator==(const input_iterator& a, const input_iterator& b)
+        {
+            return a.m_ptr == b.m_ptr;
+        }
+        friend bool operator!=(const input_iterator& a, const input_iterator& b)
+        {
+            return !(a == b);
+        }
+
+    private:
+        const T* m_ptr{nullptr};
+    };
+
+    template <typename T>
+    class input_range {
+    public:
+        input_range(const T* b, const T* e) : m_begin(b), m_end(e) {}
+
+        input_iterator<T> begin() const
+        {
+            return input_iterator<T>{m_begin};
+        }
+        input_iterator<T> end() const
+        {
+            return input_iterator<T>{m_end};
+        }
+
+    private:
+        const T* m_begin;
+        const T* m_end;
+    };
+
+    using value_type = unsigned char;
+
+    template <typename Range>
+    void bench_size(const runner& run, Range& r, std::true_type)
+    {
+        run.run("size", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                clobber_memory();
+                do_not_optimize(picorange::size(r));
+            }
+        });
+    }
+    template <typename Range>
+    void bench_size(const runner&, Range&, std::false_type)
+    {
+    }
+
+    template <typename Range>
+    void bench_data(const runner& run, Range& r, std::true_type)
+    {
+        run.run("data", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                clobber_memory();
+                do_not_optimize(picorange::data(r));
+            }
+        });
+    }
+    template <typename Range>
+    void bench_data(const runner&, Range&, std::false_type)
+    {
+    }
+
+    // Elements are all zero, so these find no delimiters
+    template <typename Range>
+    void bench_split(const runner& run, Range& r, std::true_type)
+    {
+        run.run("split(c)", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                clobber_memory();
+                auto parts = r | picorange::views::split(value_type{','});
+                do_not_optimize(picorange::begin(parts));
+            }
+        });
+        const value_type crlf[] = {'\r', '\n'};
+        run.run("split(str)", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                clobber_memory();
+                auto parts = r | picorange::views::split(crlf);
+                do_not_optimize(picorange::begin(parts));
+            }
+        });
+        run.run("is_valid_utf8", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                clobber_memory();
+                do_not_optimize(picorange::is_valid_utf8(r));
+            }
+        });
+        run.run("lines", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                clobber_memory();
+                std::size_t count = 0;
+                for (auto line : r | picorange::views::lines) {
+                    count += line.size();
+                }
+                do_not_optimize(count);
+            }
+        });
+    }
+    template <typename Range>
+    void bench_split(const runner&, Range&, std::false_type)
+    {
+    }
+
+    // std::ranges::empty needs a forward range
+    template <typename Range>
+    using empty_t = decltype(picorange::empty(std::declval<Range&>()));
+
+    template <typename Range>
+    void bench_empty(const runner& run, Range& r, std::true_type)
+    {
+        run.run("empty", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                clobber_memory();
+                do_not_optimize(picorange::empty(r));
+            }
+        });
+    }
+    template <typename Range>
+    void bench_empty(const runner&, Range&, std::false_type)
+    {
+    }
+
+    // Like the serial versions below, these scan the whole range
+    template <typename Range>
+    void bench_parallel(const runner& run, Range& r, std::true_type)
+    {
+        run.run("par::find_if", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                clobber_memory();
+                do_not_optimize(picorange::par::find_if(
+                    r, [](unsigned char c) { return c == '\n' || c == ','; }));
+            }
+        });
+        run.run("par::count_if", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                clobber_memory();
+                do_not_optimize(picorange::par::count_if(
+                    r, [](unsigned char c) { return c == '\n' || c == ','; }));
+            }
+        });
+        run.run("par::reduce", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                clobber_memory();
+                do_not_optimize(picorange::par::reduce(r, 0u));
+            }
+        });
+    }
+    template <typename Range>
+    void bench_parallel(const runner&, Range&, std::false_type)
+    {
+    }
+
+    template <typename Range>
+    void bench_range(const runner& run, Range& r)
+    {
+        using iterator = picorange::iterator_t<Range>;
+        using difference_type = picorange::iter_difference_t<iterator>;
+
+        const auto count = picorange::distance(r);
+
+        run.run("begin", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                clobber_memory();
+                do_not_optimize(picorange::begin(r));
+            }
+        });
+        run.run("end", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                clobber_memory();
+                do_not_optimize(picorange::end(r));
+            }
+        });
+        bench_size(run, r, picorange::sized_range<Range>{});
+        bench_data(run, r, picorange::contiguous_range<Range>{});
+        bench_split(
+            run, r,
+            std::integral_constant<
+                bool, picorange::contiguous_range<Range>::value &&
+                          picorange::sized_range<Range>::value>{});
+        bench_empty(run, r, picorange::exists<empty_t, Range>{});
+        bench_parallel(
+            run, r,
+            std::integral_constant<
+                bool, picorange::random_access_iterator<iterator>::value &&
+                          picorange::sized_range<Range>::value>{});
+
+        run.run("advance(i, n)", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                auto it = picorange::begin(r);
+                picorange::advance(it, count);
+                do_not_optimize(it);
+            }
+        });
+        run.run("advance(i, bound)", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                auto it = picorange::begin(r);
+                picorange::advance(it, picorange::end(r));
+                do_not_optimize(it);
+            }
+        });
+        run.run("advance(i, n, bound)", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                auto it = picorange::begin(r);
+                difference_type left = picorange::advance(
+                    it, count + difference_type{1}, picorange::end(r));
+                do_not_optimize(it);
+                do_not_optimize(left);
+            }
+        });
+        run.run("distance(i, s)", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                clobber_memory();
+                do_not_optimize(
+                    picorange::distance(picorange::begin(r), picorange::end(r)));
+            }
+        });
+        run.run("distance(r)", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                clobber_memory();
+                do_not_optimize(picorange::distance(r));
+            }
+        });
+
+        // Elements are all zero, so these scan the whole range
+        run.run("find", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                clobber_memory();
+                do_not_optimize(picorange::find(r, 1));
+            }
+        });
+        run.run("find_if", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                clobber_memory();
+                do_not_optimize(picorange::find_if(
+                    r, [](unsigned char c) { return c == '\n' || c == ','; }));
+            }
+        });
+        // One virtual call per batch, instead of per element
+        run.run("any_input_view", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                clobber_memory();
+                picorange::any_input_view<picorange::range_value_t<Range>> v{r};
+                unsigned sum = 0;
+                for (auto it = v.begin(); it != v.end(); ++it) {
+                    sum += *it;
+                }
+                do_not_optimize(sum);
+            }
+        });
+        const picorange::char_set delimiters{",;\n\""};
+        run.run("find_first_of", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                clobber_memory();
+                do_not_optimize(picorange::find_first_of(r, delimiters));
+            }
+        });
+        run.run("count", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                clobber_memory();
+                do_not_optimize(picorange::count(r, 1));
+            }
+        });
+        run.run("count_if", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                clobber_memory();
+                do_not_optimize(picorange::count_if(
+                    r, [](unsigned char c) { return c == '\n' || c == ','; }));
+            }
+        });
+        run.run("byte_histogram", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                clobber_memory();
+                do_not_optimize(picorange::byte_histogram(r));
+            }
+        });
+
+        std::vector<value_type> out(static_cast<std::size_t>(count));
+        run.run("copy", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                clobber_memory();
+                do_not_optimize(picorange::copy(r, out.data()).out);
+            }
+        });
+        run.run("equal", [&](std::uint64_t n) {
+            for (std::uint64_t k = 0; k < n; ++k) {
+                clobber_memory();
+                do_not_optimize(picorange::equal(r, out));
+            }
+        });
+    }
+
+    void bench_contiguous(const options& opt, std::uint64_t bytes)
+    {
+        std::vector<value_type> vec(static_cast<std::size_t>(bytes));
+
+        auto ptrs = picorange::subrange<value_type*>{
+            vec.data(), vec.data() + vec.size()};
+        bench_range(runner{opt, "pointer", bytes}, ptrs);
+        bench_range(runner{opt, "std::vector", bytes}, vec);
+
+        auto input = input_range<value_type>{vec.data(),
+                                             vec.data() + vec.size()};
+        bench_range(runner{opt, "input_iterator", bytes}, input);
+    }
+
+    void bench_deque(const options& opt, std::uint64_t bytes)
+    {
+        std::deque<value_type> deq(static_cast<std::size_t>(bytes));
+        bench_range(runner{opt, "std::deque", bytes}, deq);
+    }
+
+    void bench_node(const options& opt, std::uint64_t bytes)
+    {
+        const auto count = static_cast<std::size_t>(bytes);
+
+        std::list<value_type> list(count);
+        bench_range(runner{opt, "std::list", bytes}, list);
+
+        using list_iterator = std::list<value_type>::iterator;
+        auto sized = picorange::subrange<list_iterator, list_iterator,
+                                         picorange::subrange_kind::sized>(
+            list.begin(), list.end(), static_cast<std::ptrdiff_t>(count));
+        bench_range(runner{opt, "subrange(sized)", bytes}, sized);
+
+        auto unsized =
+            picorange::subrange<list_iterator>{list.begin(), list.end()};
+        bench_range(runner{opt, "subrange(unsized)", bytes}, unsized);
+
+        std::forward_list<value_type> flist(count);
+        bench_range(runner{opt, "std::forward_list", bytes}, flist);
+    }
+
+    template <typename F>
+    void try_run(F f, const char* what, std::uint64_t bytes)
+    {
+        try {
+            f();
+        }
+        catch (const std::bad_alloc&) {
+            std::fprintf(stderr, "skipping %s at %llu bytes: out of memory\n",
+                         what, static_cast<unsigned long long>(bytes));
+        }
+    }
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    const auto opt = parse_options(argc, argv);
+
+    std::printf("operation,range,bytes,ns/op\n");
+    for (std::uint64_t bytes = 8; bytes <= opt.max_bytes; bytes *= 8) {
+        try_run([&] { bench_contiguous(opt, bytes); }, "contiguous", bytes);
+        try_run([&] { bench_deque(opt, bytes); }, "std::deque", bytes);
+        if (bytes <= opt.max_node_bytes) {
+            try_run([&] { bench_node(opt, bytes); }, "node-based", bytes);
+        }
+    }
+}
@@ -0,0 +1,1920 @@
+// Copyright 2017-2019 Elias Kosunen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// This file is a part of picorange:
+//     https://github.com/eliaskosunen/picorange
+
+#ifndef PICORANGE_ALGORITHM_H
+#define PICORANGE_ALGORITHM_H
+
+#include "picorange.h"
+#include "simd.h"
+
+#include <array>
+#include <cstring>
+
+#if PICORANGE_STD_RANGES
+#include <algorithm>
+#endif
+
+namespace picorange {
+    PICORANGE_BEGIN_NAMESPACE
+
+    namespace detail {
+        // One-byte types, for which equality is bitwise equality
+        template <typename T>
+        struct is_byte_like
+            : std::integral_constant<
+                  bool,
+                  sizeof(T) == 1 &&
+                      ((std::is_integral<T>::value &&
+                        !std::is_same<typename std::remove_cv<T>::type,
+                                      bool>::value) ||
+                       std::is_enum<T>::value)> {
+        };
+
+        // Contiguous byte sequences, which can be handed over to the kernels
+        // in simd.h
+        template <typename I, typename S, typename = void>
+        struct is_byte_iterator_pair : std::false_type {
+        };
+        template <typename I, typename S>
+        struct is_byte_iterator_pair<
+            I,
+            S,
+            typename std::enable_if<
+                is_lowerable_to_pointers<I, S>::value>::type>
+            : is_byte_like<iter_value_t<I>> {
+        };
+
+        template <typename E, typename T, typename = void>
+        struct is_byte_comparable : std::false_type {
+        };
+        template <typename E, typename T>
+        struct is_byte_comparable<
+            E,
+            T,
+            typename std::enable_if<is_byte_like<E>::value>::type>
+            : std::integral_constant<
+                  bool,
+                  (std::is_integral<E>::value && std::is_integral<T>::value &&
+                   !std::is_same<T, bool>::value) ||
+                      std::is_same<typename std::remove_cv<E>::type,
+                                   T>::value> {
+        };
+
+        template <typename I>
+        const unsigned char* to_byte_pointer(const I& i) noexcept
+        {
+            return reinterpret_cast<const unsigned char*>(
+                ::picorange::to_address(i));
+        }
+
+        // find_if on contiguous bytes evaluates pred once per byte value,
+        // and scans with a table lookup. Below this length, that's more
+        // expensive than just calling pred on every element.
+        // Complexity requirements allow it for lengths >= 256.
+        constexpr std::ptrdiff_t find_if_table_threshold = 1024;
+
+        // [I, S) is a range of segmented iterators with contiguous segments,
+        // which can be handed over to the contiguous code paths one by one
+        template <typename I, typename S, typename = void>
+        struct is_segmented_contiguous_pair : std::false_type {
+        };
+        template <typename I, typename S>
+        struct is_segmented_contiguous_pair<
+            I,
+            S,
+            typename std::enable_if<is_segmented_iterator<I>::value>::type>
+            : std::integral_constant<
+                  bool,
+                  std::is_same<I, S>::value &&
+                      contiguous_iterator<local_iterator_t<I>>::value> {
+        };
+
+        // Calls f(first, last) on the local range of every segment in
+        // [first, last), until f returns something other than last.
+        template <typename I, typename F>
+        I segmented_find(I first, const I& last, F f)
+        {
+            using traits = segmented_iterator_traits<I>;
+
+            if (first == last) {
+                return first;
+            }
+            auto seg = traits::segment(first);
+            const auto last_seg = traits::segment(last);
+            if (seg == last_seg) {
+                return traits::compose(
+                    seg, f(traits::local(first), traits::local(last)));
+            }
+            auto seg_end = traits::end(seg);
+            auto r = f(traits::local(first), seg_end);
+            if (r != seg_end) {
+                return traits::compose(seg, r);
+            }
+            for (++seg; seg != last_seg; ++seg) {
+                seg_end = traits::end(seg);
+                r = f(traits::begin(seg), seg_end);
+                if (r != seg_end) {
+                    return traits::compose(seg, r);
+                }
+            }
+            return traits::compose(
+                last_seg, f(traits::begin(last_seg), traits::local(last)));
+        }
+
+        // Calls f(first, last) on the local range of every segment in
+        // [first, last)
+        template <typename I, typename F>
+        void segmented_for_each(const I& first, const I& last, F f)
+        {
+            segmented_find(first, last,
+                           [&f](local_iterator_t<I> b, local_iterator_t<I> e)
+                               -> local_iterator_t<I> {
+                               f(b, e);
+                               return e;
+                           });
+        }
+    }  // namespace detail
+
+    // find
+    namespace _find {
+        struct fn {
+        private:
+            template <typename I,
+                      typename S,
+                      typename T,
+                      typename std::enable_if<
+                          detail::is_segmented_contiguous_pair<I, S>::value>::
+                          type* = nullptr>
+            static I impl(I first, S last, const T& value, priority_tag<2>)
+            {
+                using local = detail::local_iterator_t<I>;
+                return detail::segmented_find(
+                    std::move(first), last, [&value](local b, local e) {
+                        return fn::impl(b, e, value, priority_tag<1>{});
+                    });
+            }
+
+            template <typename I,
+                      typename S,
+                      typename T,
+                      typename std::enable_if<
+                          detail::is_byte_iterator_pair<I, S>::value &&
+                          detail::is_byte_comparable<iter_value_t<I>, T>::
+                              value>::type* = nullptr>
+            static I impl(I first, S last, const T& value, priority_tag<1>)
+            {
+                using value_type = iter_value_t<I>;
+
+                const auto n = last - first;
+                const auto b = static_cast<value_type>(value);
+                if (!(b == value)) {
+                    // Not representable, can't be in the range
+                    return first + n;
+                }
+                unsigned char byte;
+                std::memcpy(&byte, &b, 1);
+
+                const auto p = detail::to_byte_pointer(first);
+                const auto r = detail::simd::find_byte(p, p + n, byte);
+                return first + static_cast<iter_difference_t<I>>(r - p);
+            }
+
+            // C strings: strchr stops at either the value or the terminator,
+            // so the length isn't needed up front
+            template <typename I,
+                      typename S,
+                      typename T,
+                      typename std::enable_if<
+                          detail::is_null_terminated_string<I, S>::value &&
+                          sizeof(iter_value_t<I>) == 1 &&
+                          detail::is_byte_comparable<iter_value_t<I>, T>::
+                              value>::type* = nullptr>
+            static I impl(I first, S, const T& value, priority_tag<1>)
+            {
+                using value_type =
+                    typename std::remove_cv<iter_value_t<I>>::type;
+
+                const auto p = reinterpret_cast<const char*>(
+                    ::picorange::to_address(first));
+                const char* r = nullptr;
+                const auto b = static_cast<value_type>(value);
+                if (b == value) {
+                    char c;
+                    std::memcpy(&c, &b, 1);
+                    r = std::strchr(p, c);
+                }
+                if (!r) {
+                    r = p + std::strlen(p);
+                }
+                return first + static_cast<iter_difference_t<I>>(r - p);
+            }
+
+            template <typename I, typename S, typename T>
+            static PICORANGE_CONSTEXPR14 I impl(I first,
+                                                S last,
+                                                const T& value,
+                                                priority_tag<0>)
+            {
+                for (; first != last; ++first) {
+                    if (*first == value) {
+                        break;
+                    }
+                }
+                return first;
+            }
+
+        public:
+            template <typename I,
+                      typename S,
+                      typename T,
+                      typename std::enable_if<
+                          sentinel_for<S, I>::value>::type* = nullptr>
+            PICORANGE_CONSTEXPR14 I operator()(I first,
+                                               S last,
+                                               const T& value) const
+            {
+                return fn::impl(std::move(first), std::move(last), value,
+                                priority_tag<2>{});
+            }
+
+            template <typename R,
+                      typename T,
+                      typename std::enable_if<range<R>::value>::type* =
+                          nullptr>
+            PICORANGE_CONSTEXPR14 iterator_t<R> operator()(R&& r,
+                                                           const T& value) const
+            {
+                return fn::impl(::picorange::begin(r), ::picorange::end(r),
+                                value, priority_tag<2>{});
+            }
+        };
+    }  // namespace _find
+    namespace {
+        constexpr auto& find = static_const<_find::fn>::value;
+    }
+
+    // find_if
+    namespace _find_if {
+        struct fn {
+        private:
+            // The byte table is built once for all segments
+            template <typename I,
+                      typename S,
+                      typename Pred,
+                      typename std::enable_if<
+                          detail::is_segmented_contiguous_pair<I, S>::value &&
+                          detail::is_byte_like<iter_value_t<I>>::value>::type* =
+                          nullptr>
+            static I impl(I first, S last, Pred& pred, priority_tag<3>)
+            {
+                using local = detail::local_iterator_t<I>;
+                using value_type = iter_value_t<I>;
+
+                if (::picorange::distance(first, last) <
+                    detail::find_if_table_threshold) {
+                    return fn::impl(std::move(first), std::move(last), pred,
+                                    priority_tag<2>{});
+                }
+
+                auto classify = [&pred](unsigned char c) -> bool {
+                    value_type v;
+                    std::memcpy(&v, &c, 1);
+                    return static_cast<bool>(pred(v));
+                };
+                const auto set = detail::simd::make_byte_set(classify);
+
+                return detail::segmented_find(
+                    std::move(first), last, [&set](local b, local e) -> local {
+                        const auto p = detail::to_byte_pointer(b);
+                        const auto r =
+                            detail::simd::find_in_set(p, p + (e - b), set);
+                        return b + (r - p);
+                    });
+            }
+
+            template <typename I,
+                      typename S,
+                      typename Pred,
+                      typename std::enable_if<
+                          detail::is_segmented_contiguous_pair<I, S>::value>::
+                          type* = nullptr>
+            static I impl(I first, S last, Pred& pred, priority_tag<2>)
+            {
+                using local = detail::local_iterator_t<I>;
+                return detail::segmented_find(
+                    std::move(first), last, [&pred](local b, local e) {
+                        return fn::impl(b, e, pred, priority_tag<0>{});
+                    });
+            }
+
+            template <typename I,
+                      typename S,
+                      typename Pred,
+                      typename std::enable_if<
+                          detail::is_byte_iterator_pair<I, S>::value>::type* =
+                          nullptr>
+            static I impl(I first, S last, Pred& pred, priority_tag<1>)
+            {
+                using value_type = iter_value_t<I>;
+
+                const auto n = last - first;
+                if (n < detail::find_if_table_threshold) {
+                    return fn::impl(std::move(first), std::move(last), pred,
+                                    priority_tag<0>{});
+                }
+
+                auto classify = [&pred](unsigned char c) -> bool {
+                    value_type v;
+                    std::memcpy(&v, &c, 1);
+                    return static_cast<bool>(pred(v));
+                };
+                const auto set = detail::simd::make_byte_set(classify);
+
+                const auto p = detail::to_byte_pointer(first);
+                const auto r = detail::simd::find_in_set(p, p + n, set);
+                return first + static_cast<iter_difference_t<I>>(r - p);
+            }
+
+            template <typename I, typename S, typename Pred>
+            static PICORANGE_CONSTEXPR14 I impl(I first,
+                                                S last,
+                                                Pred& pred,
+                                                priority_tag<0>)
+            {
+                for (; first != last; ++first) {
+                    if (pred(*first)) {
+                        break;
+                    }
+                }
+                return first;
+            }
+
+        public:
+            // Like in C++20, pred must be equality preserving:
+            // it may be called with values not in the range.
+            template <typename I,
+                      typename S,
+                      typename Pred,
+                      typename std::enable_if<
+                          sentinel_for<S, I>::value>::type* = nullptr>
+            PICORANGE_CONSTEXPR14 I operator()(I first, S last, Pred pred) const
+            {
+                return fn::impl(std::move(first), std::move(last), pred,
+                                priority_tag<3>{});
+            }
+
+            template <typename R,
+                      typename Pred,
+                      typename std::enable_if<range<R>::value>::type* =
+                          nullptr>
+            PICORANGE_CONSTEXPR14 iterator_t<R> operator()(R&& r,
+                                                           Pred pred) const
+            {
+                return fn::impl(::picorange::begin(r), ::picorange::end(r),
+                                pred, priority_tag<3>{});
+            }
+        };
+    }  // namespace _find_if
+    namespace {
+        constexpr auto& find_if = static_const<_find_if::fn>::value;
+    }
+
+    // char_set: a set of byte values, for find_first_of, find_first_not_of
+    // and skip_while_in.
+    // Since C++14, it can be built at compile time.
+    class char_set {
+    public:
+        constexpr char_set() noexcept : m_set{} {}
+
+        // The chars of a string literal, without its null terminator
+        template <std::size_t N>
+        PICORANGE_CONSTEXPR14 explicit char_set(const char (&chars)[N]) noexcept
+            : m_set{}
+        {
+            for (std::size_t i = 0; i + 1 < N; ++i) {
+                insert(chars[i]);
+            }
+        }
+
+        // The bytes, for which pred returns true
+        template <typename Pred>
+        static PICORANGE_CONSTEXPR14 char_set from_predicate(Pred pred)
+        {
+            char_set s;
+            for (unsigned c = 0; c < 256; ++c) {
+                if (pred(static_cast<unsigned char>(c))) {
+                    s.insert(static_cast<unsigned char>(c));
+                }
+            }
+            return s;
+        }
+
+        PICORANGE_CONSTEXPR14 void insert(unsigned char c) noexcept
+        {
+            m_set.insert(c);
+        }
+        PICORANGE_CONSTEXPR14 void insert(char c) noexcept
+        {
+            insert(static_cast<unsigned char>(c));
+        }
+
+        constexpr bool contains(unsigned char c) const noexcept
+        {
+            return m_set.contains(c);
+        }
+        constexpr bool contains(char c) const noexcept
+        {
+            return contains(static_cast<unsigned char>(c));
+        }
+
+        // Every byte not in the set
+        PICORANGE_CONSTEXPR14 char_set operator~() const noexcept
+        {
+            char_set s{*this};
+            for (auto& w : s.m_set.bits) {
+                w = ~w;
+            }
+            for (auto& row : s.m_set.nibble_masks) {
+                for (auto& m : row) {
+                    m = static_cast<std::uint8_t>(~m);
+                }
+            }
+            return s;
+        }
+
+        friend PICORANGE_CONSTEXPR14 char_set operator|(char_set a,
+                                                        const char_set& b)
+        {
+            for (std::size_t i = 0; i < 4; ++i) {
+                a.m_set.bits[i] |= b.m_set.bits[i];
+            }
+            for (std::size_t i = 0; i < 2; ++i) {
+                for (std::size_t j = 0; j < 16; ++j) {
+                    a.m_set.nibble_masks[i][j] |= b.m_set.nibble_masks[i][j];
+                }
+            }
+            return a;
+        }
+
+        // The table used by the kernels in simd.h
+        constexpr const detail::simd::byte_set& table() const noexcept
+        {
+            return m_set;
+        }
+
+    private:
+        detail::simd::byte_set m_set;
+    };
+
+    namespace detail {
+        template <typename T>
+        PICORANGE_CONSTEXPR14 bool char_set_contains(const char_set& set,
+                                                     const T& v)
+        {
+            return set.contains(static_cast<unsigned char>(v));
+        }
+
+        // First position of an element in set, or last
+        struct find_in_char_set_fn {
+            template <typename I,
+                      typename S,
+                      typename std::enable_if<
+                          is_segmented_contiguous_pair<I, S>::value>::type* =
+                          nullptr>
+            static I impl(I first, S last, const char_set& set, priority_tag<2>)
+            {
+                using local = local_iterator_t<I>;
+                return segmented_find(
+                    std::move(first), last, [&set](local b, local e) {
+                        return find_in_char_set_fn::impl(b, e, set,
+                                                         priority_tag<1>{});
+                    });
+            }
+
+            template <typename I,
+                      typename S,
+                      typename std::enable_if<
+                          is_byte_iterator_pair<I, S>::value>::type* = nullptr>
+            static I impl(I first, S last, const char_set& set, priority_tag<1>)
+            {
+                const auto p = to_byte_pointer(first);
+                const auto r =
+                    simd::find_in_set(p, p + (last - first), set.table());
+                return first + static_cast<iter_difference_t<I>>(r - p);
+            }
+
+            template <typename I, typename S>
+            static PICORANGE_CONSTEXPR14 I impl(I first,
+                                                S last,
+                                                const char_set& set,
+                                                priority_tag<0>)
+            {
+                for (; first != last; ++first) {
+                    if (char_set_contains(set, *first)) {
+                        break;
+                    }
+                }
+                return first;
+            }
+        };
+
+        template <typename I, typename S>
+        PICORANGE_CONSTEXPR14 I find_in_char_set(I first,
+                                                 S last,
+                                                 const char_set& set)
+        {
+            return find_in_char_set_fn::impl(std::move(first), std::move(last),
+                                             set, priority_tag<2>{});
+        }
+
+        template <typename I>
+        struct is_char_set_iterator : is_byte_like<iter_value_t<I>> {
+        };
+    }  // namespace detail
+
+    // find_first_of: first position of an element in set.
+    // On contiguous bytes, it's found 16 or 32 bytes at a time, with
+    // nibble lookups (pshufb).
+    namespace _find_first_of {
+        struct fn {
+            template <typename I,
+                      typename S,
+                      typename std::enable_if<
+                          sentinel_for<S, I>::value &&
+                          detail::is_char_set_iterator<I>::value>::type* =
+                          nullptr>
+            PICORANGE_CONSTEXPR14 I operator()(I first,
+                                               S last,
+                                               const char_set& set) const
+            {
+                return detail::find_in_char_set(std::move(first),
+                                                std::move(last), set);
+            }
+
+            template <typename R,
+                      typename std::enable_if<
+                          range<R>::value && detail::is_char_set_iterator<
+                                                 iterator_t<R>>::value>::type* =
+                          nullptr>
+            PICORANGE_CONSTEXPR14 iterator_t<R> operator()(
+                R&& r,
+                const char_set& set) const
+            {
+                return detail::find_in_char_set(::picorange::begin(r),
+                                                ::picorange::end(r), set);
+            }
+        };
+    }  // namespace _find_first_of
+    namespace {
+        constexpr auto& find_first_of = static_const<_find_first_of::fn>::value;
+    }
+
+    // find_first_not_of: first position of an element not in set
+    namespace _find_first_not_of {
+        struct fn {
+            template <typename I,
+                      typename S,
+                      typename std::enable_if<
+                          sentinel_for<S, I>::value &&
+                          detail::is_char_set_iterator<I>::value>::type* =
+                          nullptr>
+            PICORANGE_CONSTEXPR14 I operator()(I first,
+                                               S last,
+                                               const char_set& set) const
+            {
+                return detail::find_in_char_set(std::move(first),
+                                                std::move(last), ~set);
+            }
+
+            template <typename R,
+                      typename std::enable_if<
+                          range<R>::value && detail::is_char_set_iterator<
+                                                 iterator_t<R>>::value>::type* =
+                          nullptr>
+            PICORANGE_CONSTEXPR14 iterator_t<R> operator()(
+                R&& r,
+                const char_set& set) const
+            {
+                return detail::find_in_char_set(::picorange::begin(r),
+                                                ::picorange::end(r), ~set);
+            }
+        };
+    }  // namespace _find_first_not_of
+    namespace {
+        constexpr auto& find_first_not_of =
+            static_const<_find_first_not_of::fn>::value;
+    }
+
+    // skip_while_in: the rest of a range, after the elements in set at its
+    // beginning, like whitespace
+    namespace _skip_while_in {
+        struct fn {
+            template <typename I,
+                      typename S,
+                      typename std::enable_if<
+                          sentinel_for<S, I>::value &&
+                          detail::is_char_set_iterator<I>::value>::type* =
+                          nullptr>
+            PICORANGE_CONSTEXPR14 subrange<I, S> operator()(
+                I first,
+                S last,
+                const char_set& set) const
+            {
+                auto it =
+                    detail::find_in_char_set(std::move(first), last, ~set);
+                return {std::move(it), std::move(last)};
+            }
+
+            template <typename R,
+                      typename std::enable_if<
+                          range<R>::value && detail::is_char_set_iterator<
+                                                 iterator_t<R>>::value>::type* =
+                          nullptr>
+            PICORANGE_CONSTEXPR14 subrange<iterator_t<R>, sentinel_t<R>>
+            operator()(R&& r, const char_set& set) const
+            {
+                return (*this)(::picorange::begin(r), ::picorange::end(r), set);
+            }
+        };
+    }  // namespace _skip_while_in
+    namespace {
+        constexpr auto& skip_while_in = static_const<_skip_while_in::fn>::value;
+    }
+
+    // is_valid_utf8: a contiguous range of bytes is well-formed UTF-8.
+    // It's validated 16 or 32 bytes at a time, after Keiser and Lemire.
+    namespace _is_valid_utf8 {
+        struct fn {
+            template <typename I,
+                      typename S,
+                      typename std::enable_if<
+                          detail::is_byte_iterator_pair<I, S>::value>::type* =
+                          nullptr>
+            bool operator()(I first, S last) const
+            {
+                const auto p = detail::to_byte_pointer(first);
+                return detail::simd::validate_utf8(p, p + (last - first));
+            }
+
+            template <typename R,
+                      typename std::enable_if<
+                          detail::is_byte_iterator_pair<iterator_t<R>,
+                                                        sentinel_t<R>>::value>::
+                          type* = nullptr>
+            bool operator()(R&& r) const
+            {
+                return (*this)(::picorange::begin(r), ::picorange::end(r));
+            }
+        };
+    }  // namespace _is_valid_utf8
+    namespace {
+        constexpr auto& is_valid_utf8 = static_const<_is_valid_utf8::fn>::value;
+    }
+
+    // in_out_result
+#if PICORANGE_STD_RANGES
+    using std::ranges::in_out_result;
+#else
+    template <typename I, typename O>
+    struct in_out_result {
+        I in;
+        O out;
+
+        template <typename I2,
+                  typename O2,
+                  typename std::enable_if<
+                      std::is_convertible<const I&, I2>::value &&
+                      std::is_convertible<const O&, O2>::value>::type* =
+                      nullptr>
+        constexpr operator in_out_result<I2, O2>() const&
+        {
+            return {in, out};
+        }
+
+        template <typename I2,
+                  typename O2,
+                  typename std::enable_if<
+                      std::is_convertible<I, I2>::value &&
+                      std::is_convertible<O, O2>::value>::type* = nullptr>
+        PICORANGE_CONSTEXPR14 operator in_out_result<I2, O2>() &&
+        {
+            return {std::move(in), std::move(out)};
+        }
+    };
+#endif
+
+    template <typename I, typename O>
+    using copy_result = in_out_result<I, O>;
+    template <typename I, typename O>
+    using copy_n_result = in_out_result<I, O>;
+    template <typename I, typename O>
+    using copy_backward_result = in_out_result<I, O>;
+
+    namespace detail {
+        // Copying [I, S) to O can be done with memmove
+        template <typename I, typename S, typename O, typename = void>
+        struct is_memmove_copyable : std::false_type {
+        };
+        template <typename I, typename S, typename O>
+        struct is_memmove_copyable<
+            I,
+            S,
+            O,
+            typename std::enable_if<is_lowerable_to_pointers<I, S>::value &&
+                                    contiguous_iterator<O>::value>::type>
+            : std::integral_constant<
+                  bool,
+                  std::is_same<typename std::remove_cv<iter_value_t<I>>::type,
+                               iter_value_t<O>>::value &&
+                      !std::is_const<typename std::remove_reference<
+                          iter_reference_t<O>>::type>::value &&
+                      !std::is_volatile<typename std::remove_reference<
+                          iter_reference_t<O>>::type>::value &&
+                      std::is_trivially_copyable<iter_value_t<O>>::value &&
+                      std::is_trivially_assignable<
+                          iter_value_t<O>&,
+                          const iter_value_t<O>&>::value> {
+        };
+
+        // back_insert_iterator::container is protected
+        template <typename C>
+        struct back_insert_iterator_access : std::back_insert_iterator<C> {
+            static C& get(std::back_insert_iterator<C>& it)
+            {
+                return *(it.*(&back_insert_iterator_access::container));
+            }
+        };
+
+        template <typename C, typename I>
+        using member_range_insert_t = decltype(std::declval<C&>().insert(
+            std::declval<C&>().end(),
+            std::declval<I>(),
+            std::declval<I>()));
+
+        // Copying a sized range of forward iterators to a
+        // back_insert_iterator<C> can be done with a single C::insert
+        template <typename I, typename S, typename O, typename = void>
+        struct is_bulk_insertable : std::false_type {
+        };
+        template <typename I, typename S, typename C>
+        struct is_bulk_insertable<
+            I,
+            S,
+            std::back_insert_iterator<C>,
+            typename std::enable_if<
+                std::is_base_of<forward_iterator_tag,
+                                iterator_category_t<I>>::value>::type>
+            : std::integral_constant<
+                  bool,
+                  sized_sentinel_for<S, I>::value &&
+                      exists<member_range_insert_t, C, I>::value> {
+        };
+
+        template <typename I, typename C>
+        I bulk_insert(I first,
+                      iter_difference_t<I> n,
+                      std::back_insert_iterator<C>& out)
+        {
+            // No reserve(c.size() + n): it would stop the container from
+            // growing geometrically, making many short copies quadratic.
+            // insert() allocates once, if it needs to.
+            auto& c = back_insert_iterator_access<C>::get(out);
+            auto last = first;
+            ::picorange::advance(last, n);
+            c.insert(c.end(), first, last);
+            return last;
+        }
+
+        template <typename I, typename O>
+        O memmove_n(const I& first, iter_difference_t<I> n, O out)
+        {
+            if (n > 0) {
+                std::memmove(::picorange::to_address(out),
+                             ::picorange::to_address(first),
+                             static_cast<std::size_t>(n) *
+                                 sizeof(iter_value_t<O>));
+            }
+            return out + static_cast<iter_difference_t<O>>(n);
+        }
+    }  // namespace detail
+
+    // copy
+    namespace _copy {
+        struct fn {
+        private:
+            template <typename I,
+                      typename S,
+                      typename O,
+                      typename std::enable_if<
+                          detail::is_segmented_contiguous_pair<I, S>::value>::
+                          type* = nullptr>
+            static copy_result<I, O> impl(I first,
+                                          S last,
+                                          O out,
+                                          priority_tag<3>)
+            {
+                using local = detail::local_iterator_t<I>;
+                detail::segmented_for_each(
+                    first, last, [&out](local b, local e) {
+                        out = fn::impl(b, e, std::move(out), priority_tag<2>{})
+                                  .out;
+                    });
+                return {std::move(last), std::move(out)};
+            }
+
+            template <typename I,
+                      typename S,
+                      typename O,
+                      typename std::enable_if<
+                          detail::is_bulk_insertable<I, S, O>::value>::type* =
+                          nullptr>
+            static copy_result<I, O> impl(I first,
+                                          S last,
+                                          O out,
+                                          priority_tag<2>)
+            {
+                const auto n = last - first;
+                auto it = detail::bulk_insert(std::move(first), n, out);
+                return {std::move(it), std::move(out)};
+            }
+
+            template <typename I,
+                      typename S,
+                      typename O,
+                      typename std::enable_if<
+                          detail::is_memmove_copyable<I, S, O>::value>::type* =
+                          nullptr>
+            static copy_result<I, O> impl(I first,
+                                          S last,
+                                          O out,
+                                          priority_tag<1>)
+            {
+                const auto n = last - first;
+                out = detail::memmove_n(first, n, std::move(out));
+                return {first + n, std::move(out)};
+            }
+
+            template <typename I, typename S, typename O>
+            static PICORANGE_CONSTEXPR14 copy_result<I, O> impl(I first,
+                                                                S last,
+                                                                O out,
+                                                                priority_tag<0>)
+            {
+                for (; first != last; ++first, (void)++out) {
+                    *out = *first;
+                }
+                return {std::move(first), std::move(out)};
+            }
+
+        public:
+            template <typename I,
+                      typename S,
+                      typename O,
+                      typename std::enable_if<
+                          sentinel_for<S, I>::value>::type* = nullptr>
+            PICORANGE_CONSTEXPR14 copy_result<I, O> operator()(I first,
+                                                               S last,
+                                                               O out) const
+            {
+                return fn::impl(std::move(first), std::move(last),
+                                std::move(out), priority_tag<3>{});
+            }
+
+            template <typename R,
+                      typename O,
+                      typename std::enable_if<range<R>::value>::type* =
+                          nullptr>
+            PICORANGE_CONSTEXPR14 copy_result<iterator_t<R>, O> operator()(
+                R&& r,
+                O out) const
+            {
+                return fn::impl(::picorange::begin(r), ::picorange::end(r),
+                                std::move(out), priority_tag<3>{});
+            }
+        };
+    }  // namespace _copy
+    namespace {
+        constexpr auto& copy = static_const<_copy::fn>::value;
+    }
+
+    // copy_n
+    namespace _copy_n {
+        struct fn {
+        private:
+            template <typename I,
+                      typename O,
+                      typename std::enable_if<
+                          detail::is_bulk_insertable<I, I, O>::value>::type* =
+                          nullptr>
+            static copy_n_result<I, O> impl(I first,
+                                            iter_difference_t<I> n,
+                                            O out,
+                                            priority_tag<2>)
+            {
+                auto it = detail::bulk_insert(std::move(first), n, out);
+                return {std::move(it), std::move(out)};
+            }
+
+            template <typename I,
+                      typename O,
+                      typename std::enable_if<
+                          detail::is_memmove_copyable<I, I, O>::value>::type* =
+                          nullptr>
+            static copy_n_result<I, O> impl(I first,
+                                            iter_difference_t<I> n,
+                                            O out,
+                                            priority_tag<1>)
+            {
+                out = detail::memmove_n(first, n, std::move(out));
+                return {first + n, std::move(out)};
+            }
+
+            template <typename I, typename O>
+            static PICORANGE_CONSTEXPR14 copy_n_result<I, O>
+            impl(I first, iter_difference_t<I> n, O out, priority_tag<0>)
+            {
+                for (; n > 0; --n, (void)++first, (void)++out) {
+                    *out = *first;
+                }
+                return {std::move(first), std::move(out)};
+            }
+
+        public:
+            // Like in C++20, nothing is copied, if n <= 0
+            template <typename I, typename O>
+            PICORANGE_CONSTEXPR14 copy_n_result<I, O>
+            operator()(I first, iter_difference_t<I> n, O out) const
+            {
+                if (n <= 0) {
+                    return {std::move(first), std::move(out)};
+                }
+                return fn::impl(std::move(first), n, std::move(out),
+                                priority_tag<2>{});
+            }
+        };
+    }  // namespace _copy_n
+    namespace {
+        constexpr auto& copy_n = static_const<_copy_n::fn>::value;
+    }
+
+    // copy_backward
+    namespace _copy_backward {
+        struct fn {
+        private:
+            template <typename I,
+                      typename S,
+                      typename O,
+                      typename std::enable_if<
+                          detail::is_memmove_copyable<I, S, O>::value>::type* =
+                          nullptr>
+            static copy_backward_result<I, O> impl(I first,
+                                                   S last,
+                                                   O out,
+                                                   priority_tag<1>)
+            {
+                const auto n = last - first;
+                out -= static_cast<iter_difference_t<O>>(n);
+                detail::memmove_n(first, n, out);
+                return {first + n, std::move(out)};
+            }
+
+            template <typename I, typename S, typename O>
+            static PICORANGE_CONSTEXPR14 copy_backward_result<I, O>
+            impl(I first, S last, O out, priority_tag<0>)
+            {
+                auto last_it = first;
+                ::picorange::advance(last_it, std::move(last));
+                auto it = last_it;
+                while (it != first) {
+                    *--out = *--it;
+                }
+                return {std::move(last_it), std::move(out)};
+            }
+
+        public:
+            template <typename I,
+                      typename S,
+                      typename O,
+                      typename std::enable_if<
+                          bidirectional_iterator<I>::value &&
+                          sentinel_for<S, I>::value>::type* = nullptr>
+            PICORANGE_CONSTEXPR14 copy_backward_result<I, O>
+            operator()(I first, S last, O out) const
+            {
+                return fn::impl(std::move(first), std::move(last),
+                                std::move(out), priority_tag<1>{});
+            }
+
+            template <typename R,
+                      typename O,
+                      typename std::enable_if<
+                          range<R>::value &&
+                          bidirectional_iterator<iterator_t<R>>::value>::type* =
+                          nullptr>
+            PICORANGE_CONSTEXPR14 copy_backward_result<iterator_t<R>, O>
+            operator()(R&& r, O out) const
+            {
+                return fn::impl(::picorange::begin(r), ::picorange::end(r),
+                                std::move(out), priority_tag<1>{});
+            }
+        };
+    }  // namespace _copy_backward
+    namespace {
+        constexpr auto& copy_backward =
+            static_const<_copy_backward::fn>::value;
+    }
+
+    // in_in_result
+#if PICORANGE_STD_RANGES
+    using std::ranges::in_in_result;
+#else
+    template <typename I1, typename I2>
+    struct in_in_result {
+        I1 in1;
+        I2 in2;
+
+        template <typename II1,
+                  typename II2,
+                  typename std::enable_if<
+                      std::is_convertible<const I1&, II1>::value &&
+                      std::is_convertible<const I2&, II2>::value>::type* =
+                      nullptr>
+        constexpr operator in_in_result<II1, II2>() const&
+        {
+            return {in1, in2};
+        }
+
+        template <typename II1,
+                  typename II2,
+                  typename std::enable_if<
+                      std::is_convertible<I1, II1>::value &&
+                      std::is_convertible<I2, II2>::value>::type* = nullptr>
+        PICORANGE_CONSTEXPR14 operator in_in_result<II1, II2>() &&
+        {
+            return {std::move(in1), std::move(in2)};
+        }
+    };
+#endif
+
+    template <typename I1, typename I2>
+    using mismatch_result = in_in_result<I1, I2>;
+
+    namespace detail {
+        // Default predicate of the comparison algorithms.
+        // Used to tell when memcmp can be used instead of calling pred.
+        struct equal_to {
+            template <typename T, typename U>
+            constexpr auto operator()(T&& t, U&& u) const
+                -> decltype(std::forward<T>(t) == std::forward<U>(u))
+            {
+                return std::forward<T>(t) == std::forward<U>(u);
+            }
+        };
+
+        // Types for which == is equality of the object representation
+        template <typename T>
+        struct is_trivially_equality_comparable
+            : std::integral_constant<
+                  bool,
+                  (std::is_integral<T>::value &&
+                   !std::is_same<typename std::remove_cv<T>::type,
+                                 bool>::value) ||
+                      std::is_enum<T>::value || std::is_pointer<T>::value> {
+        };
+
+        // Comparing [I1, S1) with [I2, S2) element-wise with == can be done
+        // by comparing the bytes
+        template <typename I1,
+                  typename S1,
+                  typename I2,
+                  typename S2,
+                  typename = void>
+        struct is_bytewise_comparable : std::false_type {
+        };
+        template <typename I1, typename S1, typename I2, typename S2>
+        struct is_bytewise_comparable<
+            I1,
+            S1,
+            I2,
+            S2,
+            typename std::enable_if<
+                is_lowerable_to_pointers<I1, S1>::value &&
+                is_lowerable_to_pointers<I2, S2>::value>::type>
+            : std::integral_constant<
+                  bool,
+                  std::is_same<
+                      typename std::remove_cv<iter_value_t<I1>>::type,
+                      typename std::remove_cv<iter_value_t<I2>>::type>::value &&
+                      is_trivially_equality_comparable<
+                          iter_value_t<I1>>::value> {
+        };
+
+        // A second pass over [I, S) is possible,
+        // or its length can be computed without one
+        template <typename I, typename S>
+        struct is_multipass
+            : std::integral_constant<
+                  bool,
+                  std::is_base_of<forward_iterator_tag,
+                                  iterator_category_t<I>>::value ||
+                      sized_sentinel_for<S, I>::value> {
+        };
+
+        // Compare n elements of first1 and first2
+        template <typename I1,
+                  typename I2,
+                  typename Pred,
+                  typename std::enable_if<
+                      is_bytewise_comparable<I1, I1, I2, I2>::value &&
+                      std::is_same<Pred, equal_to>::value>::type* = nullptr>
+        bool equal_n(I1 first1,
+                     I2 first2,
+                     iter_difference_t<I1> n,
+                     Pred&,
+                     priority_tag<1>)
+        {
+            if (n <= 0) {
+                return true;
+            }
+            return std::memcmp(::picorange::to_address(first1),
+                               ::picorange::to_address(first2),
+                               static_cast<std::size_t>(n) *
+                                   sizeof(iter_value_t<I1>)) == 0;
+        }
+        template <typename I1, typename I2, typename Pred>
+        PICORANGE_CONSTEXPR14 bool equal_n(I1 first1,
+                                           I2 first2,
+                                           iter_difference_t<I1> n,
+                                           Pred& pred,
+                                           priority_tag<0>)
+        {
+            for (; n > 0; --n, (void)++first1, (void)++first2) {
+                if (!pred(*first1, *first2)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }  // namespace detail
+
+    // equal
+    namespace _equal {
+        struct fn {
+        private:
+            template <typename I1,
+                      typename S1,
+                      typename I2,
+                      typename S2,
+                      typename Pred,
+                      typename std::enable_if<
+                          sized_sentinel_for<S1, I1>::value &&
+                          sized_sentinel_for<S2, I2>::value>::type* = nullptr>
+            static PICORANGE_CONSTEXPR14 bool impl(I1 first1,
+                                                   S1 last1,
+                                                   I2 first2,
+                                                   S2 last2,
+                                                   Pred& pred,
+                                                   priority_tag<1>)
+            {
+                const auto n = last1 - first1;
+                if (n != last2 - first2) {
+                    return false;
+                }
+                return detail::equal_n(std::move(first1), std::move(first2),
+                                       n, pred, priority_tag<1>{});
+            }
+
+            template <typename I1,
+                      typename S1,
+                      typename I2,
+                      typename S2,
+                      typename Pred>
+            static PICORANGE_CONSTEXPR14 bool impl(I1 first1,
+                                                   S1 last1,
+                                                   I2 first2,
+                                                   S2 last2,
+                                                   Pred& pred,
+                                                   priority_tag<0>)
+            {
+                for (; first1 != last1 && first2 != last2;
+                     ++first1, (void)++first2) {
+                    if (!pred(*first1, *first2)) {
+                        return false;
+                    }
+                }
+                return first1 == last1 && first2 == last2;
+            }
+
+            // Sized ranges with unsized sentinels, like std::list,
+            // can still be rejected early on length mismatch
+            template <typename R1,
+                      typename R2,
+                      typename Pred,
+                      typename std::enable_if<
+                          sized_range<R1>::value &&
+                          sized_range<R2>::value>::type* = nullptr>
+            static PICORANGE_CONSTEXPR14 bool range_impl(R1& r1,
+                                                         R2& r2,
+                                                         Pred& pred,
+                                                         priority_tag<1>)
+            {
+                if (static_cast<range_difference_t<R1>>(
+                        ::picorange::size(r1)) !=
+                    static_cast<range_difference_t<R1>>(
+                        ::picorange::size(r2))) {
+                    return false;
+                }
+                return fn::impl(::picorange::begin(r1), ::picorange::end(r1),
+                                ::picorange::begin(r2), ::picorange::end(r2),
+                                pred, priority_tag<1>{});
+            }
+            template <typename R1, typename R2, typename Pred>
+            static PICORANGE_CONSTEXPR14 bool range_impl(R1& r1,
+                                                         R2& r2,
+                                                         Pred& pred,
+                                                         priority_tag<0>)
+            {
+                return fn::impl(::picorange::begin(r1), ::picorange::end(r1),
+                                ::picorange::begin(r2), ::picorange::end(r2),
+                                pred, priority_tag<1>{});
+            }
+
+        public:
+            template <typename I1,
+                      typename S1,
+                      typename I2,
+                      typename S2,
+                      typename Pred = detail::equal_to,
+                      typename std::enable_if<
+                          sentinel_for<S1, I1>::value &&
+                          sentinel_for<S2, I2>::value>::type* = nullptr>
+            PICORANGE_CONSTEXPR14 bool operator()(I1 first1,
+                                                  S1 last1,
+                                                  I2 first2,
+                                                  S2 last2,
+                                                  Pred pred = Pred{}) const
+            {
+                return fn::impl(std::move(first1), std::move(last1),
+                                std::move(first2), std::move(last2), pred,
+                                priority_tag<1>{});
+            }
+
+            template <typename R1,
+                      typename R2,
+                      typename Pred = detail::equal_to,
+                      typename std::enable_if<range<R1>::value &&
+                                              range<R2>::value>::type* =
+                          nullptr>
+            PICORANGE_CONSTEXPR14 bool operator()(R1&& r1,
+                                                  R2&& r2,
+                                                  Pred pred = Pred{}) const
+            {
+                return fn::range_impl(r1, r2, pred, priority_tag<1>{});
+            }
+        };
+    }  // namespace _equal
+    namespace {
+        constexpr auto& equal = static_const<_equal::fn>::value;
+    }
+
+    // mismatch
+    namespace _mismatch {
+        struct fn {
+        private:
+            template <typename I1,
+                      typename S1,
+                      typename I2,
+                      typename S2,
+                      typename Pred,
+                      typename std::enable_if<
+                          detail::is_bytewise_comparable<I1, S1, I2, S2>::
+                              value &&
+                          std::is_same<Pred, detail::equal_to>::value>::type* =
+                          nullptr>
+            static mismatch_result<I1, I2> impl(I1 first1,
+                                                S1 last1,
+                                                I2 first2,
+                                                S2 last2,
+                                                Pred&,
+                                                priority_tag<1>)
+            {
+                const auto n1 = last1 - first1;
+                const auto n2 = last2 - first2;
+                const auto n = static_cast<std::size_t>(
+                    n1 < n2 ? n1 : static_cast<decltype(n1)>(n2));
+                const auto i = detail::simd::mismatch_bytes(
+                                   detail::to_byte_pointer(first1),
+                                   detail::to_byte_pointer(first2),
+                                   n * sizeof(iter_value_t<I1>)) /
+                               sizeof(iter_value_t<I1>);
+                return {first1 + static_cast<iter_difference_t<I1>>(i),
+                        first2 + static_cast<iter_difference_t<I2>>(i)};
+            }
+
+            template <typename I1,
+                      typename S1,
+                      typename I2,
+                      typename S2,
+                      typename Pred>
+            static PICORANGE_CONSTEXPR14 mismatch_result<I1, I2> impl(
+                I1 first1,
+                S1 last1,
+                I2 first2,
+                S2 last2,
+                Pred& pred,
+                priority_tag<0>)
+            {
+                for (; first1 != last1 && first2 != last2;
+                     ++first1, (void)++first2) {
+                    if (!pred(*first1, *first2)) {
+                        break;
+                    }
+                }
+                return {std::move(first1), std::move(first2)};
+            }
+
+        public:
+            template <typename I1,
+                      typename S1,
+                      typename I2,
+                      typename S2,
+                      typename Pred = detail::equal_to,
+                      typename std::enable_if<
+                          sentinel_for<S1, I1>::value &&
+                          sentinel_for<S2, I2>::value>::type* = nullptr>
+            PICORANGE_CONSTEXPR14 mismatch_result<I1, I2> operator()(
+                I1 first1,
+                S1 last1,
+                I2 first2,
+                S2 last2,
+                Pred pred = Pred{}) const
+            {
+                return fn::impl(std::move(first1), std::move(last1),
+                                std::move(first2), std::move(last2), pred,
+                                priority_tag<1>{});
+            }
+
+            template <typename R1,
+                      typename R2,
+                      typename Pred = detail::equal_to,
+                      typename std::enable_if<range<R1>::value &&
+                                              range<R2>::value>::type* =
+                          nullptr>
+            PICORANGE_CONSTEXPR14
+                mismatch_result<iterator_t<R1>, iterator_t<R2>>
+                operator()(R1&& r1, R2&& r2, Pred pred = Pred{}) const
+            {
+                return fn::impl(::picorange::begin(r1), ::picorange::end(r1),
+                                ::picorange::begin(r2), ::picorange::end(r2),
+                                pred, priority_tag<1>{});
+            }
+        };
+    }  // namespace _mismatch
+    namespace {
+        constexpr auto& mismatch = static_const<_mismatch::fn>::value;
+    }
+
+    // starts_with: [first2, last2) is a prefix of [first1, last1)
+    namespace _starts_with {
+        struct fn {
+        private:
+            template <typename I1,
+                      typename S1,
+                      typename I2,
+                      typename S2,
+                      typename Pred,
+                      typename std::enable_if<
+                          sized_sentinel_for<S1, I1>::value &&
+                          sized_sentinel_for<S2, I2>::value>::type* = nullptr>
+            static PICORANGE_CONSTEXPR14 bool impl(I1 first1,
+                                                   S1 last1,
+                                                   I2 first2,
+                                                   S2 last2,
+                                                   Pred& pred,
+                                                   priority_tag<1>)
+            {
+                const auto n2 = last2 - first2;
+                if (last1 - first1 < n2) {
+                    return false;
+                }
+                return detail::equal_n(
+                    std::move(first1), std::move(first2),
+                    static_cast<iter_difference_t<I1>>(n2), pred,
+                    priority_tag<1>{});
+            }
+
+            template <typename I1,
+                      typename S1,
+                      typename I2,
+                      typename S2,
+                      typename Pred>
+            static PICORANGE_CONSTEXPR14 bool impl(I1 first1,
+                                                   S1 last1,
+                                                   I2 first2,
+                                                   S2 last2,
+                                                   Pred& pred,
+                                                   priority_tag<0>)
+            {
+                return ::picorange::mismatch(std::move(first1),
+                                             std::move(last1),
+                                             std::move(first2), last2, pred)
+                           .in2 == last2;
+            }
+
+        public:
+            template <typename I1,
+                      typename S1,
+                      typename I2,
+                      typename S2,
+                      typename Pred = detail::equal_to,
+                      typename std::enable_if<
+                          sentinel_for<S1, I1>::value &&
+                          sentinel_for<S2, I2>::value>::type* = nullptr>
+            PICORANGE_CONSTEXPR14 bool operator()(I1 first1,
+                                                  S1 last1,
+                                                  I2 first2,
+                                                  S2 last2,
+                                                  Pred pred = Pred{}) const
+            {
+                return fn::impl(std::move(first1), std::move(last1),
+                                std::move(first2), std::move(last2), pred,
+                                priority_tag<1>{});
+            }
+
+            template <typename R1,
+                      typename R2,
+                      typename Pred = detail::equal_to,
+                      typename std::enable_if<range<R1>::value &&
+                                              range<R2>::value>::type* =
+                          nullptr>
+            PICORANGE_CONSTEXPR14 bool operator()(R1&& r1,
+                                                  R2&& r2,
+                                                  Pred pred = Pred{}) const
+            {
+                return fn::impl(::picorange::begin(r1), ::picorange::end(r1),
+                                ::picorange::begin(r2), ::picorange::end(r2),
+                                pred, priority_tag<1>{});
+            }
+        };
+    }  // namespace _starts_with
+    namespace {
+        constexpr auto& starts_with = static_const<_starts_with::fn>::value;
+    }
+
+    // ends_with: [first2, last2) is a suffix of [first1, last1)
+    namespace _ends_with {
+        struct fn {
+        private:
+            template <typename I1,
+                      typename S1,
+                      typename I2,
+                      typename S2,
+                      typename Pred>
+            static PICORANGE_CONSTEXPR14 bool impl(I1 first1,
+                                                   S1 last1,
+                                                   I2 first2,
+                                                   S2 last2,
+                                                   Pred& pred)
+            {
+                const auto n1 = ::picorange::distance(first1, last1);
+                const auto n2 = static_cast<iter_difference_t<I1>>(
+                    ::picorange::distance(first2, last2));
+                if (n1 < n2) {
+                    return false;
+                }
+                ::picorange::advance(first1, n1 - n2);
+                return detail::equal_n(std::move(first1), std::move(first2),
+                                       n2, pred, priority_tag<1>{});
+            }
+
+        public:
+            template <typename I1,
+                      typename S1,
+                      typename I2,
+                      typename S2,
+                      typename Pred = detail::equal_to,
+                      typename std::enable_if<
+                          sentinel_for<S1, I1>::value &&
+                          sentinel_for<S2, I2>::value &&
+                          detail::is_multipass<I1, S1>::value &&
+                          detail::is_multipass<I2, S2>::value>::type* = nullptr>
+            PICORANGE_CONSTEXPR14 bool operator()(I1 first1,
+                                                  S1 last1,
+                                                  I2 first2,
+                                                  S2 last2,
+                                                  Pred pred = Pred{}) const
+            {
+                return fn::impl(std::move(first1), std::move(last1),
+                                std::move(first2), std::move(last2), pred);
+            }
+
+            template <typename R1,
+                      typename R2,
+                      typename Pred = detail::equal_to,
+                      typename std::enable_if<
+                          range<R1>::value && range<R2>::value &&
+                          detail::is_multipass<iterator_t<R1>,
+                                               sentinel_t<R1>>::value &&
+                          detail::is_multipass<iterator_t<R2>,
+                                               sentinel_t<R2>>::value>::type* =
+                          nullptr>
+            PICORANGE_CONSTEXPR14 bool operator()(R1&& r1,
+                                                  R2&& r2,
+                                                  Pred pred = Pred{}) const
+            {
+                return fn::impl(::picorange::begin(r1), ::picorange::end(r1),
+                                ::picorange::begin(r2), ::picorange::end(r2),
+                                pred);
+            }
+        };
+    }  // namespace _ends_with
+    namespace {
+        constexpr auto& ends_with = static_const<_ends_with::fn>::value;
+    }
+
+    namespace detail {
+        // count over contiguous integers: a branchless loop over pointers,
+        // which compilers can vectorize
+        template <typename I, typename S, typename T, typename = void>
+        struct is_countable_by_pointer : std::false_type {
+        };
+        template <typename I, typename S, typename T>
+        struct is_countable_by_pointer<
+            I,
+            S,
+            T,
+            typename std::enable_if<
+                is_lowerable_to_pointers<I, S>::value>::type>
+            : std::integral_constant<
+                  bool,
+                  is_trivially_equality_comparable<iter_value_t<I>>::value &&
+                      (std::is_same<
+                           typename std::remove_cv<iter_value_t<I>>::type,
+                           T>::value ||
+                       (std::is_integral<iter_value_t<I>>::value &&
+                        std::is_integral<T>::value))> {
+        };
+
+        // Like find_if_table_threshold, but count_if visits every element,
+        // so the table pays off sooner
+        constexpr std::ptrdiff_t count_if_table_threshold = 512;
+    }  // namespace detail
+
+    // count
+    namespace _count {
+        struct fn {
+        private:
+            template <typename I,
+                      typename S,
+                      typename T,
+                      typename std::enable_if<
+                          detail::is_segmented_contiguous_pair<I, S>::value>::
+                          type* = nullptr>
+            static iter_difference_t<I> impl(I first,
+                                             S last,
+                                             const T& value,
+                                             priority_tag<3>)
+            {
+                using local = detail::local_iterator_t<I>;
+                iter_difference_t<I> c = 0;
+                detail::segmented_for_each(
+                    first, last, [&c, &value](local b, local e) {
+                        c += static_cast<iter_difference_t<I>>(
+                            fn::impl(b, e, value, priority_tag<2>{}));
+                    });
+                return c;
+            }
+
+            template <typename I,
+                      typename S,
+                      typename T,
+                      typename std::enable_if<
+                          detail::is_byte_iterator_pair<I, S>::value &&
+                          detail::is_byte_comparable<iter_value_t<I>, T>::
+                              value>::type* = nullptr>
+            static iter_difference_t<I> impl(I first,
+                                             S last,
+                                             const T& value,
+                                             priority_tag<2>)
+            {
+                using value_type = iter_value_t<I>;
+
+                const auto n = last - first;
+                const auto b = static_cast<value_type>(value);
+                if (!(b == value)) {
+                    return 0;
+                }
+                unsigned char byte;
+                std::memcpy(&byte, &b, 1);
+
+                const auto p = detail::to_byte_pointer(first);
+                return static_cast<iter_difference_t<I>>(
+                    detail::simd::count_byte(p, p + n, byte));
+            }
+
+            template <typename I,
+                      typename S,
+                      typename T,
+                      typename std::enable_if<
+                          detail::is_countable_by_pointer<I, S, T>::value>::
+                          type* = nullptr>
+            static iter_difference_t<I> impl(I first,
+                                             S last,
+                                             const T& value,
+                                             priority_tag<1>)
+            {
+                const auto n = last - first;
+                const auto p = ::picorange::to_address(first);
+                iter_difference_t<I> c = 0;
+                for (decltype(last - first) i = 0; i != n; ++i) {
+                    c += static_cast<iter_difference_t<I>>(p[i] == value);
+                }
+                return c;
+            }
+
+            template <typename I, typename S, typename T>
+            static PICORANGE_CONSTEXPR14 iter_difference_t<I>
+            impl(I first, S last, const T& value, priority_tag<0>)
+            {
+                iter_difference_t<I> c = 0;
+                for (; first != last; ++first) {
+                    if (*first == value) {
+                        ++c;
+                    }
+                }
+                return c;
+            }
+
+        public:
+            template <typename I,
+                      typename S,
+                      typename T,
+                      typename std::enable_if<
+                          sentinel_for<S, I>::value>::type* = nullptr>
+            PICORANGE_CONSTEXPR14 iter_difference_t<I>
+            operator()(I first, S last, const T& value) const
+            {
+                return fn::impl(std::move(first), std::move(last), value,
+                                priority_tag<3>{});
+            }
+
+            template <typename R,
+                      typename T,
+                      typename std::enable_if<range<R>::value>::type* =
+                          nullptr>
+            PICORANGE_CONSTEXPR14 range_difference_t<R> operator()(
+                R&& r,
+                const T& value) const
+            {
+                return fn::impl(::picorange::begin(r), ::picorange::end(r),
+                                value, priority_tag<3>{});
+            }
+        };
+    }  // namespace _count
+    namespace {
+        constexpr auto& count = static_const<_count::fn>::value;
+    }
+
+    // count_if
+    namespace _count_if {
+        struct fn {
+        private:
+            // The byte table is built once for all segments
+            template <typename I,
+                      typename S,
+                      typename Pred,
+                      typename std::enable_if<
+                          detail::is_segmented_contiguous_pair<I, S>::value &&
+                          detail::is_byte_like<iter_value_t<I>>::value>::type* =
+                          nullptr>
+            static iter_difference_t<I> impl(I first,
+                                             S last,
+                                             Pred& pred,
+                                             priority_tag<3>)
+            {
+                using local = detail::local_iterator_t<I>;
+                using value_type = iter_value_t<I>;
+
+                if (::picorange::distance(first, last) <
+                    detail::count_if_table_threshold) {
+                    return fn::impl(std::move(first), std::move(last), pred,
+                                    priority_tag<2>{});
+                }
+
+                auto classify = [&pred](unsigned char c) -> bool {
+                    value_type v;
+                    std::memcpy(&v, &c, 1);
+                    return static_cast<bool>(pred(v));
+                };
+                const auto set = detail::simd::make_byte_set(classify);
+
+                std::size_t c = 0;
+                detail::segmented_for_each(
+                    first, last, [&c, &set](local b, local e) {
+                        const auto p = detail::to_byte_pointer(b);
+                        c += detail::simd::count_in_set(p, p + (e - b), set);
+                    });
+                return static_cast<iter_difference_t<I>>(c);
+            }
+
+            template <typename I,
+                      typename S,
+                      typename Pred,
+                      typename std::enable_if<
+                          detail::is_segmented_contiguous_pair<I, S>::value>::
+                          type* = nullptr>
+            static iter_difference_t<I> impl(I first,
+                                             S last,
+                                             Pred& pred,
+                                             priority_tag<2>)
+            {
+                using local = detail::local_iterator_t<I>;
+                iter_difference_t<I> c = 0;
+                detail::segmented_for_each(
+                    first, last, [&c, &pred](local b, local e) {
+                        c += static_cast<iter_difference_t<I>>(
+                            fn::impl(b, e, pred, priority_tag<0>{}));
+                    });
+                return c;
+            }
+
+            template <typename I,
+                      typename S,
+                      typename Pred,
+                      typename std::enable_if<
+                          detail::is_byte_iterator_pair<I, S>::value>::type* =
+                          nullptr>
+            static iter_difference_t<I> impl(I first,
+                                             S last,
+                                             Pred& pred,
+                                             priority_tag<1>)
+            {
+                using value_type = iter_value_t<I>;
+
+                const auto n = last - first;
+                if (n < detail::count_if_table_threshold) {
+                    return fn::impl(std::move(first), std::move(last), pred,
+                                    priority_tag<0>{});
+                }
+
+                auto classify = [&pred](unsigned char c) -> bool {
+                    value_type v;
+                    std::memcpy(&v, &c, 1);
+                    return static_cast<bool>(pred(v));
+                };
+                const auto set = detail::simd::make_byte_set(classify);
+
+                const auto p = detail::to_byte_pointer(first);
+                return static_cast<iter_difference_t<I>>(
+                    detail::simd::count_in_set(p, p + n, set));
+            }
+
+            template <typename I, typename S, typename Pred>
+            static PICORANGE_CONSTEXPR14 iter_difference_t<I>
+            impl(I first, S last, Pred& pred, priority_tag<0>)
+            {
+                iter_difference_t<I> c = 0;
+                for (; first != last; ++first) {
+                    if (pred(*first)) {
+                        ++c;
+                    }
+                }
+                return c;
+            }
+
+        public:
+            // Like in find_if, pred must be equality preserving
+            template <typename I,
+                      typename S,
+                      typename Pred,
+                      typename std::enable_if<
+                          sentinel_for<S, I>::value>::type* = nullptr>
+            PICORANGE_CONSTEXPR14 iter_difference_t<I>
+            operator()(I first, S last, Pred pred) const
+            {
+                return fn::impl(std::move(first), std::move(last), pred,
+                                priority_tag<3>{});
+            }
+
+            template <typename R,
+                      typename Pred,
+                      typename std::enable_if<range<R>::value>::type* =
+                          nullptr>
+            PICORANGE_CONSTEXPR14 range_difference_t<R> operator()(
+                R&& r,
+                Pred pred) const
+            {
+                return fn::impl(::picorange::begin(r), ::picorange::end(r),
+                                pred, priority_tag<3>{});
+            }
+        };
+    }  // namespace _count_if
+    namespace {
+        constexpr auto& count_if = static_const<_count_if::fn>::value;
+    }
+
+    // byte_histogram: number of occurrences of every byte value
+    using byte_histogram_result = std::array<std::size_t, 256>;
+
+    namespace _byte_histogram {
+        struct fn {
+        private:
+            template <typename I,
+                      typename S,
+                      typename std::enable_if<
+                          detail::is_segmented_contiguous_pair<I, S>::value>::
+                          type* = nullptr>
+            static void impl(I first,
+                             S last,
+                             byte_histogram_result& counts,
+                             priority_tag<2>)
+            {
+                using local = detail::local_iterator_t<I>;
+                detail::simd::byte_histogram_accumulator acc;
+                detail::segmented_for_each(
+                    first, last, [&counts, &acc](local b, local e) {
+                        const auto p = detail::to_byte_pointer(b);
+                        acc.add(p, p + (e - b), counts.data());
+                    });
+                acc.flush(counts.data());
+            }
+
+            template <typename I,
+                      typename S,
+                      typename std::enable_if<
+                          detail::is_byte_iterator_pair<I, S>::value>::type* =
+                          nullptr>
+            static void impl(I first,
+                             S last,
+                             byte_histogram_result& counts,
+                             priority_tag<1>)
+            {
+                const auto p = detail::to_byte_pointer(first);
+                detail::simd::byte_histogram(p, p + (last - first),
+                                             counts.data());
+            }
+
+            template <typename I, typename S>
+            static void impl(I first,
+                             S last,
+                             byte_histogram_result& counts,
+                             priority_tag<0>)
+            {
+                for (; first != last; ++first) {
+                    ++counts[static_cast<unsigned char>(*first)];
+                }
+            }
+
+        public:
+            template <typename I,
+                      typename S,
+                      typename std::enable_if<
+                          sentinel_for<S, I>::value &&
+                          detail::is_byte_like<iter_value_t<I>>::value>::type* =
+                          nullptr>
+            byte_histogram_result operator()(I first, S last) const
+            {
+                byte_histogram_result counts{};
+                fn::impl(std::move(first), std::move(last), counts,
+                         priority_tag<2>{});
+                return counts;
+            }
+
+            template <typename R,
+                      typename std::enable_if<
+                          range<R>::value &&
+                          detail::is_byte_like<
+                              iter_value_t<iterator_t<R>>>::value>::type* =
+                          nullptr>
+            byte_histogram_result operator()(R&& r) const
+            {
+                byte_histogram_result counts{};
+                fn::impl(::picorange::begin(r), ::picorange::end(r), counts,
+                         priority_tag<2>{});
+                return counts;
+            }
+        };
+    }  // namespace _byte_histogram
+    namespace {
+        constexpr auto& byte_histogram =
+            static_const<_byte_histogram::fn>::value;
+    }
+
+    PICORANGE_END_NAMESPACE
+}  // namespace picorange
+
+#endif  // PICORANGE_ALGORITHM_H
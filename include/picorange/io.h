@@ -0,0 +1,504 @@
+// Copyright 2017-2019 Elias Kosunen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// This file is a part of picorange:
+//     https://github.com/eliaskosunen/picorange
+
+#ifndef PICORANGE_IO_H
+#define PICORANGE_IO_H
+
+#include "picorange.h"
+
+#ifndef PICORANGE_HAS_POSIX_IO
+#if defined(__unix__) || defined(__APPLE__)
+#define PICORANGE_HAS_POSIX_IO 1
+#else
+#define PICORANGE_HAS_POSIX_IO 0
+#endif
+#endif
+
+#if PICORANGE_HAS_POSIX_IO
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <system_error>
+#endif
+
+namespace picorange {
+    PICORANGE_BEGIN_NAMESPACE
+
+#if PICORANGE_HAS_POSIX_IO
+    // An input range over the bytes read from a file descriptor with read(2).
+    //
+    // Besides going through the iterators one char at a time, the unread
+    // part of the current buffer can be accessed with chunk(), and marked
+    // as read with consume(). The file descriptor is not closed.
+    //
+    // Iterators refer to the range object, and are invalidated when it's
+    // moved from.
+    class fd_input_range {
+    public:
+        static constexpr std::size_t default_buffer_size = 64 * 1024;
+
+        class iterator;
+        struct sentinel {
+        };
+
+        explicit fd_input_range(int fd,
+                                std::size_t buffer_size = default_buffer_size)
+            : m_buffer(new char[buffer_size != 0 ? buffer_size : 1]),
+              m_buffer_size(buffer_size != 0 ? buffer_size : 1),
+              m_fd(fd)
+        {
+        }
+
+        fd_input_range(const fd_input_range&) = delete;
+        fd_input_range& operator=(const fd_input_range&) = delete;
+
+        fd_input_range(fd_input_range&& other) noexcept
+            : m_buffer(std::move(other.m_buffer)),
+              m_buffer_size(other.m_buffer_size),
+              m_cur(other.m_cur),
+              m_end(other.m_end),
+              m_fd(other.m_fd),
+              m_done(other.m_done),
+              m_error(other.m_error)
+        {
+            other.m_cur = other.m_end = nullptr;
+            other.m_done = true;
+        }
+        fd_input_range& operator=(fd_input_range&& other) noexcept
+        {
+            if (this != &other) {
+                m_buffer = std::move(other.m_buffer);
+                m_buffer_size = other.m_buffer_size;
+                m_cur = other.m_cur;
+                m_end = other.m_end;
+                m_fd = other.m_fd;
+                m_done = other.m_done;
+                m_error = other.m_error;
+                other.m_cur = other.m_end = nullptr;
+                other.m_done = true;
+            }
+            return *this;
+        }
+
+        ~fd_input_range() = default;
+
+        iterator begin();
+        sentinel end() const noexcept
+        {
+            return {};
+        }
+
+        // The unread part of the current buffer.
+        // Reads more, if it's empty: it's only empty at the end of input.
+        subrange<const char*> chunk()
+        {
+            fill_if_empty();
+            return {m_cur, m_end};
+        }
+
+        // Marks the first n chars of chunk() as read.
+        // Doesn't read more, so that reading the last char of a request
+        // from a pipe or a socket doesn't wait for the next one.
+        void consume(std::size_t n)
+        {
+            PICORANGE_EXPECT(n <= static_cast<std::size_t>(m_end - m_cur));
+            m_cur += n;
+        }
+
+        bool eof() const noexcept
+        {
+            return m_cur == m_end && m_done;
+        }
+        // The error from read(2), if the input ended because of one
+        const std::error_code& error() const noexcept
+        {
+            return m_error;
+        }
+
+        int fd() const noexcept
+        {
+            return m_fd;
+        }
+        std::size_t buffer_size() const noexcept
+        {
+            return m_buffer_size;
+        }
+
+    private:
+        void fill_if_empty() noexcept
+        {
+            if (m_cur == m_end) {
+                fill();
+            }
+        }
+
+        void fill() noexcept
+        {
+            if (m_done) {
+                return;
+            }
+            ::ssize_t n;
+            do {
+                n = ::read(m_fd, m_buffer.get(), m_buffer_size);
+            } while (n < 0 && errno == EINTR);
+
+            m_cur = m_buffer.get();
+            if (n <= 0) {
+                if (n < 0) {
+                    m_error = std::error_code{errno, std::generic_category()};
+                }
+                m_done = true;
+                m_end = m_cur;
+                return;
+            }
+            m_end = m_cur + n;
+        }
+
+        std::unique_ptr<char[]> m_buffer;
+        std::size_t m_buffer_size;
+        const char* m_cur{nullptr};
+        const char* m_end{nullptr};
+        int m_fd;
+        bool m_done{false};
+        std::error_code m_error{};
+    };
+
+    class fd_input_range::iterator {
+        friend class fd_input_range;
+
+    public:
+        using value_type = char;
+        using difference_type = std::ptrdiff_t;
+        using reference = const char&;
+        using pointer = const char*;
+        using iterator_category = input_iterator_tag;
+
+        iterator() = default;
+
+        reference operator*() const
+        {
+            PICORANGE_EXPECT(!at_end());
+            m_range->fill_if_empty();
+            return *m_range->m_cur;
+        }
+
+        iterator& operator++()
+        {
+            m_range->consume(1);
+            return *this;
+        }
+        void operator++(int)
+        {
+            ++*this;
+        }
+
+        friend bool operator==(const iterator& i, sentinel) noexcept
+        {
+            return i.at_end();
+        }
+        friend bool operator==(sentinel, const iterator& i) noexcept
+        {
+            return i.at_end();
+        }
+        friend bool operator!=(const iterator& i, sentinel) noexcept
+        {
+            return !i.at_end();
+        }
+        friend bool operator!=(sentinel, const iterator& i) noexcept
+        {
+            return !i.at_end();
+        }
+
+    private:
+        explicit iterator(fd_input_range* r) noexcept : m_range(r) {}
+
+        // The buffer is refilled only here and in operator*, when it's
+        // needed, so an empty buffer after that means end of input
+        bool at_end() const noexcept
+        {
+            if (!m_range) {
+                return true;
+            }
+            m_range->fill_if_empty();
+            return m_range->m_cur == m_range->m_end;
+        }
+
+        fd_input_range* m_range{nullptr};
+    };
+
+    inline fd_input_range::iterator fd_input_range::begin()
+    {
+        return iterator{this};
+    }
+
+    // Hints for the kernel about how a mapped_file_view is going to be
+    // accessed, given to madvise(2). Can be combined with |.
+    enum class mmap_advice : unsigned {
+        normal = 0,
+        sequential = 1,
+        willneed = 2,
+        // Transparent huge pages, on Linux
+        hugepage = 4
+    };
+
+    constexpr mmap_advice operator|(mmap_advice a, mmap_advice b) noexcept
+    {
+        return static_cast<mmap_advice>(static_cast<unsigned>(a) |
+                                        static_cast<unsigned>(b));
+    }
+    constexpr bool operator&(mmap_advice a, mmap_advice b) noexcept
+    {
+        return (static_cast<unsigned>(a) & static_cast<unsigned>(b)) != 0;
+    }
+
+    namespace detail {
+        // A read-only, private mapping, unmapped on destruction
+        class file_mapping {
+        public:
+            file_mapping(void* addr, std::size_t len) noexcept
+                : m_addr(addr), m_len(len)
+            {
+            }
+
+            file_mapping(const file_mapping&) = delete;
+            file_mapping& operator=(const file_mapping&) = delete;
+
+            ~file_mapping()
+            {
+                ::munmap(m_addr, m_len);
+            }
+
+            const char* data() const noexcept
+            {
+                return static_cast<const char*>(m_addr);
+            }
+
+        private:
+            void* m_addr;
+            std::size_t m_len;
+        };
+
+        inline void apply_mmap_advice(void* addr,
+                                      std::size_t len,
+                                      mmap_advice advice) noexcept
+        {
+            // Failing hints are ignored
+            if (advice & mmap_advice::sequential) {
+                ::madvise(addr, len, MADV_SEQUENTIAL);
+            }
+            if (advice & mmap_advice::willneed) {
+                ::madvise(addr, len, MADV_WILLNEED);
+            }
+#ifdef MADV_HUGEPAGE
+            if (advice & mmap_advice::hugepage) {
+                ::madvise(addr, len, MADV_HUGEPAGE);
+            }
+#endif
+        }
+
+        inline std::uint64_t page_size() noexcept
+        {
+            static const auto size =
+                static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+            return size;
+        }
+    }  // namespace detail
+
+    // A read-only view of a file, or a part of it, mapped with mmap(2).
+    //
+    // Copies share the mapping, which is unmapped when the last one is
+    // destroyed. The file descriptor can be closed after construction.
+    // If mapping fails, the view is empty, and error() tells why.
+    class mapped_file_view : public view_interface<mapped_file_view> {
+    public:
+        mapped_file_view() = default;
+
+        // Maps the whole file
+        explicit mapped_file_view(int fd,
+                                  mmap_advice advice = mmap_advice::normal)
+        {
+            struct ::stat st;
+            if (::fstat(fd, &st) != 0) {
+                m_error = std::error_code{errno, std::generic_category()};
+                return;
+            }
+            map(fd, 0, static_cast<std::uint64_t>(st.st_size), advice);
+        }
+
+        // Maps length bytes, starting at offset.
+        // offset doesn't need to be page-aligned.
+        mapped_file_view(int fd,
+                         std::uint64_t offset,
+                         std::size_t length,
+                         mmap_advice advice = mmap_advice::normal)
+        {
+            map(fd, offset, length, advice);
+        }
+
+        const char* begin() const noexcept
+        {
+            return m_begin;
+        }
+        const char* end() const noexcept
+        {
+            return m_end;
+        }
+
+        const char* data() const noexcept
+        {
+            return m_begin;
+        }
+        std::size_t size() const noexcept
+        {
+            return static_cast<std::size_t>(m_end - m_begin);
+        }
+        PICORANGE_NODISCARD bool empty() const noexcept
+        {
+            return m_begin == m_end;
+        }
+
+        const std::error_code& error() const noexcept
+        {
+            return m_error;
+        }
+
+    private:
+        void map(int fd,
+                 std::uint64_t offset,
+                 std::uint64_t length,
+                 mmap_advice advice)
+        {
+            if (length == 0) {
+                return;
+            }
+            // mmap offsets have to be page-aligned
+            const auto slack = offset % detail::page_size();
+            const auto map_len = length + slack;
+            if (map_len < length ||
+                map_len > static_cast<std::uint64_t>(SIZE_MAX)) {
+                m_error = std::make_error_code(std::errc::file_too_large);
+                return;
+            }
+
+            void* addr = ::mmap(nullptr, static_cast<std::size_t>(map_len),
+                                PROT_READ, MAP_PRIVATE, fd,
+                                static_cast<::off_t>(offset - slack));
+            if (addr == MAP_FAILED) {
+                m_error = std::error_code{errno, std::generic_category()};
+                return;
+            }
+            m_mapping = std::make_shared<const detail::file_mapping>(
+                addr, static_cast<std::size_t>(map_len));
+            detail::apply_mmap_advice(addr, static_cast<std::size_t>(map_len),
+                                      advice);
+
+            m_begin = m_mapping->data() + slack;
+            m_end = m_begin + length;
+        }
+
+        std::shared_ptr<const detail::file_mapping> m_mapping{};
+        const char* m_begin{nullptr};
+        const char* m_end{nullptr};
+        std::error_code m_error{};
+    };
+
+    // Maps a file one window at a time, for files too large to map at once.
+    //
+    // view() is the part of the file starting at position(), at most
+    // window_size bytes long. advance(n) moves the window n bytes forward:
+    // data not consumed, like a token crossing the end of the window, is at
+    // the start of the next window.
+    class mapped_file_window {
+    public:
+        mapped_file_window(int fd,
+                           std::size_t window_size,
+                           mmap_advice advice = mmap_advice::normal)
+            : m_fd(fd),
+              m_window_size(window_size != 0 ? window_size : 1),
+              m_advice(advice)
+        {
+            struct ::stat st;
+            if (::fstat(fd, &st) != 0) {
+                m_error = std::error_code{errno, std::generic_category()};
+                return;
+            }
+            m_file_size = static_cast<std::uint64_t>(st.st_size);
+            remap();
+        }
+
+        const mapped_file_view& view() const noexcept
+        {
+            return m_view;
+        }
+        std::uint64_t position() const noexcept
+        {
+            return m_position;
+        }
+        std::uint64_t file_size() const noexcept
+        {
+            return m_file_size;
+        }
+
+        bool eof() const noexcept
+        {
+            return m_position == m_file_size || m_error;
+        }
+        const std::error_code& error() const noexcept
+        {
+            return m_error;
+        }
+
+        // Moves the window n bytes forward, n <= view().size()
+        void advance(std::size_t n)
+        {
+            PICORANGE_EXPECT(n <= m_view.size());
+            m_position += n;
+            remap();
+        }
+
+    private:
+        void remap()
+        {
+            // Unmap first, so that two windows are never mapped at once
+            m_view = mapped_file_view{};
+            const auto left = m_file_size - m_position;
+            const auto length = left < m_window_size
+                                    ? static_cast<std::size_t>(left)
+                                    : m_window_size;
+            m_view = mapped_file_view{m_fd, m_position, length, m_advice};
+            m_error = m_view.error();
+        }
+
+        int m_fd;
+        std::size_t m_window_size;
+        mmap_advice m_advice;
+        std::uint64_t m_file_size{0};
+        std::uint64_t m_position{0};
+        mapped_file_view m_view{};
+        std::error_code m_error{};
+    };
+#endif  // PICORANGE_HAS_POSIX_IO
+
+    PICORANGE_END_NAMESPACE
+}  // namespace picorange
+
+#endif  // PICORANGE_IO_H
@@ -0,0 +1,1327 @@
+// Copyright 2017-2019 Elias Kosunen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// This file is a part of picorange:
+//     https://github.com/eliaskosunen/picorange
+
+#ifndef PICORANGE_PARALLEL_H
+#define PICORANGE_PARALLEL_H
+
+#include "algorithm.h"
+#include "picorange.h"
+#include "views.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace picorange {
+    PICORANGE_BEGIN_NAMESPACE
+
+    namespace par {
+        // A fixed set of worker threads running the tasks given to post()
+        // in FIFO order.
+        //
+        // The destructor runs the tasks still in the queue, and joins the
+        // threads. Exceptions escaping a task call std::terminate.
+        class thread_pool {
+        public:
+            explicit thread_pool(std::size_t threads)
+            {
+                m_threads.reserve(threads);
+                try {
+                    for (std::size_t i = 0; i < threads; ++i) {
+                        m_threads.emplace_back([this] { run(); });
+                    }
+                }
+                catch (...) {
+                    stop();
+                    throw;
+                }
+            }
+
+            thread_pool(const thread_pool&) = delete;
+            thread_pool& operator=(const thread_pool&) = delete;
+
+            ~thread_pool()
+            {
+                stop();
+            }
+
+            // Number of worker threads
+            std::size_t size() const noexcept
+            {
+                return m_threads.size();
+            }
+
+            // Without worker threads, runs the task on the calling thread
+            void post(std::function<void()> task)
+            {
+                if (m_threads.empty()) {
+                    task();
+                    return;
+                }
+                {
+                    std::lock_guard<std::mutex> lock{m_mutex};
+                    m_tasks.push_back(std::move(task));
+                }
+                m_cv.notify_one();
+            }
+
+        private:
+            void run()
+            {
+                for (;;) {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock<std::mutex> lock{m_mutex};
+                        m_cv.wait(lock, [this] {
+                            return m_stop || !m_tasks.empty();
+                        });
+                        if (m_tasks.empty()) {
+                            return;
+                        }
+                        task = std::move(m_tasks.front());
+                        m_tasks.pop_front();
+                    }
+                    task();
+                }
+            }
+
+            void stop()
+            {
+                {
+                    std::lock_guard<std::mutex> lock{m_mutex};
+                    m_stop = true;
+                }
+                m_cv.notify_all();
+                for (auto& t : m_threads) {
+                    t.join();
+                }
+                m_threads.clear();
+            }
+
+            std::mutex m_mutex;
+            std::condition_variable m_cv;
+            std::deque<std::function<void()>> m_tasks;
+            std::vector<std::thread> m_threads;
+            bool m_stop{false};
+        };
+
+        // The executor used when options::executor is empty, created on
+        // first use. Together with the calling thread, it uses every
+        // hardware thread.
+        inline thread_pool& default_thread_pool()
+        {
+            static thread_pool pool{[] {
+                const auto n = std::thread::hardware_concurrency();
+                return n > 1 ? static_cast<std::size_t>(n - 1) : 0;
+            }()};
+            return pool;
+        }
+
+        // A non-owning reference to an executor, which the algorithms use
+        // to run work on other threads.
+        //
+        // An executor is an object e, for which e.post(task) runs a
+        // std::function<void()> at some point, possibly on another thread,
+        // and e.size() is the number of threads that can run tasks at the
+        // same time. Tasks don't block waiting on each other, so an executor
+        // shared with other work, or used from its own tasks, is fine.
+        class executor_ref {
+            template <typename E>
+            using post_t = decltype(std::declval<E&>().post(
+                std::declval<std::function<void()>>()));
+            template <typename E>
+            using size_t_ = decltype(
+                static_cast<std::size_t>(std::declval<const E&>().size()));
+
+        public:
+            // Empty: default_thread_pool() is used
+            executor_ref() = default;
+
+            template <typename E,
+                      typename std::enable_if<
+                          !std::is_same<typename std::remove_cv<E>::type,
+                                        executor_ref>::value &&
+                          exists<post_t, E>::value &&
+                          exists<size_t_, E>::value>::type* = nullptr>
+            executor_ref(E& e) noexcept
+                : m_executor(static_cast<void*>(std::addressof(e))),
+                  m_post(&post_impl<E>),
+                  m_size(&size_impl<E>)
+            {
+            }
+
+            explicit operator bool() const noexcept
+            {
+                return m_executor != nullptr;
+            }
+
+            std::size_t size() const
+            {
+                PICORANGE_EXPECT(m_executor != nullptr);
+                return m_size(m_executor);
+            }
+
+            void post(std::function<void()> task) const
+            {
+                PICORANGE_EXPECT(m_executor != nullptr);
+                m_post(m_executor, std::move(task));
+            }
+
+        private:
+            template <typename E>
+            static void post_impl(void* e, std::function<void()> task)
+            {
+                static_cast<E*>(e)->post(std::move(task));
+            }
+            template <typename E>
+            static std::size_t size_impl(const void* e)
+            {
+                return static_cast<std::size_t>(
+                    static_cast<const E*>(e)->size());
+            }
+
+            void* m_executor{nullptr};
+            void (*m_post)(void*, std::function<void()>){nullptr};
+            std::size_t (*m_size)(const void*){nullptr};
+        };
+
+        struct options {
+            static constexpr std::size_t default_serial_threshold = 32 * 1024;
+
+            // Number of elements in a chunk. If 0, chosen so that every
+            // thread gets several chunks, of at least min_grain_size
+            // elements.
+            std::size_t grain_size{0};
+            // Ranges shorter than this are processed on the calling thread
+            std::size_t serial_threshold{default_serial_threshold};
+            // If empty, default_thread_pool() is used
+            executor_ref executor{};
+        };
+    }  // namespace par
+
+    namespace detail {
+        namespace par {
+            constexpr std::size_t min_grain_size = 4096;
+            constexpr std::size_t chunks_per_thread = 16;
+            constexpr std::size_t cache_line_size = 64;
+
+            template <typename R, bool = range<R>::value>
+            struct is_parallel_range : std::false_type {
+            };
+            template <typename R>
+            struct is_parallel_range<R, true>
+                : std::integral_constant<
+                      bool,
+                      random_access_iterator<iterator_t<R>>::value &&
+                          sized_range<R>::value> {
+            };
+
+            // An object on a cache line of its own, if it's at the start
+            // of one, so that writing to it doesn't slow down other
+            // threads accessing the neighbouring members
+            template <typename T>
+            struct cache_line_padded {
+                T value;
+                char padding[cache_line_size - sizeof(T) % cache_line_size];
+            };
+
+            // A range of chunk indices
+            struct chunk_range {
+                std::size_t begin;
+                std::size_t end;
+            };
+
+            // A Chase-Lev work-stealing deque of chunk ranges. The owner
+            // pushes and takes at the bottom; other threads steal from the
+            // top.
+            //
+            // The capacity is fixed: the owner only pushes the second half
+            // of a range it's splitting, so the deque holds at most one range
+            // for every halving of the chunk count.
+            class chunk_deque {
+            public:
+                static constexpr std::size_t capacity =
+                    std::numeric_limits<std::size_t>::digits;
+
+                void push(chunk_range r)
+                {
+                    const auto b =
+                        m_bottom.value.load(std::memory_order_relaxed);
+                    PICORANGE_EXPECT(
+                        b - m_top.value.load(std::memory_order_relaxed) <
+                        static_cast<std::ptrdiff_t>(capacity));
+                    auto& slot = m_slots[static_cast<std::size_t>(b) %
+                                         capacity];
+                    slot.begin.store(r.begin, std::memory_order_relaxed);
+                    slot.end.store(r.end, std::memory_order_relaxed);
+                    m_bottom.value.store(b + 1, std::memory_order_release);
+                }
+
+                bool take(chunk_range& r)
+                {
+                    const auto b =
+                        m_bottom.value.load(std::memory_order_relaxed) - 1;
+                    m_bottom.value.store(b, std::memory_order_seq_cst);
+                    auto t = m_top.value.load(std::memory_order_seq_cst);
+                    if (t > b) {
+                        m_bottom.value.store(b + 1, std::memory_order_relaxed);
+                        return false;
+                    }
+                    r = load(b);
+                    if (t == b) {
+                        // Last one: race against thieves for it
+                        const bool won = m_top.value.compare_exchange_strong(
+                            t, t + 1, std::memory_order_seq_cst,
+                            std::memory_order_relaxed);
+                        m_bottom.value.store(b + 1, std::memory_order_relaxed);
+                        return won;
+                    }
+                    return true;
+                }
+
+                bool steal(chunk_range& r)
+                {
+                    auto t = m_top.value.load(std::memory_order_seq_cst);
+                    const auto b =
+                        m_bottom.value.load(std::memory_order_seq_cst);
+                    if (t >= b) {
+                        return false;
+                    }
+                    r = load(t);
+                    return m_top.value.compare_exchange_strong(
+                        t, t + 1, std::memory_order_seq_cst,
+                        std::memory_order_relaxed);
+                }
+
+            private:
+                struct slot_type {
+                    std::atomic<std::size_t> begin{0};
+                    std::atomic<std::size_t> end{0};
+                };
+
+                chunk_range load(std::ptrdiff_t i) const
+                {
+                    const auto& slot =
+                        m_slots[static_cast<std::size_t>(i) % capacity];
+                    return {slot.begin.load(std::memory_order_relaxed),
+                            slot.end.load(std::memory_order_relaxed)};
+                }
+
+                // Thieves write to m_top, and the owner to m_bottom.
+                // Not alignas, because over-aligned allocation isn't
+                // supported before C++17.
+                cache_line_padded<std::atomic<std::ptrdiff_t>> m_top{{0}, {}};
+                cache_line_padded<std::atomic<std::ptrdiff_t>> m_bottom{{0},
+                                                                        {}};
+                slot_type m_slots[capacity];
+            };
+
+            // The chunks of one call are divided between the calling
+            // thread and up to one task per executor thread, each with
+            // its own chunk_deque. A participant splits the ranges it takes
+            // in half until one chunk is left, keeping the first half, and
+            // pushing the second one to its deque. When its deque is empty,
+            // it steals from the others, taking the largest ranges they
+            // have left.
+            //
+            // The caller returns when every chunk is done, even if some
+            // tasks haven't started yet: those find every chunk started,
+            // and return, which is why the state is shared with them.
+            class steal_state {
+            public:
+                using chunk_fn =
+                    void (*)(void*, std::size_t, std::size_t, std::size_t);
+
+                steal_state(std::size_t n,
+                            std::size_t grain,
+                            std::size_t participants,
+                            chunk_fn fn,
+                            void* fn_data)
+                    : m_size(n),
+                      m_grain(grain),
+                      m_chunks((n + grain - 1) / grain),
+                      m_participants(participants),
+                      m_deques(new chunk_deque[participants]),
+                      m_fn(fn),
+                      m_fn_data(fn_data)
+                {
+                    m_deques[0].push({0, m_chunks});
+                }
+
+                // For the tasks given to the executor
+                void join()
+                {
+                    const auto self =
+                        m_next_participant.fetch_add(1,
+                                                     std::memory_order_relaxed);
+                    if (self < m_participants) {
+                        work(self);
+                    }
+                }
+
+                // For the calling thread
+                void run()
+                {
+                    work(0);
+
+                    std::unique_lock<std::mutex> lock{m_mutex};
+                    m_cv.wait(lock, [this] {
+                        return m_done.load(std::memory_order_acquire) ==
+                               m_chunks;
+                    });
+                    if (m_error) {
+                        std::rethrow_exception(m_error);
+                    }
+                }
+
+            private:
+                void work(std::size_t self)
+                {
+                    chunk_range r;
+                    while (next_range(self, r)) {
+                        while (r.end - r.begin > 1) {
+                            const auto mid = r.begin + (r.end - r.begin) / 2;
+                            m_deques[self].push({mid, r.end});
+                            r.end = mid;
+                        }
+                        m_started.fetch_add(1, std::memory_order_relaxed);
+                        run_chunk(r.begin);
+                    }
+                }
+
+                bool next_range(std::size_t self, chunk_range& r)
+                {
+                    if (m_deques[self].take(r)) {
+                        return true;
+                    }
+                    // Until every chunk has been started, more ranges may
+                    // still be pushed
+                    while (m_started.load(std::memory_order_relaxed) !=
+                           m_chunks) {
+                        for (std::size_t i = 1; i < m_participants; ++i) {
+                            const auto victim = (self + i) % m_participants;
+                            if (m_deques[victim].steal(r)) {
+                                return true;
+                            }
+                        }
+                        std::this_thread::yield();
+                    }
+                    return false;
+                }
+
+                void run_chunk(std::size_t c)
+                {
+                    if (!m_failed.load(std::memory_order_relaxed)) {
+                        const auto b = c * m_grain;
+                        const auto e =
+                            m_size - b < m_grain ? m_size : b + m_grain;
+                        try {
+                            m_fn(m_fn_data, c, b, e);
+                        }
+                        catch (...) {
+                            std::lock_guard<std::mutex> lock{m_mutex};
+                            if (!m_error) {
+                                m_error = std::current_exception();
+                            }
+                            m_failed.store(true, std::memory_order_relaxed);
+                        }
+                    }
+                    if (m_done.fetch_add(1, std::memory_order_acq_rel) + 1 ==
+                        m_chunks) {
+                        std::lock_guard<std::mutex> lock{m_mutex};
+                        m_cv.notify_all();
+                    }
+                }
+
+                std::size_t m_size;
+                std::size_t m_grain;
+                std::size_t m_chunks;
+                std::size_t m_participants;
+                std::unique_ptr<chunk_deque[]> m_deques;
+                chunk_fn m_fn;
+                void* m_fn_data;
+
+                std::atomic<std::size_t> m_next_participant{1};
+                std::atomic<std::size_t> m_started{0};
+                std::atomic<std::size_t> m_done{0};
+                std::atomic<bool> m_failed{false};
+                std::mutex m_mutex;
+                std::condition_variable m_cv;
+                std::exception_ptr m_error{};
+            };
+
+            template <typename F>
+            void call_chunk_fn(void* fn,
+                               std::size_t index,
+                               std::size_t b,
+                               std::size_t e)
+            {
+                (*static_cast<F*>(fn))(index, b, e);
+            }
+
+            // Grain size for n elements of type T, rounded up to a
+            // multiple of a cache line, so that neighbouring chunks of
+            // contiguous ranges don't share one
+            template <typename T>
+            std::size_t grain_size(const ::picorange::par::options& opt,
+                                   std::size_t n,
+                                   std::size_t threads)
+            {
+                auto grain = opt.grain_size;
+                if (grain == 0) {
+                    grain = n / (threads * chunks_per_thread);
+                    grain = grain < min_grain_size ? min_grain_size : grain;
+                }
+                const auto per_line = sizeof(T) < cache_line_size
+                                          ? cache_line_size / sizeof(T)
+                                          : std::size_t{1};
+                return (grain + per_line - 1) / per_line * per_line;
+            }
+
+            // How [0, n) is divided into chunks
+            struct chunk_plan {
+                ::picorange::par::executor_ref executor;
+                std::size_t size;
+                std::size_t grain;
+                std::size_t chunks;
+            };
+
+            // Below the serial threshold, or without executor threads, the
+            // whole range is one chunk
+            template <typename T>
+            chunk_plan plan_chunks(const ::picorange::par::options& opt,
+                                   std::size_t n)
+            {
+                const auto executor =
+                    opt.executor ? opt.executor
+                                 : ::picorange::par::executor_ref{
+                                       ::picorange::par::default_thread_pool()};
+                const auto threads = executor.size() + 1;
+                if (n == 0) {
+                    return {executor, n, 1, 0};
+                }
+                if (n < opt.serial_threshold || threads == 1) {
+                    return {executor, n, n, 1};
+                }
+                const auto grain = par::grain_size<T>(opt, n, threads);
+                if (grain >= n) {
+                    return {executor, n, n, 1};
+                }
+                return {executor, n, grain, (n + grain - 1) / grain};
+            }
+
+            // Calls fn(chunk_index, begin, end) for every chunk, possibly
+            // concurrently. A single chunk is run on the calling thread.
+            template <typename F>
+            void for_each_chunk(const chunk_plan& plan, F& fn)
+            {
+                if (plan.chunks == 0) {
+                    return;
+                }
+                if (plan.chunks == 1) {
+                    fn(std::size_t{0}, std::size_t{0}, plan.size);
+                    return;
+                }
+
+                const auto threads = plan.executor.size();
+                const auto helpers =
+                    plan.chunks - 1 < threads ? plan.chunks - 1 : threads;
+                auto state = std::make_shared<steal_state>(
+                    plan.size, plan.grain, helpers + 1, &call_chunk_fn<F>,
+                    static_cast<void*>(std::addressof(fn)));
+                for (std::size_t i = 0; i < helpers; ++i) {
+                    plan.executor.post([state] { state->join(); });
+                }
+                state->run();
+            }
+
+            template <typename T, typename F>
+            void for_each_chunk(const ::picorange::par::options& opt,
+                                std::size_t n,
+                                F& fn)
+            {
+                par::for_each_chunk(par::plan_chunks<T>(opt, n), fn);
+            }
+
+            // Per-chunk results, constructed in any order
+            template <typename T>
+            class partial_results {
+            public:
+                explicit partial_results(std::size_t n)
+                    : m_slots(new slot[n]), m_size(n)
+                {
+                }
+
+                partial_results(const partial_results&) = delete;
+                partial_results& operator=(const partial_results&) = delete;
+
+                ~partial_results()
+                {
+                    for (std::size_t i = 0; i < m_size; ++i) {
+                        if (m_slots[i].engaged) {
+                            get(i).~T();
+                        }
+                    }
+                }
+
+                template <typename U>
+                void emplace(std::size_t i, U&& value)
+                {
+                    ::new (static_cast<void*>(&m_slots[i].storage))
+                        T(std::forward<U>(value));
+                    m_slots[i].engaged = true;
+                }
+
+                T& get(std::size_t i)
+                {
+                    return *static_cast<T*>(
+                        static_cast<void*>(&m_slots[i].storage));
+                }
+
+            private:
+                struct slot {
+                    typename std::aligned_storage<sizeof(T), alignof(T)>::type
+                        storage;
+                    bool engaged{false};
+                };
+
+                std::unique_ptr<slot[]> m_slots;
+                std::size_t m_size;
+            };
+
+            struct plus {
+                template <typename T, typename U>
+                constexpr auto operator()(T&& a, U&& b) const
+                    -> decltype(std::forward<T>(a) + std::forward<U>(b))
+                {
+                    return std::forward<T>(a) + std::forward<U>(b);
+                }
+            };
+
+            struct identity {
+                template <typename T>
+                constexpr T&& operator()(T&& t) const noexcept
+                {
+                    return std::forward<T>(t);
+                }
+            };
+
+            template <typename R>
+            std::size_t range_size(R& r)
+            {
+                return static_cast<std::size_t>(::picorange::size(r));
+            }
+
+            template <typename I>
+            I at(I first, std::size_t i)
+            {
+                ::picorange::advance(first,
+                                     static_cast<iter_difference_t<I>>(i));
+                return first;
+            }
+
+            template <typename R, typename T, typename BinaryOp, typename F>
+            T transform_reduce(const ::picorange::par::options& opt,
+                               R& r,
+                               T init,
+                               BinaryOp& op,
+                               F& f)
+            {
+                const auto first = ::picorange::begin(r);
+                const auto n = par::range_size(r);
+                if (n == 0) {
+                    return init;
+                }
+
+                const auto plan =
+                    par::plan_chunks<iter_value_t<iterator_t<R>>>(opt, n);
+                partial_results<T> partials{plan.chunks};
+
+                auto fn = [&](std::size_t c, std::size_t b, std::size_t e) {
+                    auto it = par::at(first, b);
+                    T acc(f(*it));
+                    for (++b, ++it; b != e; ++b, ++it) {
+                        acc = op(std::move(acc), f(*it));
+                    }
+                    partials.emplace(c, std::move(acc));
+                };
+                par::for_each_chunk(plan, fn);
+
+                for (std::size_t c = 0; c < plan.chunks; ++c) {
+                    init = op(std::move(init), std::move(partials.get(c)));
+                }
+                return init;
+            }
+        }  // namespace par
+    }      // namespace detail
+
+    namespace par {
+        // for_each
+        namespace _for_each {
+            struct fn {
+                template <typename R,
+                          typename F,
+                          typename std::enable_if<
+                              detail::par::is_parallel_range<R>::value>::type* =
+                              nullptr>
+                void operator()(const options& opt, R&& r, F f) const
+                {
+                    const auto first = ::picorange::begin(r);
+                    auto chunk = [&](std::size_t, std::size_t b,
+                                     std::size_t e) {
+                        auto it = detail::par::at(first, b);
+                        for (; b != e; ++b, ++it) {
+                            f(*it);
+                        }
+                    };
+                    detail::par::for_each_chunk<iter_value_t<iterator_t<R>>>(
+                        opt, detail::par::range_size(r), chunk);
+                }
+
+                template <typename R,
+                          typename F,
+                          typename std::enable_if<
+                              detail::par::is_parallel_range<R>::value>::type* =
+                              nullptr>
+                void operator()(R&& r, F f) const
+                {
+                    (*this)(options{}, r, std::move(f));
+                }
+            };
+        }  // namespace _for_each
+        namespace {
+            constexpr auto& for_each = static_const<_for_each::fn>::value;
+        }
+
+        // transform
+        namespace _transform {
+            struct fn {
+                template <typename R,
+                          typename O,
+                          typename F,
+                          typename std::enable_if<
+                              detail::par::is_parallel_range<R>::value &&
+                              random_access_iterator<O>::value>::type* =
+                              nullptr>
+                in_out_result<iterator_t<R>, O> operator()(const options& opt,
+                                                           R&& r,
+                                                           O out,
+                                                           F f) const
+                {
+                    const auto first = ::picorange::begin(r);
+                    const auto n = detail::par::range_size(r);
+                    auto chunk = [&](std::size_t, std::size_t b,
+                                     std::size_t e) {
+                        auto it = detail::par::at(first, b);
+                        auto o = detail::par::at(out, b);
+                        for (; b != e; ++b, ++it, ++o) {
+                            *o = f(*it);
+                        }
+                    };
+                    detail::par::for_each_chunk<iter_value_t<O>>(opt, n,
+                                                                 chunk);
+                    return {detail::par::at(first, n),
+                            detail::par::at(out, n)};
+                }
+
+                template <typename R,
+                          typename O,
+                          typename F,
+                          typename std::enable_if<
+                              detail::par::is_parallel_range<R>::value &&
+                              random_access_iterator<O>::value>::type* =
+                              nullptr>
+                in_out_result<iterator_t<R>, O> operator()(R&& r,
+                                                           O out,
+                                                           F f) const
+                {
+                    return (*this)(options{}, r, std::move(out),
+                                   std::move(f));
+                }
+            };
+        }  // namespace _transform
+        namespace {
+            constexpr auto& transform = static_const<_transform::fn>::value;
+        }
+
+        // transform_reduce
+        //
+        // Chunks are reduced separately, and their results are combined
+        // in order, so op must be associative, but not commutative.
+        namespace _transform_reduce {
+            struct fn {
+                template <typename R,
+                          typename T,
+                          typename BinaryOp,
+                          typename F,
+                          typename std::enable_if<
+                              detail::par::is_parallel_range<R>::value>::type* =
+                              nullptr>
+                T operator()(const options& opt,
+                             R&& r,
+                             T init,
+                             BinaryOp op,
+                             F f) const
+                {
+                    return detail::par::transform_reduce(opt, r,
+                                                         std::move(init), op,
+                                                         f);
+                }
+
+                template <typename R,
+                          typename T,
+                          typename BinaryOp,
+                          typename F,
+                          typename std::enable_if<
+                              detail::par::is_parallel_range<R>::value>::type* =
+                              nullptr>
+                T operator()(R&& r, T init, BinaryOp op, F f) const
+                {
+                    return detail::par::transform_reduce(
+                        options{}, r, std::move(init), op, f);
+                }
+            };
+        }  // namespace _transform_reduce
+        namespace {
+            constexpr auto& transform_reduce =
+                static_const<_transform_reduce::fn>::value;
+        }
+
+        // reduce
+        namespace _reduce {
+            struct fn {
+                template <typename R,
+                          typename T,
+                          typename BinaryOp = detail::par::plus,
+                          typename std::enable_if<
+                              detail::par::is_parallel_range<R>::value>::type* =
+                              nullptr>
+                T operator()(const options& opt,
+                             R&& r,
+                             T init,
+                             BinaryOp op = BinaryOp{}) const
+                {
+                    detail::par::identity f{};
+                    return detail::par::transform_reduce(opt, r,
+                                                         std::move(init), op,
+                                                         f);
+                }
+
+                template <typename R,
+                          typename T,
+                          typename BinaryOp = detail::par::plus,
+                          typename std::enable_if<
+                              detail::par::is_parallel_range<R>::value>::type* =
+                              nullptr>
+                T operator()(R&& r, T init, BinaryOp op = BinaryOp{}) const
+                {
+                    return (*this)(options{}, r, std::move(init),
+                                   std::move(op));
+                }
+            };
+        }  // namespace _reduce
+        namespace {
+            constexpr auto& reduce = static_const<_reduce::fn>::value;
+        }
+
+        // count_if
+        //
+        // Chunks are counted with picorange::count_if, so contiguous byte
+        // ranges use its SIMD kernels.
+        namespace _count_if {
+            struct fn {
+                template <typename R,
+                          typename Pred,
+                          typename std::enable_if<
+                              detail::par::is_parallel_range<R>::value>::type* =
+                              nullptr>
+                range_difference_t<R> operator()(const options& opt,
+                                                 R&& r,
+                                                 Pred pred) const
+                {
+                    using difference_type = range_difference_t<R>;
+
+                    const auto first = ::picorange::begin(r);
+                    std::atomic<difference_type> result{0};
+                    auto chunk = [&](std::size_t, std::size_t b,
+                                     std::size_t e) {
+                        const auto c = ::picorange::count_if(
+                            detail::par::at(first, b),
+                            detail::par::at(first, e), pred);
+                        result.fetch_add(c, std::memory_order_relaxed);
+                    };
+                    detail::par::for_each_chunk<range_value_t<R>>(
+                        opt, detail::par::range_size(r), chunk);
+                    return result.load(std::memory_order_relaxed);
+                }
+
+                template <typename R,
+                          typename Pred,
+                          typename std::enable_if<
+                              detail::par::is_parallel_range<R>::value>::type* =
+                              nullptr>
+                range_difference_t<R> operator()(R&& r, Pred pred) const
+                {
+                    return (*this)(options{}, r, std::move(pred));
+                }
+            };
+        }  // namespace _count_if
+        namespace {
+            constexpr auto& count_if = static_const<_count_if::fn>::value;
+        }
+
+        // find_if
+        //
+        // Returns the first match, like the serial version. Chunks are
+        // searched with picorange::find_if, and chunks after an already
+        // found match are skipped.
+        namespace _find_if {
+            struct fn {
+                template <typename R,
+                          typename Pred,
+                          typename std::enable_if<
+                              detail::par::is_parallel_range<R>::value>::type* =
+                              nullptr>
+                iterator_t<R> operator()(const options& opt,
+                                         R&& r,
+                                         Pred pred) const
+                {
+                    const auto first = ::picorange::begin(r);
+                    const auto n = detail::par::range_size(r);
+                    std::atomic<std::size_t> found{n};
+                    auto chunk = [&](std::size_t, std::size_t b,
+                                     std::size_t e) {
+                        if (found.load(std::memory_order_relaxed) < b) {
+                            return;
+                        }
+                        const auto cb = detail::par::at(first, b);
+                        const auto ce = detail::par::at(first, e);
+                        const auto it = ::picorange::find_if(cb, ce, pred);
+                        if (it == ce) {
+                            return;
+                        }
+                        const auto i = b + static_cast<std::size_t>(it - cb);
+                        auto cur = found.load(std::memory_order_relaxed);
+                        while (i < cur && !found.compare_exchange_weak(
+                                              cur, i,
+                                              std::memory_order_relaxed)) {
+                        }
+                    };
+                    detail::par::for_each_chunk<range_value_t<R>>(opt, n,
+                                                                  chunk);
+                    return detail::par::at(first, found.load());
+                }
+
+                template <typename R,
+                          typename Pred,
+                          typename std::enable_if<
+                              detail::par::is_parallel_range<R>::value>::type* =
+                              nullptr>
+                iterator_t<R> operator()(R&& r, Pred pred) const
+                {
+                    return (*this)(options{}, r, std::move(pred));
+                }
+            };
+        }  // namespace _find_if
+        namespace {
+            constexpr auto& find_if = static_const<_find_if::fn>::value;
+        }
+    }  // namespace par
+
+    // pipeline_stage_view
+    struct pipeline_stage_options {
+        // Number of elements handed over at a time
+        std::size_t batch_size{1024};
+        // Number of batches the producer can be ahead by
+        std::size_t queue_size{4};
+    };
+
+    namespace detail {
+        // Shared by a pipeline_stage_view and its copies.
+        //
+        // The producer thread fills batches of elements from the underlying
+        // view into a ring of queue_size batches. The ring is a lock-free
+        // single-producer, single-consumer queue: m_tail is only written by
+        // the producer and m_head by the consumer. A thread that has to
+        // wait for the other one spins for a while, and then sleeps on
+        // m_cv; the other one only takes the mutex if it has sleepers.
+        // The batch vectors are reused, so their storage is allocated once.
+        template <typename V>
+        class pipeline_stage_state {
+        public:
+            using value_type = range_value_t<V>;
+            using batch_type = std::vector<value_type>;
+
+            pipeline_stage_state(V base, const pipeline_stage_options& opt)
+                : m_base(std::move(base)),
+                  m_batch_size(opt.batch_size != 0 ? opt.batch_size : 1),
+                  m_batches(opt.queue_size != 0 ? opt.queue_size : 1)
+            {
+            }
+
+            pipeline_stage_state(const pipeline_stage_state&) = delete;
+            pipeline_stage_state& operator=(const pipeline_stage_state&) =
+                delete;
+
+            ~pipeline_stage_state()
+            {
+                if (m_thread.joinable()) {
+                    m_stop.store(true, std::memory_order_seq_cst);
+                    wake();
+                    m_thread.join();
+                }
+            }
+
+            void start()
+            {
+                if (!m_started) {
+                    m_started = true;
+                    m_thread = std::thread{[this] { produce(); }};
+                }
+            }
+
+            // Consumer side
+
+            bool at_end()
+            {
+                fill_if_empty();
+                return m_batch == nullptr;
+            }
+
+            value_type& current()
+            {
+                fill_if_empty();
+                PICORANGE_EXPECT(m_batch != nullptr);
+                return (*m_batch)[m_pos];
+            }
+
+            subrange<value_type*> chunk()
+            {
+                if (at_end()) {
+                    return {};
+                }
+                return {m_batch->data() + m_pos,
+                        m_batch->data() + m_batch->size()};
+            }
+
+            // Hands a used up batch back to the producer, but doesn't wait
+            // for the next one, so that reading the last element produced
+            // so far doesn't block
+            void consume(std::size_t n)
+            {
+                PICORANGE_EXPECT(m_batch != nullptr &&
+                                 n <= m_batch->size() - m_pos);
+                m_pos += n;
+                if (m_pos == m_batch->size()) {
+                    m_batch = nullptr;
+                    m_head.value.store(
+                        m_head.value.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_seq_cst);
+                    wake();
+                }
+            }
+
+        private:
+            static constexpr int spin_count = 64;
+
+            // Waits for the next batch, if there is none. Batches are never
+            // empty, so no batch after this means the end of input.
+            void fill_if_empty()
+            {
+                if (m_batch != nullptr || m_finished) {
+                    return;
+                }
+                const auto head = m_head.value.load(std::memory_order_relaxed);
+                wait([this, head] {
+                    return m_tail.value.load(std::memory_order_seq_cst) !=
+                               head ||
+                           m_done.load(std::memory_order_seq_cst);
+                });
+                if (m_tail.value.load(std::memory_order_seq_cst) != head) {
+                    m_batch = &m_batches[head % m_batches.size()];
+                    m_pos = 0;
+                    return;
+                }
+                m_finished = true;
+                if (m_error) {
+                    auto e = std::move(m_error);
+                    m_error = nullptr;
+                    std::rethrow_exception(e);
+                }
+            }
+
+            // Producer side
+
+            void produce()
+            {
+                const auto capacity = m_batches.size();
+                auto tail = m_tail.value.load(std::memory_order_relaxed);
+                batch_type* batch = nullptr;
+                try {
+                    auto it = ::picorange::begin(m_base);
+                    const auto last = ::picorange::end(m_base);
+                    while (it != last) {
+                        wait([this, tail, capacity] {
+                            return m_stop.load(std::memory_order_seq_cst) ||
+                                   tail - m_head.value.load(
+                                              std::memory_order_seq_cst) <
+                                       capacity;
+                        });
+                        if (m_stop.load(std::memory_order_seq_cst)) {
+                            break;
+                        }
+
+                        batch = &m_batches[tail % capacity];
+                        batch->clear();
+                        batch->reserve(m_batch_size);
+                        // A full batch is handed over before waiting for
+                        // more input
+                        for (; batch->size() < m_batch_size && it != last;
+                             ++it) {
+                            batch->emplace_back(*it);
+                        }
+                        batch = nullptr;
+                        m_tail.value.store(++tail, std::memory_order_seq_cst);
+                        wake();
+                    }
+                }
+                catch (...) {
+                    m_error = std::current_exception();
+                    // The elements before the exception are still handed
+                    // over
+                    if (batch != nullptr && !batch->empty()) {
+                        m_tail.value.store(++tail, std::memory_order_seq_cst);
+                    }
+                }
+                m_done.store(true, std::memory_order_seq_cst);
+                wake();
+            }
+
+            template <typename Pred>
+            void wait(Pred pred)
+            {
+                for (int i = 0; i < spin_count; ++i) {
+                    if (pred()) {
+                        return;
+                    }
+                    std::this_thread::yield();
+                }
+                std::unique_lock<std::mutex> lock{m_mutex};
+                m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+                m_cv.wait(lock, pred);
+                m_sleepers.fetch_sub(1, std::memory_order_seq_cst);
+            }
+
+            void wake()
+            {
+                if (m_sleepers.load(std::memory_order_seq_cst) != 0) {
+                    std::lock_guard<std::mutex> lock{m_mutex};
+                    m_cv.notify_all();
+                }
+            }
+
+            V m_base;
+            std::size_t m_batch_size;
+            std::vector<batch_type> m_batches;
+
+            // Consumer only
+            batch_type* m_batch{nullptr};
+            std::size_t m_pos{0};
+            bool m_started{false};
+            bool m_finished{false};
+
+            par::cache_line_padded<std::atomic<std::size_t>> m_head{{0}, {}};
+            par::cache_line_padded<std::atomic<std::size_t>> m_tail{{0}, {}};
+            std::atomic<bool> m_done{false};
+            std::atomic<bool> m_stop{false};
+            std::exception_ptr m_error{};
+
+            std::atomic<int> m_sleepers{0};
+            std::mutex m_mutex;
+            std::condition_variable m_cv;
+            std::thread m_thread;
+        };
+    }  // namespace detail
+
+    // An input view over the elements of V, which are computed by another
+    // thread, ahead of the consumer. Cuts an adaptor chain into stages that
+    // run concurrently:
+    //
+    //     auto rows = input | views::transform(decompress) |
+    //                 views::pipeline_stage | views::filter(is_valid) |
+    //                 views::transform(parse) | views::pipeline_stage;
+    //
+    // The producer thread starts on the first call to begin(), and is
+    // stopped and joined when the view and all its copies are destroyed.
+    // Elements are copied, or moved from rvalue references, into batches;
+    // the consumer sees them as lvalues, and may move from them. An
+    // exception thrown by the producer is rethrown to the consumer after
+    // the elements before it.
+    //
+    // Like fd_input_range, the elements of the current batch are available
+    // at once with chunk(), and can be skipped with consume().
+    template <typename V>
+    class pipeline_stage_view
+        : public view_interface<pipeline_stage_view<V>> {
+        using state_type = detail::pipeline_stage_state<V>;
+
+    public:
+        using value_type = range_value_t<V>;
+
+        class iterator {
+        public:
+            using value_type = range_value_t<V>;
+            using difference_type = std::ptrdiff_t;
+            using reference = value_type&;
+            using pointer = value_type*;
+            using iterator_category = input_iterator_tag;
+
+            iterator() = default;
+            explicit iterator(state_type* s) noexcept : m_state(s) {}
+
+            reference operator*() const
+            {
+                return m_state->current();
+            }
+            pointer operator->() const
+            {
+                return std::addressof(m_state->current());
+            }
+
+            iterator& operator++()
+            {
+                m_state->consume(1);
+                return *this;
+            }
+            void operator++(int)
+            {
+                ++*this;
+            }
+
+            friend bool operator==(const iterator& i,
+                                   default_sentinel_t)
+            {
+                return i.at_end();
+            }
+            friend bool operator==(default_sentinel_t,
+                                   const iterator& i)
+            {
+                return i.at_end();
+            }
+            friend bool operator!=(const iterator& i,
+                                   default_sentinel_t)
+            {
+                return !i.at_end();
+            }
+            friend bool operator!=(default_sentinel_t,
+                                   const iterator& i)
+            {
+                return !i.at_end();
+            }
+
+        private:
+            bool at_end() const
+            {
+                return !m_state || m_state->at_end();
+            }
+
+            state_type* m_state{nullptr};
+        };
+
+        pipeline_stage_view() = default;
+        explicit pipeline_stage_view(V base,
+                                     const pipeline_stage_options& opt = {})
+            : m_state(std::make_shared<state_type>(std::move(base), opt))
+        {
+        }
+
+        iterator begin()
+        {
+            PICORANGE_EXPECT(m_state != nullptr);
+            m_state->start();
+            return iterator{m_state.get()};
+        }
+        default_sentinel_t end() const noexcept
+        {
+            return {};
+        }
+
+        // The rest of the current batch. Empty only at the end of input.
+        subrange<value_type*> chunk()
+        {
+            PICORANGE_EXPECT(m_state != nullptr);
+            m_state->start();
+            return m_state->chunk();
+        }
+        // Marks the first n elements of chunk() as read
+        void consume(std::size_t n)
+        {
+            PICORANGE_EXPECT(m_state != nullptr);
+            m_state->consume(n);
+        }
+
+    private:
+        std::shared_ptr<state_type> m_state{};
+    };
+
+    namespace views {
+        namespace _pipeline_stage {
+            struct fn {
+                fn() = default;
+                constexpr explicit fn(const pipeline_stage_options& opt)
+                    : m_options(opt)
+                {
+                }
+
+                template <typename R>
+                auto operator()(R&& r) const -> pipeline_stage_view<all_t<R>>
+                {
+                    return pipeline_stage_view<all_t<R>>{
+                        ::picorange::views::all(std::forward<R>(r)),
+                        m_options};
+                }
+
+                // Returns a stage with the given options
+                constexpr auto operator()(
+                    const pipeline_stage_options& opt) const
+                    -> detail::range_adaptor_closure<fn>
+                {
+                    return detail::range_adaptor_closure<fn>{fn{opt}};
+                }
+
+                pipeline_stage_options m_options{};
+            };
+        }  // namespace _pipeline_stage
+        namespace {
+            constexpr auto& pipeline_stage = static_const<
+                detail::range_adaptor_closure<_pipeline_stage::fn>>::value;
+        }
+    }  // namespace views
+
+    PICORANGE_END_NAMESPACE
+}  // namespace picorange
+
+#endif  // PICORANGE_PARALLEL_H
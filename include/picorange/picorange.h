@@ -30,6 +30,7 @@
 #define PICORANGE_STD_11 201103L
 #define PICORANGE_STD_14 201402L
 #define PICORANGE_STD_17 201703L
+#define PICORANGE_STD_20 202002L
 
 #define PICORANGE_COMPILER(major, minor, patch) \
     ((major)*10000000 /* 10,000,000 */ + (minor)*10000 /* 10,000 */ + (patch))
@@ -249,6 +250,34 @@
 #define PICORANGE_CONSTEXPR14 inline
 #endif
 
+// Detect concepts
+// Define to 0 to force the SFINAE-based concept emulation in C++20
+#ifndef PICORANGE_HAS_CONCEPTS
+#if defined(__cpp_concepts) && __cpp_concepts >= 201907L && \
+    PICORANGE_STD >= PICORANGE_STD_20
+#define PICORANGE_HAS_CONCEPTS 1
+#else
+#define PICORANGE_HAS_CONCEPTS 0
+#endif
+#endif
+
+// Opt-in: forward to <ranges> when the standard library has it
+#ifndef PICORANGE_USE_STD_RANGES
+#define PICORANGE_USE_STD_RANGES 0
+#endif
+
+#if PICORANGE_USE_STD_RANGES && PICORANGE_HAS_CONCEPTS && \
+    PICORANGE_HAS_INCLUDE(<ranges>)
+#include <ranges>
+#endif
+
+#if PICORANGE_USE_STD_RANGES && PICORANGE_HAS_CONCEPTS && \
+    defined(__cpp_lib_ranges) && __cpp_lib_ranges >= 201911L
+#define PICORANGE_STD_RANGES 1
+#else
+#define PICORANGE_STD_RANGES 0
+#endif
+
 // Detect [[nodiscard]]
 #if (PICORANGE_HAS_CPP_ATTRIBUTE(nodiscard) &&            \
      __cplusplus >= PICORANGE_STD_17) ||                  \
@@ -783,8 +812,12 @@ namespace picorange {
     using std::input_iterator_tag;
     using std::output_iterator_tag;
     using std::random_access_iterator_tag;
+#if PICORANGE_STD_RANGES
+    using std::contiguous_iterator_tag;
+#else
     struct contiguous_iterator_tag : random_access_iterator_tag {
     };
+#endif
 
     template <typename T>
     struct iterator_category;
@@ -812,6 +845,15 @@ namespace picorange {
     template <typename T>
     using iterator_category_t = typename iterator_category<T>::type;
 
+#if PICORANGE_STD_RANGES
+    using std::incrementable_traits;
+    template <typename T>
+    using readable_traits = std::indirectly_readable_traits<T>;
+
+    using std::iter_difference_t;
+    using std::iter_reference_t;
+    using std::iter_value_t;
+#else
     template <typename T>
     using iter_reference_t = decltype(*std::declval<T&>());
 
@@ -974,8 +1016,28 @@ namespace picorange {
 
     template <typename T>
     using iter_value_t = typename readable_traits<T>::value_type;
+#endif
 
     // sentinel_for
+#if PICORANGE_HAS_CONCEPTS
+    namespace concepts {
+#if PICORANGE_STD_RANGES
+        template <typename S, typename I>
+        concept sentinel_for = std::sentinel_for<S, I>;
+#else
+        template <typename S, typename I>
+        concept sentinel_for = std::is_default_constructible<S>::value &&
+                               std::is_copy_constructible<S>::value &&
+                               requires(S s, I i) {
+                                   ::picorange::valid_expr(*i, i == s, i != s);
+                               };
+#endif
+    }  // namespace concepts
+    template <typename S, typename I>
+    struct sentinel_for
+        : std::integral_constant<bool, concepts::sentinel_for<S, I>> {
+    };
+#else
     struct sentinel_for_concept {
         template <typename S, typename I>
         auto _test_requires(S s, I i)
@@ -989,8 +1051,32 @@ namespace picorange {
                   std::is_copy_constructible<S>::value &&
                   _requires<sentinel_for_concept, S, I>::value> {
     };
+#endif
 
     // sized_sentinel_for
+#if PICORANGE_HAS_CONCEPTS
+    namespace concepts {
+#if PICORANGE_STD_RANGES
+        template <typename S, typename I>
+        concept sized_sentinel_for = std::sized_sentinel_for<S, I>;
+#else
+        template <typename S, typename I>
+        concept sized_sentinel_for =
+            sentinel_for<S, I> && !std::is_same<S, void*>::value &&
+            !std::is_same<I, void*>::value &&
+            requires(const S& s, const I& i) {
+                requires std::is_same<decltype(s - i),
+                                      iter_difference_t<I>>::value;
+                requires std::is_same<decltype(i - s),
+                                      iter_difference_t<I>>::value;
+            };
+#endif
+    }  // namespace concepts
+    template <typename S, typename I>
+    struct sized_sentinel_for
+        : std::integral_constant<bool, concepts::sized_sentinel_for<S, I>> {
+    };
+#else
     struct sized_sentinel_for_concept {
         template <typename S, typename I>
         auto _test_requires(const S& s, const I& i) -> decltype(
@@ -1015,14 +1101,76 @@ namespace picorange {
     template <>
     struct sized_sentinel_for<void*, void*> : std::false_type {
     };
+#endif
 
     // begin
+#if PICORANGE_STD_RANGES
+    namespace {
+        constexpr auto& begin = std::ranges::begin;
+    }
+#else
     namespace _begin {
         template <typename T>
         void begin(T&&) = delete;
         template <typename T>
         void begin(std::initializer_list<T>&&) = delete;
 
+#if PICORANGE_HAS_CONCEPTS
+        template <typename T>
+        concept is_lvalue_array =
+            std::is_lvalue_reference<T>::value &&
+            std::is_array<typename std::remove_reference<T>::type>::value;
+
+        template <typename T>
+        concept has_member = !std::is_array<remove_cvref_t<T>>::value &&
+                             requires(T& t) { decay_copy(t.begin()); };
+
+        template <typename T>
+        concept has_adl = !std::is_array<remove_cvref_t<T>>::value &&
+                          requires(T&& t) {
+                              decay_copy(begin(std::forward<T>(t)));
+                          };
+
+        struct fn {
+        private:
+            // T& can only bind to lvalues and const rvalues
+            template <typename T>
+            static constexpr bool use_member =
+                has_member<T> &&
+                (std::is_lvalue_reference<T>::value ||
+                 std::is_const<typename std::remove_reference<T>::type>::value);
+
+            template <typename T>
+            static constexpr bool is_noexcept()
+            {
+                if constexpr (is_lvalue_array<T>) {
+                    return true;
+                }
+                else if constexpr (use_member<T>) {
+                    return noexcept(decay_copy(std::declval<T&>().begin()));
+                }
+                else {
+                    return noexcept(decay_copy(begin(std::declval<T>())));
+                }
+            }
+
+        public:
+            template <typename T>
+                requires is_lvalue_array<T> || use_member<T> || has_adl<T>
+            constexpr auto operator()(T&& t) const noexcept(is_noexcept<T>())
+            {
+                if constexpr (is_lvalue_array<T>) {
+                    return (t) + 0;
+                }
+                else if constexpr (use_member<T>) {
+                    return decay_copy(t.begin());
+                }
+                else {
+                    return decay_copy(begin(std::forward<T>(t)));
+                }
+            }
+        };
+#else
         struct fn {
         private:
             template <typename T, std::size_t N>
@@ -1065,12 +1213,19 @@ namespace picorange {
                 return fn::impl(std::forward<T>(t), priority_tag<3>{});
             }
         };
+#endif
     }  // namespace _begin
     namespace {
         constexpr auto& begin = static_const<_begin::fn>::value;
     }
+#endif
 
     // end
+#if PICORANGE_STD_RANGES
+    namespace {
+        constexpr auto& end = std::ranges::end;
+    }
+#else
     namespace _end {
         template <typename T>
         void end(T&&) = delete;
@@ -1123,8 +1278,14 @@ namespace picorange {
     namespace {
         constexpr auto& end = static_const<_end::fn>::value;
     }
+#endif
 
     // cbegin
+#if PICORANGE_STD_RANGES
+    namespace {
+        constexpr auto& cbegin = std::ranges::cbegin;
+    }
+#else
     namespace _cbegin {
         struct fn {
             template <typename T>
@@ -1147,8 +1308,14 @@ namespace picorange {
     namespace {
         constexpr auto& cbegin = static_const<_cbegin::fn>::value;
     }
+#endif
 
     // cend
+#if PICORANGE_STD_RANGES
+    namespace {
+        constexpr auto& cend = std::ranges::cend;
+    }
+#else
     namespace _cend {
         struct fn {
             template <typename T>
@@ -1171,8 +1338,40 @@ namespace picorange {
     namespace {
         constexpr auto& cend = static_const<_cend::fn>::value;
     }
+#endif
 
     // range
+#if PICORANGE_HAS_CONCEPTS
+    namespace concepts {
+#if PICORANGE_STD_RANGES
+        template <typename T>
+        concept range = std::ranges::range<T>;
+
+        template <typename T>
+        concept forwarding_range = std::ranges::borrowed_range<T>;
+#else
+        template <typename T>
+        concept range = requires(T& t) {
+            ::picorange::begin(t);
+            ::picorange::end(t);
+        };
+
+        template <typename T>
+        concept forwarding_range = range<T> && requires(T&& t) {
+            ::picorange::begin(std::forward<T>(t));
+            ::picorange::end(std::forward<T>(t));
+        };
+#endif
+    }  // namespace concepts
+    template <typename T>
+    struct range : std::integral_constant<bool, concepts::range<T>> {
+    };
+
+    template <typename T>
+    struct forwarding_range
+        : std::integral_constant<bool, concepts::forwarding_range<T>> {
+    };
+#else
     namespace detail {
         struct range_impl_concept {
             template <typename T>
@@ -1202,8 +1401,16 @@ namespace picorange {
                                  range<T>::value &&
                                      detail::range_impl<T>::value> {
     };
+#endif
 
     // typedefs
+#if PICORANGE_STD_RANGES
+    using std::ranges::iterator_t;
+    using std::ranges::range_difference_t;
+    using std::ranges::range_reference_t;
+    using std::ranges::range_value_t;
+    using std::ranges::sentinel_t;
+#else
     template <typename R>
     using iterator_t = typename std::enable_if<range<R>::value,
                                                decltype(::picorange::begin(
@@ -1224,8 +1431,16 @@ namespace picorange {
     using range_reference_t =
         typename std::enable_if<range<R>::value,
                                 iter_reference_t<iterator_t<R>>>::type;
+#endif
 
     // view
+#if PICORANGE_STD_RANGES
+    using std::ranges::view_base;
+    template <typename T>
+    struct enable_view_helper
+        : std::integral_constant<bool, std::ranges::enable_view<T>> {
+    };
+#else
     struct view_base {
     };
     namespace detail {
@@ -1235,20 +1450,44 @@ namespace picorange {
         template <typename T>
         struct is_std_non_view<std::initializer_list<T>> : std::true_type {
         };
+
+        // Lazy, so that ranges without a const begin() don't form
+        // range_reference_t<const T>
+        template <typename T, bool = range<T>::value && range<const T>::value>
+        struct has_same_const_reference : std::true_type {
+        };
+        template <typename T>
+        struct has_same_const_reference<T, true>
+            : std::is_same<range_reference_t<T>, range_reference_t<const T>> {
+        };
     }  // namespace detail
     template <typename T>
     struct enable_view_helper
-        : std::conditional<std::is_base_of<view_base, T>::value,
-                           std::true_type,
-                           typename std::conditional<
-                               detail::is_std_non_view<T>::value,
-                               std::false_type,
-                               typename std::conditional<
-                                   range<T>::value && range<const T>::value,
-                                   std::is_same<range_reference_t<T>,
-                                                range_reference_t<const T>>,
-                                   std::true_type>::type>::type>::type {
+        : std::conditional<
+              std::is_base_of<view_base, T>::value,
+              std::true_type,
+              typename std::conditional<
+                  detail::is_std_non_view<T>::value,
+                  std::false_type,
+                  detail::has_same_const_reference<T>>::type>::type {
+    };
+#endif
+#if PICORANGE_HAS_CONCEPTS
+    namespace concepts {
+#if PICORANGE_STD_RANGES
+        template <typename T>
+        concept view = std::ranges::view<T>;
+#else
+        template <typename T>
+        concept view = range<T> && std::is_copy_constructible<T>::value &&
+                       std::is_default_constructible<T>::value &&
+                       enable_view_helper<T>::value;
+#endif
+    }  // namespace concepts
+    template <typename T>
+    struct view : std::integral_constant<bool, concepts::view<T>> {
     };
+#else
     template <typename T>
     struct view
         : std::integral_constant<bool,
@@ -1257,6 +1496,7 @@ namespace picorange {
                                      std::is_default_constructible<T>::value &&
                                      enable_view_helper<T>::value> {
     };
+#endif
 
     // data
     namespace detail {
@@ -1269,6 +1509,11 @@ namespace picorange {
         };
     }  // namespace detail
 
+#if PICORANGE_STD_RANGES
+    namespace {
+        constexpr auto& data = std::ranges::data;
+    }
+#else
     namespace _data {
         struct fn {
         private:
@@ -1333,18 +1578,102 @@ namespace picorange {
     namespace {
         constexpr auto& data = static_const<_data::fn>::value;
     }
+#endif
 
     // size
+#if PICORANGE_STD_RANGES
+    // Specialize std::ranges::disable_sized_range instead
+    template <typename T>
+    struct disable_sized_range
+        : std::integral_constant<bool, std::ranges::disable_sized_range<T>> {
+    };
+#else
     template <typename>
     struct disable_sized_range : std::false_type {
     };
+#endif
 
+#if PICORANGE_STD_RANGES
+    namespace {
+        constexpr auto& size = std::ranges::size;
+    }
+#else
     namespace _size {
         template <typename T>
         void size(T&&) = delete;
         template <typename T>
         void size(T&) = delete;
 
+#if PICORANGE_HAS_CONCEPTS
+        template <typename T>
+        concept is_array = std::is_array<remove_cvref_t<T>>::value;
+
+        template <typename T>
+        concept has_member =
+            !is_array<T> && !disable_sized_range<remove_cvref_t<T>>::value &&
+            requires(T&& t) {
+                requires std::is_integral<decltype(decay_copy(
+                    std::forward<T>(t).size()))>::value;
+            };
+
+        template <typename T>
+        concept has_adl =
+            !is_array<T> && !disable_sized_range<remove_cvref_t<T>>::value &&
+            requires(T&& t) {
+                requires std::is_integral<decltype(decay_copy(
+                    size(std::forward<T>(t))))>::value;
+            };
+
+        template <typename T>
+        concept has_difference = !is_array<T> && requires(T&& t) {
+            decay_copy(::picorange::end(t) - ::picorange::begin(t));
+        };
+
+        struct fn {
+        private:
+            template <typename T>
+            static constexpr bool is_noexcept()
+            {
+                if constexpr (is_array<T>) {
+                    return true;
+                }
+                else if constexpr (has_member<T>) {
+                    return noexcept(decay_copy(std::declval<T>().size()));
+                }
+                else if constexpr (has_adl<T>) {
+                    return noexcept(decay_copy(size(std::declval<T>())));
+                }
+                else {
+                    return noexcept(
+                        decay_copy(::picorange::end(std::declval<T&>()) -
+                                   ::picorange::begin(std::declval<T&>())));
+                }
+            }
+
+        public:
+            template <typename T>
+                requires is_array<T> || has_member<T> || has_adl<T> ||
+                         has_difference<T>
+            constexpr auto operator()(T&& t) const noexcept(is_noexcept<T>())
+            {
+                if constexpr (is_array<T>) {
+                    return std::size_t{
+                        std::extent<typename std::remove_reference<T>::type>::
+                            value};
+                }
+                else if constexpr (has_member<T>) {
+                    return decay_copy(std::forward<T>(t).size());
+                }
+                else if constexpr (has_adl<T>) {
+                    return decay_copy(size(std::forward<T>(t)));
+                }
+                else {
+                    return decay_copy(::picorange::end(t) -
+                                      ::picorange::begin(t));
+                }
+            }
+        };
+#else
         struct fn {
         private:
             template <typename T, std::size_t N>
@@ -1411,12 +1740,19 @@ namespace picorange {
                 return fn::impl(std::forward<T>(t), priority_tag<3>{});
             }
         };
+#endif
     }  // namespace _size
     namespace {
         constexpr auto& size = static_const<_size::fn>::value;
     }
+#endif
 
     // empty
+#if PICORANGE_STD_RANGES
+    namespace {
+        constexpr auto& empty = std::ranges::empty;
+    }
+#else
     namespace _empty_ns {
         struct fn {
         private:
@@ -1459,8 +1795,45 @@ namespace picorange {
     namespace {
         constexpr auto& empty = static_const<_empty_ns::fn>::value;
     }
+#endif
 
     // sized_range
+#if PICORANGE_HAS_CONCEPTS
+    namespace concepts {
+#if PICORANGE_STD_RANGES
+        template <typename T>
+        concept sized_range = std::ranges::sized_range<T>;
+#else
+        template <typename T>
+        concept sized_range =
+            range<T> && !disable_sized_range<remove_cvref_t<T>>::value &&
+            requires(T& t) { ::picorange::size(t); };
+#endif
+    }  // namespace concepts
+    template <typename T>
+    struct sized_range
+        : std::integral_constant<bool, concepts::sized_range<T>> {
+    };
+
+    // contiguous_range
+    namespace concepts {
+#if PICORANGE_STD_RANGES
+        template <typename T>
+        concept contiguous_range = std::ranges::contiguous_range<T>;
+#else
+        template <typename T>
+        concept contiguous_range = range<T> && requires(T& t) {
+            requires std::is_same<
+                decltype(::picorange::data(t)),
+                typename std::add_pointer<range_reference_t<T>>::type>::value;
+        };
+#endif
+    }  // namespace concepts
+    template <typename T>
+    struct contiguous_range
+        : std::integral_constant<bool, concepts::contiguous_range<T>> {
+    };
+#else
     struct sized_range_concept {
         template <typename T>
         auto _test_requires(T& t) -> decltype(::picorange::size(t));
@@ -1493,8 +1866,98 @@ namespace picorange {
     template <typename T>
     struct contiguous_range : decltype(contiguous_range_concept::test<T>(0)) {
     };
+#endif
+
+    // unreachable_sentinel
+#if PICORANGE_STD_RANGES
+    using std::unreachable_sentinel_t;
+    namespace {
+        constexpr auto& unreachable_sentinel = std::unreachable_sentinel;
+    }
+#else
+    // Sentinel, which compares unequal to every iterator, for loops that
+    // are known to terminate by other means (e.g. a terminator the input
+    // has been validated to contain). `i != unreachable_sentinel` is
+    // constant false, and the bounds check is compiled away.
+    struct unreachable_sentinel_t {
+        template <typename I>
+        friend constexpr bool operator==(const I&,
+                                         unreachable_sentinel_t) noexcept
+        {
+            return false;
+        }
+        template <typename I>
+        friend constexpr bool operator==(unreachable_sentinel_t,
+                                         const I&) noexcept
+        {
+            return false;
+        }
+        template <typename I>
+        friend constexpr bool operator!=(const I&,
+                                         unreachable_sentinel_t) noexcept
+        {
+            return true;
+        }
+        template <typename I>
+        friend constexpr bool operator!=(unreachable_sentinel_t,
+                                         const I&) noexcept
+        {
+            return true;
+        }
+    };
+    namespace {
+        constexpr auto& unreachable_sentinel =
+            static_const<unreachable_sentinel_t>::value;
+    }
+#endif
+
+    // null_sentinel
+    // Sentinel for null-terminated sequences, like C strings: an iterator is
+    // at the end when it points to a value-initialized element
+    struct null_sentinel_t {
+        template <typename I,
+                  typename = decltype(*std::declval<const I&>() ==
+                                      iter_value_t<I>{})>
+        friend constexpr bool operator==(const I& i, null_sentinel_t)
+        {
+            return *i == iter_value_t<I>{};
+        }
+        template <typename I,
+                  typename = decltype(*std::declval<const I&>() ==
+                                      iter_value_t<I>{})>
+        friend constexpr bool operator==(null_sentinel_t, const I& i)
+        {
+            return *i == iter_value_t<I>{};
+        }
+        template <typename I,
+                  typename = decltype(*std::declval<const I&>() ==
+                                      iter_value_t<I>{})>
+        friend constexpr bool operator!=(const I& i, null_sentinel_t)
+        {
+            return !(*i == iter_value_t<I>{});
+        }
+        template <typename I,
+                  typename = decltype(*std::declval<const I&>() ==
+                                      iter_value_t<I>{})>
+        friend constexpr bool operator!=(null_sentinel_t, const I& i)
+        {
+            return !(*i == iter_value_t<I>{});
+        }
+    };
+    namespace {
+        constexpr auto& null_sentinel = static_const<null_sentinel_t>::value;
+    }
 
     // subrange
+#if PICORANGE_STD_RANGES
+    using std::ranges::get;
+    using std::ranges::subrange;
+    using std::ranges::subrange_kind;
+    using std::ranges::view_interface;
+#else
+    template <typename I>
+    struct contiguous_iterator;
+
     template <typename D>
     class view_interface : public view_base {
         static_assert(std::is_class<D>::value, "");
@@ -1506,7 +1969,7 @@ namespace picorange {
         {
             return static_cast<D&>(*this);
         }
-        constexpr D& derived() const noexcept
+        constexpr const D& derived() const noexcept
         {
             return static_cast<const D&>(*this);
         }
@@ -1536,7 +1999,8 @@ namespace picorange {
         }
 
         template <typename R = D,
-                  typename std::enable_if<contiguous_range<R>::value>::type* =
+                  typename std::enable_if<
+                      contiguous_iterator<iterator_t<R>>::value>::type* =
                       nullptr>
         auto data() -> decltype(
             std::addressof(*::picorange::begin(static_cast<R&>(*this))))
@@ -1547,7 +2011,8 @@ namespace picorange {
         }
         template <typename R = D,
                   typename std::enable_if<
-                      contiguous_range<const R>::value>::type* = nullptr>
+                      contiguous_iterator<iterator_t<const R>>::value>::type* =
+                      nullptr>
         auto data() const -> decltype(
             std::addressof(*::picorange::begin(static_cast<const R&>(*this))))
         {
@@ -1597,7 +2062,12 @@ namespace picorange {
     namespace _subrange {
         template <typename I,
                   typename S = I,
-                  subrange_kind = detail::default_subrange_kind<I, S>::value>
+                  subrange_kind K = detail::default_subrange_kind<I, S>::value>
+#if PICORANGE_HAS_CONCEPTS
+            requires concepts::sentinel_for<S, I> &&
+                     (K == subrange_kind::sized ||
+                      !concepts::sized_sentinel_for<S, I>)
+#endif
         class subrange;
     }  // namespace _subrange
 
@@ -1700,9 +2170,10 @@ namespace picorange {
             {
             }
 
+            // Only used when S is a sized_sentinel_for I
             constexpr iter_difference_t<I> get_size() const
             {
-                return distance(begin, end);
+                return end - begin;
             }
 
             I begin{};
@@ -1727,6 +2198,23 @@ namespace picorange {
             iter_difference_t<I> size{0};
         };
 
+        // The end of an unbounded subrange takes no space, making it as
+        // large as its iterator
+        template <typename I>
+        struct subrange_data<I, unreachable_sentinel_t, false> {
+            constexpr subrange_data() = default;
+            constexpr subrange_data(I&& b, unreachable_sentinel_t&&)
+                : begin(std::move(b))
+            {
+            }
+
+            I begin{};
+            static constexpr unreachable_sentinel_t end{};
+        };
+        template <typename I>
+        constexpr unreachable_sentinel_t
+            subrange_data<I, unreachable_sentinel_t, false>::end;
+
         template <typename R, typename I, typename S, subrange_kind K>
         auto _subrange_range_constructor_constraint_helper_fn(long)
             -> std::false_type;
@@ -1764,12 +2252,20 @@ namespace picorange {
     }  // namespace detail
 
     namespace _subrange {
+#if PICORANGE_HAS_CONCEPTS
+        template <typename I, typename S, subrange_kind K>
+            requires concepts::sentinel_for<S, I> &&
+                     (K == subrange_kind::sized ||
+                      !concepts::sized_sentinel_for<S, I>)
+        class subrange : public view_interface<subrange<I, S, K>> {
+#else
         template <typename I, typename S, subrange_kind K>
         class subrange : public view_interface<subrange<I, S, K>> {
             static_assert(sentinel_for<S, I>::value, "");
             static_assert(K == subrange_kind::sized ||
                               !sized_sentinel_for<S, I>::value,
                           "");
+#endif
 
             static constexpr bool _store_size =
                 K == subrange_kind::sized && !sized_sentinel_for<S, I>::value;
@@ -1780,6 +2276,18 @@ namespace picorange {
 
             subrange() = default;
 
+#if PICORANGE_HAS_CONCEPTS
+            constexpr subrange(I i, S s)
+                requires(!_store_size)
+                : m_data{std::move(i), std::move(s)}
+            {
+            }
+            constexpr subrange(I i, S s, iter_difference_t<I> n)
+                requires(K == subrange_kind::sized)
+                : m_data{std::move(i), std::move(s), n}
+            {
+            }
+#else
             template <bool SS = _store_size,
                       typename std::enable_if<!SS>::type* = nullptr>
             PICORANGE_CONSTEXPR14 subrange(I i, S s)
@@ -1798,6 +2306,7 @@ namespace picorange {
                 : m_data{std::move(i), std::move(s), n}
             {
             }
+#endif
 
             constexpr I begin() const noexcept
             {
@@ -1814,10 +2323,15 @@ namespace picorange {
                 return m_data.begin == m_data.end;
             }
 
+#if PICORANGE_HAS_CONCEPTS
+            constexpr iter_difference_t<I> size() const noexcept
+                requires(K == subrange_kind::sized)
+#else
             template <subrange_kind KK = K,
                       typename std::enable_if<
                           KK == subrange_kind::sized>::type* = nullptr>
             constexpr iter_difference_t<I> size() const noexcept
+#endif
             {
                 return m_data.get_size();
             }
@@ -1869,6 +2383,7 @@ namespace picorange {
     {
         return detail::subrange_get_impl<N>::get(s);
     }
+#endif
 
     // reconstructible_range
     template <typename R>
@@ -1893,13 +2408,61 @@ namespace picorange {
                       subrange<iterator_t<R>, sentinel_t<R>>>::value> {
     };
 
-    // bidir iterator
-    struct bidirectional_iterator_concept {
+#if PICORANGE_HAS_CONCEPTS
+    namespace concepts {
+#if PICORANGE_STD_RANGES
         template <typename I>
-        auto _test_requires(I i)
-            -> decltype(requires_expr<std::is_same<decltype(i--), I>::value>{});
-        template <typename>
-        static auto test(long) -> std::false_type;
+        concept bidirectional_iterator = std::bidirectional_iterator<I>;
+
+        template <typename I>
+        concept random_access_iterator = std::random_access_iterator<I>;
+#else
+        // bidir iterator
+        template <typename I>
+        concept bidirectional_iterator =
+            std::is_base_of<bidirectional_iterator_tag,
+                            iterator_category_t<I>>::value &&
+            requires(I i) {
+                requires std::is_same<decltype(i--), I>::value;
+            };
+
+        // random access iterator
+        template <typename I>
+        concept random_access_iterator =
+            bidirectional_iterator<I> &&
+            std::is_base_of<random_access_iterator_tag,
+                            iterator_category_t<I>>::value &&
+            sized_sentinel_for<I, I> &&
+            requires(I i, const I j, const iter_difference_t<I> n) {
+                requires std::is_same<decltype(j + n), I>::value;
+                n + j;
+#ifndef _MSC_VER
+                requires std::is_same<decltype(n + j), I>::value;
+#endif
+                requires std::is_same<decltype(j - n), I>::value;
+                requires std::is_same<decltype(j[n]),
+                                      iter_reference_t<I>>::value;
+                requires std::is_convertible<decltype(i < j), bool>::value;
+            };
+#endif
+    }  // namespace concepts
+
+    template <typename I>
+    struct bidirectional_iterator
+        : std::integral_constant<bool, concepts::bidirectional_iterator<I>> {
+    };
+    template <typename I>
+    struct random_access_iterator
+        : std::integral_constant<bool, concepts::random_access_iterator<I>> {
+    };
+#else
+    // bidir iterator
+    struct bidirectional_iterator_concept {
+        template <typename I>
+        auto _test_requires(I i)
+            -> decltype(requires_expr<std::is_same<decltype(i--), I>::value>{});
+        template <typename>
+        static auto test(long) -> std::false_type;
         template <typename I>
         static auto test(int) -> typename std::enable_if<
             std::is_base_of<bidirectional_iterator_tag,
@@ -1945,9 +2508,543 @@ namespace picorange {
     struct random_access_iterator
         : decltype(random_access_iterator_concept::test<I>(0)) {
     };
+#endif
+
+    // contiguous iterator
+    namespace detail {
+        template <typename I, typename = void>
+        struct has_contiguous_iterator_concept : std::false_type {
+        };
+        template <typename I>
+        struct has_contiguous_iterator_concept<
+            I,
+            void_t<typename I::iterator_concept>>
+            : std::integral_constant<
+                  bool,
+                  std::is_base_of<contiguous_iterator_tag,
+                                  typename I::iterator_concept>::value
+#if defined(__cpp_lib_ranges)
+                      || std::is_base_of<std::contiguous_iterator_tag,
+                                         typename I::iterator_concept>::value
+#endif
+                  > {
+        };
+
+        // Standard library iterators only declare contiguity in C++20.
+        // Before that, the iterators of std::vector and std::basic_string
+        // are recognized by the pointer-wrapping iterator type they share,
+        // which <iterator> declares, so that the containers aren't included.
+        // std::vector<bool> doesn't use it, and neither do the checked
+        // iterators of debug mode.
+        template <typename I, typename = void>
+        struct is_std_contiguous_iterator : std::false_type {
+        };
+#if defined(__GLIBCXX__)
+        template <typename T, typename C>
+        struct is_std_contiguous_iterator<
+            __gnu_cxx::__normal_iterator<T*, C>> : std::true_type {
+        };
+#elif defined(_LIBCPP_VERSION)
+        template <typename T>
+        struct is_std_contiguous_iterator<std::__wrap_iter<T*>>
+            : std::true_type {
+        };
+#endif
+
+        template <typename V>
+        struct is_string_char
+            : std::integral_constant<
+                  bool,
+                  std::is_same<V, char>::value ||
+                      std::is_same<V, wchar_t>::value ||
+                      std::is_same<V, char16_t>::value ||
+                      std::is_same<V, char32_t>::value> {
+        };
+
+    }  // namespace detail
+
+    // Specialize to mark an iterator, which doesn't have a contiguous
+    // iterator_concept, as contiguous
+    template <typename I>
+    struct enable_contiguous_iterator
+        : std::integral_constant<
+              bool,
+              detail::has_contiguous_iterator_concept<I>::value ||
+                  detail::is_std_contiguous_iterator<I>::value> {
+    };
+
+#if PICORANGE_HAS_CONCEPTS
+    namespace concepts {
+#if PICORANGE_STD_RANGES
+        template <typename I>
+        concept contiguous_iterator = std::contiguous_iterator<I>;
+#else
+        template <typename I>
+        concept contiguous_iterator =
+            random_access_iterator<I> &&
+            (std::is_base_of<contiguous_iterator_tag,
+                             iterator_category_t<I>>::value ||
+             enable_contiguous_iterator<I>::value) &&
+            std::is_lvalue_reference<iter_reference_t<I>>::value &&
+            std::is_same<iter_value_t<I>,
+                         remove_cvref_t<iter_reference_t<I>>>::value;
+#endif
+    }  // namespace concepts
+
+    template <typename I>
+    struct contiguous_iterator
+        : std::integral_constant<bool, concepts::contiguous_iterator<I>> {
+    };
+#else
+    struct contiguous_iterator_concept {
+        template <typename>
+        static auto test(long) -> std::false_type;
+        template <typename I>
+        static auto test(int) -> typename std::enable_if<
+            random_access_iterator<I>::value &&
+                (std::is_base_of<contiguous_iterator_tag,
+                                 iterator_category_t<I>>::value ||
+                 enable_contiguous_iterator<I>::value) &&
+                std::is_lvalue_reference<iter_reference_t<I>>::value &&
+                std::is_same<iter_value_t<I>,
+                             remove_cvref_t<iter_reference_t<I>>>::value,
+            std::true_type>::type;
+    };
+    template <typename I>
+    struct contiguous_iterator
+        : decltype(contiguous_iterator_concept::test<I>(0)) {
+    };
+#endif
+
+    // to_address
+#if PICORANGE_STD_RANGES
+    using std::to_address;
+#else
+    namespace detail {
+        template <typename I>
+        using pointer_traits_to_address_t =
+            decltype(std::pointer_traits<I>::to_address(std::declval<I&>()));
+        template <typename I>
+        using member_base_t =
+            remove_cvref_t<decltype(std::declval<const I&>().base())>;
+        template <typename I>
+        using member_arrow_t =
+            remove_cvref_t<decltype(std::declval<const I&>().operator->())>;
+
+        template <typename I>
+        struct use_pointer_traits_to_address
+            : std::integral_constant<
+                  bool,
+                  !std::is_pointer<I>::value &&
+                      exists<pointer_traits_to_address_t, I>::value> {
+        };
+        // Wrapped pointers, like __gnu_cxx::__normal_iterator,
+        // libc++ __wrap_iter, and their debug mode counterparts.
+        // base() is safe to call on a past-the-end iterator,
+        // unlike operator->.
+        template <typename I>
+        struct use_member_base
+            : std::integral_constant<
+                  bool,
+                  !std::is_pointer<I>::value &&
+                      !use_pointer_traits_to_address<I>::value &&
+                      contiguous_iterator<I>::value &&
+                      exists<member_base_t, I>::value> {
+        };
+        template <typename I>
+        struct use_member_arrow
+            : std::integral_constant<
+                  bool,
+                  !std::is_pointer<I>::value &&
+                      !use_pointer_traits_to_address<I>::value &&
+                      !use_member_base<I>::value &&
+                      exists<member_arrow_t, I>::value> {
+        };
+
+        template <typename I, typename = void>
+        struct to_address_impl {
+        };
+        template <typename T>
+        struct to_address_impl<T*> {
+            static_assert(!std::is_function<T>::value, "");
+
+            static constexpr T* get(T* p) noexcept
+            {
+                return p;
+            }
+        };
+        template <typename I>
+        struct to_address_impl<
+            I,
+            typename std::enable_if<
+                use_pointer_traits_to_address<I>::value>::type> {
+            static constexpr auto get(const I& i) noexcept
+                -> decltype(std::pointer_traits<I>::to_address(i))
+            {
+                return std::pointer_traits<I>::to_address(i);
+            }
+        };
+        template <typename I>
+        struct to_address_impl<
+            I,
+            typename std::enable_if<use_member_base<I>::value>::type> {
+            static constexpr auto get(const I& i) noexcept(noexcept(i.base()))
+                -> decltype(to_address_impl<member_base_t<I>>::get(i.base()))
+            {
+                return to_address_impl<member_base_t<I>>::get(i.base());
+            }
+        };
+        template <typename I>
+        struct to_address_impl<
+            I,
+            typename std::enable_if<use_member_arrow<I>::value>::type> {
+            static constexpr auto get(const I& i) noexcept(
+                noexcept(i.operator->()))
+                -> decltype(to_address_impl<member_arrow_t<I>>::get(
+                    i.operator->()))
+            {
+                return to_address_impl<member_arrow_t<I>>::get(i.operator->());
+            }
+        };
+    }  // namespace detail
+
+    namespace _to_address {
+        struct fn {
+            template <typename I>
+            constexpr auto operator()(const I& i) const
+                noexcept(noexcept(detail::to_address_impl<I>::get(i)))
+                    -> decltype(detail::to_address_impl<I>::get(i))
+            {
+                return detail::to_address_impl<I>::get(i);
+            }
+        };
+    }  // namespace _to_address
+    namespace {
+        constexpr auto& to_address = static_const<_to_address::fn>::value;
+    }
+#endif
+
+    namespace detail {
+        // advance and distance on a pair of contiguous iterators can be done
+        // on raw pointers, bypassing any checks in the iterator wrapper
+        template <typename I, typename S>
+        struct is_lowerable_to_pointers
+            : std::integral_constant<
+                  bool,
+                  contiguous_iterator<I>::value &&
+                      contiguous_iterator<S>::value &&
+                      sized_sentinel_for<S, I>::value> {
+        };
+    }  // namespace detail
+
+    namespace detail {
+        // Null-terminated character strings, the length of which can be
+        // found with std::char_traits (strlen, wcslen)
+        template <typename I, typename S, typename = void>
+        struct is_null_terminated_string : std::false_type {
+        };
+        template <typename I, typename S>
+        struct is_null_terminated_string<
+            I,
+            S,
+            typename std::enable_if<std::is_same<S, null_sentinel_t>::value &&
+                                    contiguous_iterator<I>::value>::type>
+            : is_string_char<typename std::remove_cv<iter_value_t<I>>::type> {
+        };
+
+        template <typename I>
+        iter_difference_t<I> null_terminated_length(const I& i)
+        {
+            using char_type = typename std::remove_cv<iter_value_t<I>>::type;
+            return static_cast<iter_difference_t<I>>(
+                std::char_traits<char_type>::length(
+                    ::picorange::to_address(i)));
+        }
+    }  // namespace detail
+
+    // Segmented iterators, after Austern, "Segmented Iterators and
+    // Hierarchical Algorithms": iterators over a sequence of segments, like
+    // the blocks of a std::deque, within which a faster local iterator can be
+    // used.
+    //
+    // Specialize for an iterator I to provide:
+    //   segment_iterator: forward iterator over the segments
+    //   local_iterator: iterator within a segment
+    //   static segment_iterator segment(const I&);
+    //   static local_iterator local(const I&);
+    //   static local_iterator begin(segment_iterator);
+    //   static local_iterator end(segment_iterator);
+    //   static I compose(segment_iterator, local_iterator);
+    // compose(s, end(s)) must be the position at the beginning of the next
+    // segment.
+    template <typename I, typename = void>
+    struct segmented_iterator_traits {
+    };
+
+    // libstdc++ std::deque. Its iterator is recognized by its members, so
+    // that <deque> isn't included. In debug mode, its iterators are wrapped
+    // in checked iterators, and aren't segmented.
+#if defined(__GLIBCXX__) && !defined(_GLIBCXX_DEBUG)
+    namespace detail {
+        template <typename I>
+        using libstdcxx_deque_iterator_t =
+            decltype(std::declval<const I&>()._M_node,
+                     std::declval<const I&>()._M_cur,
+                     I::_S_buffer_size(),
+                     I(std::declval<typename I::_Elt_pointer>(),
+                       std::declval<typename I::_Map_pointer>()));
+    }  // namespace detail
+
+    template <typename I>
+    struct segmented_iterator_traits<
+        I,
+        typename std::enable_if<
+            exists<detail::libstdcxx_deque_iterator_t, I>::value>::type> {
+        using segment_iterator = typename I::_Map_pointer;
+        using local_iterator = typename I::_Elt_pointer;
+
+        static segment_iterator segment(const I& i) noexcept
+        {
+            return i._M_node;
+        }
+        static local_iterator local(const I& i) noexcept
+        {
+            return i._M_cur;
+        }
+
+        static local_iterator begin(segment_iterator s) noexcept
+        {
+            return *s;
+        }
+        static local_iterator end(segment_iterator s) noexcept
+        {
+            return *s + static_cast<std::ptrdiff_t>(I::_S_buffer_size());
+        }
+
+        static I compose(segment_iterator s, local_iterator l) noexcept
+        {
+            if (l == end(s)) {
+                ++s;
+                l = *s;
+            }
+            return I(l, s);
+        }
+    };
+#endif
+
+    namespace detail {
+        template <typename I>
+        using segment_iterator_t =
+            typename segmented_iterator_traits<I>::segment_iterator;
+        template <typename I>
+        using local_iterator_t =
+            typename segmented_iterator_traits<I>::local_iterator;
+    }  // namespace detail
+
+    template <typename I>
+    struct is_segmented_iterator
+        : exists<detail::segment_iterator_t, I> {
+    };
+
+    namespace detail {
+        // advance and distance on non-random-access segmented iterators can
+        // skip over whole segments, if the local iterators are random access
+        template <typename I, typename = void>
+        struct is_segment_walkable : std::false_type {
+        };
+        template <typename I>
+        struct is_segment_walkable<
+            I,
+            typename std::enable_if<is_segmented_iterator<I>::value>::type>
+            : std::integral_constant<
+                  bool,
+                  !random_access_iterator<I>::value &&
+                      random_access_iterator<local_iterator_t<I>>::value> {
+        };
+
+        template <typename I>
+        PICORANGE_CONSTEXPR14 iter_difference_t<I> segmented_distance(
+            const I& first,
+            const I& last)
+        {
+            using traits = segmented_iterator_traits<I>;
+
+            if (first == last) {
+                return 0;
+            }
+            auto seg = traits::segment(first);
+            const auto last_seg = traits::segment(last);
+            if (seg == last_seg) {
+                return static_cast<iter_difference_t<I>>(traits::local(last) -
+                                                         traits::local(first));
+            }
+            auto n = static_cast<iter_difference_t<I>>(traits::end(seg) -
+                                                       traits::local(first));
+            for (++seg; seg != last_seg; ++seg) {
+                n += static_cast<iter_difference_t<I>>(traits::end(seg) -
+                                                       traits::begin(seg));
+            }
+            return n + static_cast<iter_difference_t<I>>(
+                           traits::local(last) - traits::begin(last_seg));
+        }
+
+        // Advances i by n >= 0, or until bound, if bound_ptr is not null.
+        // Returns the number of steps not taken.
+        template <typename I>
+        PICORANGE_CONSTEXPR14 iter_difference_t<I> segmented_advance(
+            I& i,
+            iter_difference_t<I> n,
+            const I* bound_ptr)
+        {
+            using traits = segmented_iterator_traits<I>;
+            using local_difference = iter_difference_t<local_iterator_t<I>>;
+
+            if (n == 0 || (bound_ptr && i == *bound_ptr)) {
+                return n;
+            }
+            auto seg = traits::segment(i);
+            auto local = traits::local(i);
+            while (true) {
+                const bool last_seg =
+                    bound_ptr && seg == traits::segment(*bound_ptr);
+                const auto seg_end =
+                    last_seg ? traits::local(*bound_ptr) : traits::end(seg);
+                const auto left =
+                    static_cast<iter_difference_t<I>>(seg_end - local);
+                if (n <= left || last_seg) {
+                    const auto m = n <= left ? n : left;
+                    local += static_cast<local_difference>(m);
+                    i = traits::compose(seg, local);
+                    return n - m;
+                }
+                n -= left;
+                ++seg;
+                local = traits::begin(seg);
+            }
+        }
+    }  // namespace detail
 
     // advance
+#if PICORANGE_STD_RANGES
+    namespace {
+        constexpr auto& advance = std::ranges::advance;
+    }
+#else
     namespace _advance {
+#if PICORANGE_HAS_CONCEPTS
+        struct fn {
+        private:
+            template <typename T>
+            static constexpr T abs(T t)
+            {
+                return t < T{0} ? -t : t;
+            }
+
+        public:
+            template <typename I>
+            constexpr void operator()(I& i, iter_difference_t<I> n) const
+            {
+                if constexpr (concepts::random_access_iterator<I>) {
+                    i += n;
+                }
+                else {
+                    constexpr auto zero = iter_difference_t<I>{0};
+
+                    if constexpr (detail::is_segment_walkable<I>::value) {
+                        if (n > zero) {
+                            detail::segmented_advance(
+                                i, n, static_cast<const I*>(nullptr));
+                            return;
+                        }
+                    }
+                    if constexpr (concepts::bidirectional_iterator<I>) {
+                        while (n < zero) {
+                            ++n;
+                            --i;
+                        }
+                    }
+                    while (n-- > zero) {
+                        ++i;
+                    }
+                }
+            }
+
+            template <typename I, concepts::sentinel_for<I> S>
+            constexpr void operator()(I& i, S bound) const
+            {
+                if constexpr (std::is_assignable<I&, S>::value) {
+                    i = std::move(bound);
+                }
+                else if constexpr (concepts::sized_sentinel_for<S, I>) {
+                    (*this)(i, bound - i);
+                }
+                else {
+                    while (i != bound) {
+                        ++i;
+                    }
+                }
+            }
+
+            template <typename I, concepts::sentinel_for<I> S>
+            constexpr iter_difference_t<I>
+            operator()(I& i, iter_difference_t<I> n, S bound) const
+            {
+                constexpr iter_difference_t<I> zero{0};
+
+                if constexpr (detail::is_lowerable_to_pointers<I, S>::value) {
+                    const auto dist = static_cast<iter_difference_t<I>>(
+                        ::picorange::to_address(bound) -
+                        ::picorange::to_address(i));
+                    const auto m = fn::abs(n) >= fn::abs(dist) ? dist : n;
+                    i += m;
+                    return n - m;
+                }
+                else if constexpr (concepts::sized_sentinel_for<S, I>) {
+                    const auto dist = bound - i;
+                    if (fn::abs(n) >= fn::abs(dist)) {
+                        (*this)(i, bound);
+                        return n - dist;
+                    }
+                    (*this)(i, n);
+                    return zero;
+                }
+                else {
+                    if constexpr (detail::is_segment_walkable<I>::value &&
+                                  std::is_same<I, S>::value) {
+                        if (n > zero) {
+                            return detail::segmented_advance(i, n, &bound);
+                        }
+                    }
+                    if constexpr (concepts::bidirectional_iterator<I>) {
+                        if (n < zero) {
+                            do {
+                                --i;
+                            } while (++n < zero && i != bound);
+                            return n;
+                        }
+                    }
+                    while (n > zero && i != bound) {
+                        ++i;
+                        --n;
+                    }
+                    return n;
+                }
+            }
+
+            // The bound is never reached: only n limits the distance
+            template <typename I>
+            constexpr iter_difference_t<I> operator()(
+                I& i,
+                iter_difference_t<I> n,
+                unreachable_sentinel_t) const
+            {
+                (*this)(i, n);
+                return 0;
+            }
+            template <typename I>
+            void operator()(I&, unreachable_sentinel_t) const = delete;
+        };
+#else
         struct fn {
         private:
             template <typename T>
@@ -1967,7 +3064,9 @@ namespace picorange {
             template <typename I,
                       typename std::enable_if<
                           bidirectional_iterator<I>::value &&
-                          !random_access_iterator<I>::value>::type* = nullptr>
+                          !random_access_iterator<I>::value &&
+                          !detail::is_segment_walkable<I>::value>::type* =
+                          nullptr>
             static PICORANGE_CONSTEXPR14 void impl(I& i, iter_difference_t<I> n)
             {
                 constexpr auto zero = iter_difference_t<I>{0};
@@ -1986,7 +3085,9 @@ namespace picorange {
 
             template <typename I,
                       typename std::enable_if<
-                          !bidirectional_iterator<I>::value>::type* = nullptr>
+                          !bidirectional_iterator<I>::value &&
+                          !detail::is_segment_walkable<I>::value>::type* =
+                          nullptr>
             static PICORANGE_CONSTEXPR14 void impl(I& i, iter_difference_t<I> n)
             {
                 while (n-- > iter_difference_t<I>{0}) {
@@ -1994,6 +3095,51 @@ namespace picorange {
                 }
             }
 
+            // Segment-wise advance only goes forward.
+            // Returns the (nonpositive) number of steps taken.
+            template <typename I>
+            static PICORANGE_CONSTEXPR14 auto retreat(I& i,
+                                                      iter_difference_t<I> n,
+                                                      const I* bound_ptr,
+                                                      std::true_type)
+                -> iter_difference_t<I>
+            {
+                constexpr iter_difference_t<I> zero{0};
+                iter_difference_t<I> counter{0};
+
+                while (n < zero && !(bound_ptr && i == *bound_ptr)) {
+                    --i;
+                    ++n;
+                    --counter;
+                }
+                return counter;
+            }
+            template <typename I>
+            static PICORANGE_CONSTEXPR14 auto retreat(I&,
+                                                      iter_difference_t<I>,
+                                                      const I*,
+                                                      std::false_type)
+                -> iter_difference_t<I>
+            {
+                return 0;
+            }
+
+            template <typename I,
+                      typename std::enable_if<
+                          detail::is_segment_walkable<I>::value>::type* =
+                          nullptr>
+            static PICORANGE_CONSTEXPR14 void impl(I& i, iter_difference_t<I> n)
+            {
+                if (n > iter_difference_t<I>{0}) {
+                    detail::segmented_advance(i, n,
+                                              static_cast<const I*>(nullptr));
+                }
+                else {
+                    fn::retreat(i, n, static_cast<const I*>(nullptr),
+                                bidirectional_iterator<I>{});
+                }
+            }
+
             template <typename I,
                       typename S,
                       typename std::enable_if<
@@ -2029,7 +3175,27 @@ namespace picorange {
             template <typename I,
                       typename S,
                       typename std::enable_if<
-                          sized_sentinel_for<S, I>::value>::type* = nullptr>
+                          detail::is_lowerable_to_pointers<I, S>::value>::type* =
+                          nullptr>
+            static PICORANGE_CONSTEXPR14 auto impl(I& i,
+                                                   iter_difference_t<I> n,
+                                                   S bound)
+                -> iter_difference_t<I>
+            {
+                const auto dist = static_cast<iter_difference_t<I>>(
+                    ::picorange::to_address(bound) -
+                    ::picorange::to_address(i));
+                const auto m = fn::abs(n) >= fn::abs(dist) ? dist : n;
+                i += m;
+                return m;
+            }
+
+            template <typename I,
+                      typename S,
+                      typename std::enable_if<
+                          sized_sentinel_for<S, I>::value &&
+                          !detail::is_lowerable_to_pointers<I, S>::value>::
+                          type* = nullptr>
             static PICORANGE_CONSTEXPR14 auto impl(I& i,
                                                    iter_difference_t<I> n,
                                                    S bound)
@@ -2049,12 +3215,31 @@ namespace picorange {
             template <typename I,
                       typename S,
                       typename std::enable_if<
-                          bidirectional_iterator<I>::value &&
+                          detail::is_segment_walkable<I>::value &&
+                          std::is_same<I, S>::value &&
                           !sized_sentinel_for<S, I>::value>::type* = nullptr>
             static PICORANGE_CONSTEXPR14 auto impl(I& i,
                                                    iter_difference_t<I> n,
                                                    S bound)
                 -> iter_difference_t<I>
+            {
+                if (n > iter_difference_t<I>{0}) {
+                    return n - detail::segmented_advance(i, n, &bound);
+                }
+                return fn::retreat(i, n, &bound, bidirectional_iterator<I>{});
+            }
+
+            template <typename I,
+                      typename S,
+                      typename std::enable_if<
+                          bidirectional_iterator<I>::value &&
+                          !sized_sentinel_for<S, I>::value &&
+                          !(detail::is_segment_walkable<I>::value &&
+                            std::is_same<I, S>::value)>::type* = nullptr>
+            static PICORANGE_CONSTEXPR14 auto impl(I& i,
+                                                   iter_difference_t<I> n,
+                                                   S bound)
+                -> iter_difference_t<I>
             {
                 constexpr iter_difference_t<I> zero{0};
                 iter_difference_t<I> counter{0};
@@ -2079,7 +3264,9 @@ namespace picorange {
                       typename S,
                       typename std::enable_if<
                           !bidirectional_iterator<I>::value &&
-                          !sized_sentinel_for<S, I>::value>::type* = nullptr>
+                          !sized_sentinel_for<S, I>::value &&
+                          !(detail::is_segment_walkable<I>::value &&
+                            std::is_same<I, S>::value)>::type* = nullptr>
             static PICORANGE_CONSTEXPR14 auto impl(I& i,
                                                    iter_difference_t<I> n,
                                                    S bound)
@@ -2122,28 +3309,162 @@ namespace picorange {
             {
                 return n - fn::impl(i, n, bound);
             }
+
+            // The bound is never reached: only n limits the distance
+            template <typename I>
+            PICORANGE_CONSTEXPR14 iter_difference_t<I> operator()(
+                I& i,
+                iter_difference_t<I> n,
+                unreachable_sentinel_t) const
+            {
+                fn::impl(i, n);
+                return 0;
+            }
+            template <typename I>
+            void operator()(I&, unreachable_sentinel_t) const = delete;
         };
+#endif
     }  // namespace _advance
     namespace {
         constexpr auto& advance = static_const<_advance::fn>::value;
     }
+#endif
 
     // distance
+#if PICORANGE_STD_RANGES
+    namespace {
+        constexpr auto& distance = std::ranges::distance;
+    }
+#else
+    namespace detail {
+        // Iterators, which can count the elements up to s faster than by
+        // incrementing, like those of utf8_view, provide i.distance_to(s)
+        template <typename I, typename S>
+        using distance_to_t = decltype(std::declval<const I&>().distance_to(
+            std::declval<const S&>()));
+
+        template <typename I, typename S>
+        struct has_distance_to
+            : std::integral_constant<bool,
+                                     exists<distance_to_t, I, S>::value &&
+                                         !sized_sentinel_for<S, I>::value> {
+        };
+    }  // namespace detail
+
     namespace _distance {
+#if PICORANGE_HAS_CONCEPTS
+        struct fn {
+            template <typename I, concepts::sentinel_for<I> S>
+            constexpr iter_difference_t<I> operator()(I first, S last) const
+            {
+                if constexpr (detail::is_lowerable_to_pointers<I, S>::value) {
+                    return static_cast<iter_difference_t<I>>(
+                        ::picorange::to_address(last) -
+                        ::picorange::to_address(first));
+                }
+                else if constexpr (concepts::sized_sentinel_for<S, I>) {
+                    return last - first;
+                }
+                else if constexpr (
+                    detail::is_null_terminated_string<I, S>::value) {
+                    return detail::null_terminated_length(first);
+                }
+                else if constexpr (detail::has_distance_to<I, S>::value) {
+                    return first.distance_to(last);
+                }
+                else if constexpr (detail::is_segment_walkable<I>::value &&
+                                   std::is_same<I, S>::value) {
+                    return detail::segmented_distance(first, last);
+                }
+                else {
+                    iter_difference_t<I> counter{0};
+                    while (first != last) {
+                        ++first;
+                        ++counter;
+                    }
+                    return counter;
+                }
+            }
+
+            // Would never return
+            template <typename I>
+            void operator()(I, unreachable_sentinel_t) const = delete;
+
+            template <concepts::range R>
+            constexpr iter_difference_t<iterator_t<R>> operator()(R&& r) const
+            {
+                if constexpr (concepts::sized_range<R>) {
+                    return static_cast<iter_difference_t<iterator_t<R>>>(
+                        ::picorange::size(r));
+                }
+                else {
+                    return (*this)(::picorange::begin(r), ::picorange::end(r));
+                }
+            }
+        };
+#else
         struct fn {
         private:
             template <typename I, typename S>
             static PICORANGE_CONSTEXPR14 auto impl(I i, S s) ->
-                typename std::enable_if<sized_sentinel_for<S, I>::value,
-                                        iter_difference_t<I>>::type
+                typename std::enable_if<
+                    detail::is_lowerable_to_pointers<I, S>::value,
+                    iter_difference_t<I>>::type
+            {
+                return static_cast<iter_difference_t<I>>(
+                    ::picorange::to_address(s) - ::picorange::to_address(i));
+            }
+
+            template <typename I, typename S>
+            static PICORANGE_CONSTEXPR14 auto impl(I i, S s) ->
+                typename std::enable_if<
+                    sized_sentinel_for<S, I>::value &&
+                        !detail::is_lowerable_to_pointers<I, S>::value,
+                    iter_difference_t<I>>::type
             {
                 return s - i;
             }
 
+            template <typename I, typename S>
+            static auto impl(I i, S) -> typename std::enable_if<
+                detail::is_null_terminated_string<I, S>::value,
+                iter_difference_t<I>>::type
+            {
+                return detail::null_terminated_length(i);
+            }
+
             template <typename I, typename S>
             static PICORANGE_CONSTEXPR14 auto impl(I i, S s) ->
-                typename std::enable_if<!sized_sentinel_for<S, I>::value,
-                                        iter_difference_t<I>>::type
+                typename std::enable_if<
+                    !sized_sentinel_for<S, I>::value &&
+                        detail::is_segment_walkable<I>::value &&
+                        std::is_same<I, S>::value,
+                    iter_difference_t<I>>::type
+            {
+                return detail::segmented_distance(i, s);
+            }
+
+            template <typename I, typename S>
+            static PICORANGE_CONSTEXPR14 auto impl(I i, S s) ->
+                typename std::enable_if<
+                    detail::has_distance_to<I, S>::value &&
+                        !detail::is_null_terminated_string<I, S>::value &&
+                        !(detail::is_segment_walkable<I>::value &&
+                          std::is_same<I, S>::value),
+                    iter_difference_t<I>>::type
+            {
+                return i.distance_to(s);
+            }
+
+            template <typename I, typename S>
+            static PICORANGE_CONSTEXPR14 auto impl(I i, S s) ->
+                typename std::enable_if<
+                    !sized_sentinel_for<S, I>::value &&
+                        !detail::is_null_terminated_string<I, S>::value &&
+                        !detail::has_distance_to<I, S>::value &&
+                        !(detail::is_segment_walkable<I>::value &&
+                          std::is_same<I, S>::value),
+                    iter_difference_t<I>>::type
             {
                 iter_difference_t<I> counter{0};
                 while (i != s) {
@@ -2153,6 +3474,10 @@ namespace picorange {
                 return counter;
             }
 
+            // Would never return
+            template <typename I>
+            static void impl(I, unreachable_sentinel_t) = delete;
+
             template <typename R>
             static PICORANGE_CONSTEXPR14 auto impl(R&& r) ->
                 typename std::enable_if<sized_range<R>::value,
@@ -2178,6 +3503,8 @@ namespace picorange {
             {
                 return fn::impl(std::move(first), std::move(last));
             }
+            template <typename I>
+            void operator()(I, unreachable_sentinel_t) const = delete;
 
             template <typename R>
             PICORANGE_CONSTEXPR14 auto operator()(R&& r) const ->
@@ -2187,13 +3514,242 @@ namespace picorange {
                 return fn::impl(std::forward<R>(r));
             }
         };
+#endif
     }  // namespace _distance
     namespace {
         constexpr auto& distance = static_const<_distance::fn>::value;
     }
+#endif
+
+    // counted_iterator
+#if PICORANGE_STD_RANGES
+    using std::counted_iterator;
+    using std::default_sentinel_t;
+    namespace {
+        constexpr auto& default_sentinel = std::default_sentinel;
+    }
+#else
+    struct default_sentinel_t {
+    };
+    namespace {
+        constexpr auto& default_sentinel =
+            static_const<default_sentinel_t>::value;
+    }
+
+    // Iterator adaptor, which tracks the number of elements left until the
+    // end, so that distance() and advance(i, n, bound) to a
+    // default_sentinel_t are O(1), even if I is only an input or forward
+    // iterator.
+    template <typename I>
+    class counted_iterator {
+    public:
+        using iterator_type = I;
+        using iterator_category = typename std::conditional<
+            std::is_base_of<random_access_iterator_tag,
+                            iterator_category_t<I>>::value,
+            random_access_iterator_tag,
+            iterator_category_t<I>>::type;
+        using value_type = iter_value_t<I>;
+        using difference_type = iter_difference_t<I>;
+        using reference = iter_reference_t<I>;
+        using pointer = void;
+
+        counted_iterator() = default;
+        PICORANGE_CONSTEXPR14 counted_iterator(I i, difference_type n)
+            : m_current(std::move(i)), m_count(n)
+        {
+            PICORANGE_EXPECT(n >= 0);
+        }
+        template <typename J,
+                  typename std::enable_if<
+                      !std::is_same<I, J>::value &&
+                      std::is_convertible<const J&, I>::value>::type* =
+                      nullptr>
+        constexpr counted_iterator(const counted_iterator<J>& other)
+            : m_current(other.base()), m_count(other.count())
+        {
+        }
+
+        constexpr const I& base() const noexcept
+        {
+            return m_current;
+        }
+        constexpr difference_type count() const noexcept
+        {
+            return m_count;
+        }
+
+        constexpr reference operator*() const
+        {
+            return *m_current;
+        }
+        template <typename B = I,
+                  typename std::enable_if<
+                      random_access_iterator<B>::value>::type* = nullptr>
+        constexpr reference operator[](difference_type n) const
+        {
+            return m_current[n];
+        }
+
+        PICORANGE_CONSTEXPR14 counted_iterator& operator++()
+        {
+            PICORANGE_EXPECT(m_count > 0);
+            ++m_current;
+            --m_count;
+            return *this;
+        }
+        PICORANGE_CONSTEXPR14 counted_iterator operator++(int)
+        {
+            auto tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        template <typename B = I,
+                  typename std::enable_if<
+                      bidirectional_iterator<B>::value>::type* = nullptr>
+        PICORANGE_CONSTEXPR14 counted_iterator& operator--()
+        {
+            --m_current;
+            ++m_count;
+            return *this;
+        }
+        template <typename B = I,
+                  typename std::enable_if<
+                      bidirectional_iterator<B>::value>::type* = nullptr>
+        PICORANGE_CONSTEXPR14 counted_iterator operator--(int)
+        {
+            auto tmp = *this;
+            --*this;
+            return tmp;
+        }
+
+        template <typename B = I,
+                  typename std::enable_if<
+                      random_access_iterator<B>::value>::type* = nullptr>
+        PICORANGE_CONSTEXPR14 counted_iterator& operator+=(difference_type n)
+        {
+            PICORANGE_EXPECT(n <= m_count);
+            m_current += n;
+            m_count -= n;
+            return *this;
+        }
+        template <typename B = I,
+                  typename std::enable_if<
+                      random_access_iterator<B>::value>::type* = nullptr>
+        PICORANGE_CONSTEXPR14 counted_iterator& operator-=(difference_type n)
+        {
+            PICORANGE_EXPECT(-n <= m_count);
+            m_current -= n;
+            m_count += n;
+            return *this;
+        }
+
+        template <typename B = I,
+                  typename std::enable_if<
+                      random_access_iterator<B>::value>::type* = nullptr>
+        friend constexpr counted_iterator operator+(const counted_iterator& i,
+                                                   difference_type n)
+        {
+            return counted_iterator{i.m_current + n, i.m_count - n};
+        }
+        template <typename B = I,
+                  typename std::enable_if<
+                      random_access_iterator<B>::value>::type* = nullptr>
+        friend constexpr counted_iterator operator+(difference_type n,
+                                                   const counted_iterator& i)
+        {
+            return counted_iterator{i.m_current + n, i.m_count - n};
+        }
+        template <typename B = I,
+                  typename std::enable_if<
+                      random_access_iterator<B>::value>::type* = nullptr>
+        friend constexpr counted_iterator operator-(const counted_iterator& i,
+                                                   difference_type n)
+        {
+            return counted_iterator{i.m_current - n, i.m_count + n};
+        }
+
+        // Iterators counting down towards the same end can be compared and
+        // subtracted by their counts alone
+        friend constexpr difference_type operator-(const counted_iterator& x,
+                                                   const counted_iterator& y)
+        {
+            return y.m_count - x.m_count;
+        }
+        friend constexpr difference_type operator-(const counted_iterator& x,
+                                                   default_sentinel_t)
+        {
+            return -x.m_count;
+        }
+        friend constexpr difference_type operator-(default_sentinel_t,
+                                                   const counted_iterator& y)
+        {
+            return y.m_count;
+        }
+
+        friend constexpr bool operator==(const counted_iterator& x,
+                                         const counted_iterator& y)
+        {
+            return x.m_count == y.m_count;
+        }
+        friend constexpr bool operator!=(const counted_iterator& x,
+                                         const counted_iterator& y)
+        {
+            return !(x == y);
+        }
+        friend constexpr bool operator==(const counted_iterator& x,
+                                         default_sentinel_t)
+        {
+            return x.m_count == 0;
+        }
+        friend constexpr bool operator==(default_sentinel_t,
+                                         const counted_iterator& x)
+        {
+            return x.m_count == 0;
+        }
+        friend constexpr bool operator!=(const counted_iterator& x,
+                                         default_sentinel_t)
+        {
+            return x.m_count != 0;
+        }
+        friend constexpr bool operator!=(default_sentinel_t,
+                                         const counted_iterator& x)
+        {
+            return x.m_count != 0;
+        }
+
+        friend constexpr bool operator<(const counted_iterator& x,
+                                        const counted_iterator& y)
+        {
+            return y.m_count < x.m_count;
+        }
+        friend constexpr bool operator>(const counted_iterator& x,
+                                        const counted_iterator& y)
+        {
+            return y < x;
+        }
+        friend constexpr bool operator<=(const counted_iterator& x,
+                                         const counted_iterator& y)
+        {
+            return !(y < x);
+        }
+        friend constexpr bool operator>=(const counted_iterator& x,
+                                         const counted_iterator& y)
+        {
+            return !(x < y);
+        }
+
+    private:
+        I m_current{};
+        difference_type m_count{0};
+    };
+#endif
+
     PICORANGE_END_NAMESPACE
 }  // namespace picorange
 
+#if !PICORANGE_STD_RANGES
 namespace std {
     template <typename I, typename S, ::picorange::subrange_kind K>
     class tuple_size<::picorange::subrange<I, S, K>>
@@ -2213,5 +3769,6 @@ namespace std {
 
     using ::picorange::get;
 }  // namespace std
+#endif
 
 #endif  // PICORANGE_H
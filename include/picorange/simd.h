@@ -0,0 +1,1296 @@
+// Copyright 2017-2019 Elias Kosunen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// This file is a part of picorange:
+//     https://github.com/eliaskosunen/picorange
+
+#ifndef PICORANGE_SIMD_H
+#define PICORANGE_SIMD_H
+
+#include "picorange.h"
+
+#include <cstdint>
+#include <cstring>
+
+// Define to 0 to always use the scalar kernels
+#ifndef PICORANGE_SIMD
+#define PICORANGE_SIMD 1
+#endif
+
+#if PICORANGE_SIMD &&                                             \
+    (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || \
+     defined(_M_IX86))
+#define PICORANGE_X86 1
+#else
+#define PICORANGE_X86 0
+#endif
+
+#if PICORANGE_X86 && (defined(__SSE2__) || defined(_M_X64) || \
+                      (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define PICORANGE_HAS_SSE2 1
+#else
+#define PICORANGE_HAS_SSE2 0
+#endif
+
+// Compiled with -mavx2 or /arch:AVX2: no runtime dispatch needed
+#if PICORANGE_HAS_SSE2 && defined(__AVX2__)
+#define PICORANGE_HAS_AVX2 1
+#else
+#define PICORANGE_HAS_AVX2 0
+#endif
+
+#if PICORANGE_HAS_SSE2 && (defined(__SSSE3__) || PICORANGE_HAS_AVX2)
+#define PICORANGE_HAS_SSSE3 1
+#else
+#define PICORANGE_HAS_SSSE3 0
+#endif
+
+// Runtime dispatch to kernels for instruction sets not enabled at compile
+// time. GCC and Clang need the target attribute to emit them, MSVC doesn't.
+#if PICORANGE_HAS_SSE2 && !PICORANGE_HAS_AVX2 && \
+    (PICORANGE_GCC_COMPAT || PICORANGE_MSVC)
+#define PICORANGE_SIMD_RUNTIME_DISPATCH 1
+#else
+#define PICORANGE_SIMD_RUNTIME_DISPATCH 0
+#endif
+
+#if PICORANGE_GCC_COMPAT
+#define PICORANGE_SIMD_TARGET(x) __attribute__((target(x)))
+#else
+#define PICORANGE_SIMD_TARGET(x)
+#endif
+
+#if PICORANGE_HAS_SSE2
+#if PICORANGE_MSVC
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#endif
+#endif
+
+namespace picorange {
+    PICORANGE_BEGIN_NAMESPACE
+
+    namespace detail {
+        namespace simd {
+            // Index of the lowest set bit, m != 0
+            inline unsigned count_trailing_zeros(std::uint32_t m) noexcept
+            {
+#if PICORANGE_GCC_COMPAT
+                return static_cast<unsigned>(__builtin_ctz(m));
+#elif PICORANGE_MSVC
+                unsigned long i;
+                _BitScanForward(&i, m);
+                return static_cast<unsigned>(i);
+#else
+                unsigned i = 0;
+                while ((m & 1u) == 0) {
+                    m >>= 1;
+                    ++i;
+                }
+                return i;
+#endif
+            }
+
+            struct cpu_features {
+                bool ssse3{false};
+                bool avx2{false};
+            };
+
+#if PICORANGE_SIMD_RUNTIME_DISPATCH
+            inline cpu_features detect_cpu_features() noexcept
+            {
+                cpu_features f{};
+#if PICORANGE_MSVC
+                int regs[4];
+                __cpuid(regs, 0);
+                const int max_leaf = regs[0];
+                __cpuid(regs, 1);
+                f.ssse3 = (regs[2] & (1 << 9)) != 0;
+                const bool osxsave = (regs[2] & (1 << 27)) != 0;
+                const bool avx = (regs[2] & (1 << 28)) != 0;
+                if (max_leaf >= 7 && osxsave && avx &&
+                    (_xgetbv(0) & 0x6) == 0x6) {
+                    __cpuidex(regs, 7, 0);
+                    f.avx2 = (regs[1] & (1 << 5)) != 0;
+                }
+#else
+                __builtin_cpu_init();
+                f.ssse3 = __builtin_cpu_supports("ssse3") != 0;
+                f.avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+                return f;
+            }
+
+            inline const cpu_features& get_cpu_features() noexcept
+            {
+                static const cpu_features f = detect_cpu_features();
+                return f;
+            }
+#else
+            inline cpu_features get_cpu_features() noexcept
+            {
+                cpu_features f{};
+                f.ssse3 = PICORANGE_HAS_SSSE3 != 0;
+                f.avx2 = PICORANGE_HAS_AVX2 != 0;
+                return f;
+            }
+#endif
+
+            // A set of bytes, in a layout usable by both the scalar and the
+            // nibble lookup (pshufb) kernels.
+            //
+            // For a byte with low nibble lo and high nibble hi, bit (hi % 8)
+            // of nibble_masks[hi / 8][lo] is set, if the byte is in the set.
+            struct byte_set {
+                std::uint64_t bits[4];
+                std::uint8_t nibble_masks[2][16];
+
+                PICORANGE_CONSTEXPR14 void insert(unsigned char c) noexcept
+                {
+                    bits[c >> 6] |= std::uint64_t{1} << (c & 63);
+                    nibble_masks[c >> 7][c & 15] |=
+                        static_cast<std::uint8_t>(1u << ((c >> 4) & 7));
+                }
+
+                constexpr bool contains(unsigned char c) const noexcept
+                {
+                    return ((bits[c >> 6] >> (c & 63)) & 1) != 0;
+                }
+            };
+
+            template <typename Pred>
+            byte_set make_byte_set(Pred& pred)
+            {
+                byte_set s{};
+                for (unsigned c = 0; c < 256; ++c) {
+                    if (pred(static_cast<unsigned char>(c))) {
+                        s.insert(static_cast<unsigned char>(c));
+                    }
+                }
+                return s;
+            }
+
+            using byte = unsigned char;
+
+            // find_byte: first position of v in [first, last), or last
+
+            inline const byte* find_byte_scalar(const byte* first,
+                                                const byte* last,
+                                                byte v) noexcept
+            {
+                if (first == last) {
+                    return last;
+                }
+                // libc memchr is vectorized already
+                const void* p = std::memchr(first, v,
+                                            static_cast<std::size_t>(last - first));
+                return p ? static_cast<const byte*>(p) : last;
+            }
+
+#if PICORANGE_HAS_SSE2
+            inline const byte* find_byte_sse2(const byte* first,
+                                              const byte* last,
+                                              byte v) noexcept
+            {
+                const __m128i needle = _mm_set1_epi8(static_cast<char>(v));
+                for (; last - first >= 16; first += 16) {
+                    const __m128i chunk = _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*>(first));
+                    const auto m = static_cast<std::uint32_t>(
+                        _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)));
+                    if (m != 0) {
+                        return first + count_trailing_zeros(m);
+                    }
+                }
+                for (; first != last; ++first) {
+                    if (*first == v) {
+                        return first;
+                    }
+                }
+                return last;
+            }
+#endif
+
+#if PICORANGE_HAS_AVX2 || PICORANGE_SIMD_RUNTIME_DISPATCH
+            PICORANGE_SIMD_TARGET("avx2")
+            inline const byte* find_byte_avx2(const byte* first,
+                                              const byte* last,
+                                              byte v) noexcept
+            {
+                const __m256i needle = _mm256_set1_epi8(static_cast<char>(v));
+                for (; last - first >= 64; first += 64) {
+                    const __m256i a = _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i*>(first));
+                    const __m256i b = _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i*>(first + 32));
+                    const __m256i ea = _mm256_cmpeq_epi8(a, needle);
+                    const __m256i eb = _mm256_cmpeq_epi8(b, needle);
+                    if (!_mm256_testz_si256(_mm256_or_si256(ea, eb),
+                                            _mm256_or_si256(ea, eb))) {
+                        const auto ma =
+                            static_cast<std::uint32_t>(_mm256_movemask_epi8(ea));
+                        if (ma != 0) {
+                            return first + count_trailing_zeros(ma);
+                        }
+                        return first + 32 +
+                               count_trailing_zeros(static_cast<std::uint32_t>(
+                                   _mm256_movemask_epi8(eb)));
+                    }
+                }
+                for (; last - first >= 32; first += 32) {
+                    const __m256i chunk = _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i*>(first));
+                    const auto m = static_cast<std::uint32_t>(
+                        _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+                    if (m != 0) {
+                        return first + count_trailing_zeros(m);
+                    }
+                }
+                for (; first != last; ++first) {
+                    if (*first == v) {
+                        return first;
+                    }
+                }
+                return last;
+            }
+#endif
+
+            inline const byte* find_byte(const byte* first,
+                                         const byte* last,
+                                         byte v) noexcept
+            {
+#if PICORANGE_HAS_AVX2
+                return find_byte_avx2(first, last, v);
+#elif PICORANGE_HAS_SSE2
+#if PICORANGE_SIMD_RUNTIME_DISPATCH
+                if (get_cpu_features().avx2) {
+                    return find_byte_avx2(first, last, v);
+                }
+#endif
+                return find_byte_sse2(first, last, v);
+#else
+                return find_byte_scalar(first, last, v);
+#endif
+            }
+
+            // mismatch_bytes: index of the first differing byte of a and b,
+            // or n
+
+            inline std::size_t mismatch_bytes_scalar(const byte* a,
+                                                     const byte* b,
+                                                     std::size_t n) noexcept
+            {
+                std::size_t i = 0;
+                for (; i != n; ++i) {
+                    if (a[i] != b[i]) {
+                        break;
+                    }
+                }
+                return i;
+            }
+
+#if PICORANGE_HAS_SSE2
+            inline std::size_t mismatch_bytes_sse2(const byte* a,
+                                                   const byte* b,
+                                                   std::size_t n) noexcept
+            {
+                std::size_t i = 0;
+                for (; n - i >= 16; i += 16) {
+                    const __m128i x =
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+                    const __m128i y =
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+                    const auto m = static_cast<std::uint32_t>(
+                                       _mm_movemask_epi8(_mm_cmpeq_epi8(x, y))) ^
+                                   0xffffu;
+                    if (m != 0) {
+                        return i + count_trailing_zeros(m);
+                    }
+                }
+                return i + mismatch_bytes_scalar(a + i, b + i, n - i);
+            }
+#endif
+
+#if PICORANGE_HAS_AVX2 || PICORANGE_SIMD_RUNTIME_DISPATCH
+            PICORANGE_SIMD_TARGET("avx2")
+            inline std::size_t mismatch_bytes_avx2(const byte* a,
+                                                   const byte* b,
+                                                   std::size_t n) noexcept
+            {
+                std::size_t i = 0;
+                for (; n - i >= 32; i += 32) {
+                    const __m256i x = _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i*>(a + i));
+                    const __m256i y = _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i*>(b + i));
+                    const auto m = ~static_cast<std::uint32_t>(
+                        _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)));
+                    if (m != 0) {
+                        return i + count_trailing_zeros(m);
+                    }
+                }
+                return i + mismatch_bytes_scalar(a + i, b + i, n - i);
+            }
+#endif
+
+            inline std::size_t mismatch_bytes(const byte* a,
+                                              const byte* b,
+                                              std::size_t n) noexcept
+            {
+#if PICORANGE_HAS_AVX2
+                return mismatch_bytes_avx2(a, b, n);
+#elif PICORANGE_HAS_SSE2
+#if PICORANGE_SIMD_RUNTIME_DISPATCH
+                if (get_cpu_features().avx2) {
+                    return mismatch_bytes_avx2(a, b, n);
+                }
+#endif
+                return mismatch_bytes_sse2(a, b, n);
+#else
+                return mismatch_bytes_scalar(a, b, n);
+#endif
+            }
+
+            // find_bytes: first position of the n bytes at needle in
+            // [first, last), or last. n >= 2.
+            //
+            // Candidates are positions where both the first and the last
+            // byte of the needle match, which are found a vector at a time;
+            // only those are compared in full. This is the generic SIMD
+            // substring search described by Wojciech Mula.
+
+            inline const byte* find_bytes_scalar(const byte* first,
+                                                 const byte* last,
+                                                 const byte* needle,
+                                                 std::size_t n) noexcept
+            {
+                if (static_cast<std::size_t>(last - first) < n) {
+                    return last;
+                }
+                const byte* const stop = last - (n - 1);
+                while (first != stop) {
+                    first = find_byte_scalar(first, stop, needle[0]);
+                    if (first == stop) {
+                        break;
+                    }
+                    if (first[n - 1] == needle[n - 1] &&
+                        std::memcmp(first + 1, needle + 1, n - 2) == 0) {
+                        return first;
+                    }
+                    ++first;
+                }
+                return last;
+            }
+
+#if PICORANGE_HAS_SSE2
+            inline const byte* find_bytes_sse2(const byte* first,
+                                               const byte* last,
+                                               const byte* needle,
+                                               std::size_t n) noexcept
+            {
+                if (static_cast<std::size_t>(last - first) < n) {
+                    return last;
+                }
+                const byte* const stop = last - (n - 1);
+                const __m128i head =
+                    _mm_set1_epi8(static_cast<char>(needle[0]));
+                const __m128i tail =
+                    _mm_set1_epi8(static_cast<char>(needle[n - 1]));
+                for (; stop - first >= 16; first += 16) {
+                    const __m128i a = _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*>(first));
+                    const __m128i b = _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*>(first + n - 1));
+                    auto m = static_cast<std::uint32_t>(_mm_movemask_epi8(
+                        _mm_and_si128(_mm_cmpeq_epi8(a, head),
+                                      _mm_cmpeq_epi8(b, tail))));
+                    while (m != 0) {
+                        const auto p = first + count_trailing_zeros(m);
+                        if (std::memcmp(p + 1, needle + 1, n - 2) == 0) {
+                            return p;
+                        }
+                        m &= m - 1;
+                    }
+                }
+                return find_bytes_scalar(first, last, needle, n);
+            }
+#endif
+
+#if PICORANGE_HAS_AVX2 || PICORANGE_SIMD_RUNTIME_DISPATCH
+            PICORANGE_SIMD_TARGET("avx2")
+            inline const byte* find_bytes_avx2(const byte* first,
+                                               const byte* last,
+                                               const byte* needle,
+                                               std::size_t n) noexcept
+            {
+                if (static_cast<std::size_t>(last - first) < n) {
+                    return last;
+                }
+                const byte* const stop = last - (n - 1);
+                const __m256i head =
+                    _mm256_set1_epi8(static_cast<char>(needle[0]));
+                const __m256i tail =
+                    _mm256_set1_epi8(static_cast<char>(needle[n - 1]));
+                for (; stop - first >= 32; first += 32) {
+                    const __m256i a = _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i*>(first));
+                    const __m256i b = _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i*>(first + n - 1));
+                    auto m = static_cast<std::uint32_t>(_mm256_movemask_epi8(
+                        _mm256_and_si256(_mm256_cmpeq_epi8(a, head),
+                                         _mm256_cmpeq_epi8(b, tail))));
+                    while (m != 0) {
+                        const auto p = first + count_trailing_zeros(m);
+                        if (std::memcmp(p + 1, needle + 1, n - 2) == 0) {
+                            return p;
+                        }
+                        m &= m - 1;
+                    }
+                }
+                return find_bytes_scalar(first, last, needle, n);
+            }
+#endif
+
+            inline const byte* find_bytes(const byte* first,
+                                          const byte* last,
+                                          const byte* needle,
+                                          std::size_t n) noexcept
+            {
+#if PICORANGE_HAS_AVX2
+                return find_bytes_avx2(first, last, needle, n);
+#elif PICORANGE_HAS_SSE2
+#if PICORANGE_SIMD_RUNTIME_DISPATCH
+                if (get_cpu_features().avx2) {
+                    return find_bytes_avx2(first, last, needle, n);
+                }
+#endif
+                return find_bytes_sse2(first, last, needle, n);
+#else
+                return find_bytes_scalar(first, last, needle, n);
+#endif
+            }
+
+            // find_in_set: first position of a byte in s, or last
+
+            inline const byte* find_in_set_scalar(const byte* first,
+                                                  const byte* last,
+                                                  const byte_set& s) noexcept
+            {
+                for (; first != last; ++first) {
+                    if (s.contains(*first)) {
+                        return first;
+                    }
+                }
+                return last;
+            }
+
+#if PICORANGE_HAS_SSSE3 || PICORANGE_SIMD_RUNTIME_DISPATCH
+            // Nonzero bytes where chunk is in the set
+            PICORANGE_SIMD_TARGET("ssse3")
+            inline __m128i classify_ssse3(__m128i chunk,
+                                          __m128i masks_lo,
+                                          __m128i masks_hi) noexcept
+            {
+                const __m128i nibble = _mm_set1_epi8(0x0f);
+                const __m128i bit_of_hi =
+                    _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16,
+                                  32, 64, -128);
+                const __m128i lo = _mm_and_si128(chunk, nibble);
+                const __m128i hi =
+                    _mm_and_si128(_mm_srli_epi16(chunk, 4), nibble);
+                const __m128i upper = _mm_cmpgt_epi8(hi, _mm_set1_epi8(7));
+                const __m128i row = _mm_or_si128(
+                    _mm_and_si128(upper, _mm_shuffle_epi8(masks_hi, lo)),
+                    _mm_andnot_si128(upper, _mm_shuffle_epi8(masks_lo, lo)));
+                return _mm_and_si128(row, _mm_shuffle_epi8(bit_of_hi, hi));
+            }
+
+            PICORANGE_SIMD_TARGET("ssse3")
+            inline const byte* find_in_set_ssse3(const byte* first,
+                                                 const byte* last,
+                                                 const byte_set& s) noexcept
+            {
+                const __m128i masks_lo = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(s.nibble_masks[0]));
+                const __m128i masks_hi = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(s.nibble_masks[1]));
+                const __m128i zero = _mm_setzero_si128();
+                for (; last - first >= 16; first += 16) {
+                    const __m128i chunk = _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*>(first));
+                    const __m128i hit =
+                        classify_ssse3(chunk, masks_lo, masks_hi);
+                    const auto m = static_cast<std::uint32_t>(
+                        _mm_movemask_epi8(_mm_cmpeq_epi8(hit, zero))) ^
+                                   0xffffu;
+                    if (m != 0) {
+                        return first + count_trailing_zeros(m);
+                    }
+                }
+                return find_in_set_scalar(first, last, s);
+            }
+#endif
+
+#if PICORANGE_HAS_AVX2 || PICORANGE_SIMD_RUNTIME_DISPATCH
+            PICORANGE_SIMD_TARGET("avx2")
+            inline __m256i classify_avx2(__m256i chunk,
+                                         __m256i masks_lo,
+                                         __m256i masks_hi) noexcept
+            {
+                const __m256i nibble = _mm256_set1_epi8(0x0f);
+                const __m256i bit_of_hi = _mm256_setr_epi8(
+                    1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+                    1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+                const __m256i lo = _mm256_and_si256(chunk, nibble);
+                const __m256i hi =
+                    _mm256_and_si256(_mm256_srli_epi16(chunk, 4), nibble);
+                const __m256i upper =
+                    _mm256_cmpgt_epi8(hi, _mm256_set1_epi8(7));
+                const __m256i row = _mm256_blendv_epi8(
+                    _mm256_shuffle_epi8(masks_lo, lo),
+                    _mm256_shuffle_epi8(masks_hi, lo), upper);
+                return _mm256_and_si256(row,
+                                        _mm256_shuffle_epi8(bit_of_hi, hi));
+            }
+
+            PICORANGE_SIMD_TARGET("avx2")
+            inline __m256i broadcast_masks_avx2(const std::uint8_t* m) noexcept
+            {
+                const __m128i x =
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(m));
+                return _mm256_inserti128_si256(_mm256_castsi128_si256(x), x,
+                                               1);
+            }
+
+            PICORANGE_SIMD_TARGET("avx2")
+            inline const byte* find_in_set_avx2(const byte* first,
+                                                const byte* last,
+                                                const byte_set& s) noexcept
+            {
+                const __m256i masks_lo = broadcast_masks_avx2(s.nibble_masks[0]);
+                const __m256i masks_hi = broadcast_masks_avx2(s.nibble_masks[1]);
+                const __m256i zero = _mm256_setzero_si256();
+                for (; last - first >= 32; first += 32) {
+                    const __m256i chunk = _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i*>(first));
+                    const __m256i hit = classify_avx2(chunk, masks_lo, masks_hi);
+                    const auto m = ~static_cast<std::uint32_t>(
+                        _mm256_movemask_epi8(_mm256_cmpeq_epi8(hit, zero)));
+                    if (m != 0) {
+                        return first + count_trailing_zeros(m);
+                    }
+                }
+                return find_in_set_scalar(first, last, s);
+            }
+#endif
+
+            inline const byte* find_in_set(const byte* first,
+                                           const byte* last,
+                                           const byte_set& s) noexcept
+            {
+#if PICORANGE_HAS_AVX2
+                return find_in_set_avx2(first, last, s);
+#else
+#if PICORANGE_SIMD_RUNTIME_DISPATCH
+                if (get_cpu_features().avx2) {
+                    return find_in_set_avx2(first, last, s);
+                }
+                if (get_cpu_features().ssse3) {
+                    return find_in_set_ssse3(first, last, s);
+                }
+#elif PICORANGE_HAS_SSSE3
+                return find_in_set_ssse3(first, last, s);
+#endif
+                return find_in_set_scalar(first, last, s);
+#endif
+            }
+
+            // count_byte: number of positions of v in [first, last)
+
+            inline std::size_t count_byte_scalar(const byte* first,
+                                                 const byte* last,
+                                                 byte v) noexcept
+            {
+                std::size_t n = 0;
+                for (; first != last; ++first) {
+                    n += static_cast<std::size_t>(*first == v);
+                }
+                return n;
+            }
+
+            // count_in_set: number of positions of bytes in s
+
+            inline std::size_t count_in_set_scalar(const byte* first,
+                                                   const byte* last,
+                                                   const byte_set& s) noexcept
+            {
+                std::size_t n = 0;
+                for (; first != last; ++first) {
+                    n += static_cast<std::size_t>(s.contains(*first));
+                }
+                return n;
+            }
+
+            // The counting kernels add up per-byte hits (0 or 1) in 8-bit
+            // lanes, and widen them with psadbw before the lanes can overflow.
+            constexpr std::ptrdiff_t max_byte_accumulations = 255;
+
+#if PICORANGE_HAS_SSE2
+            // Sum of the two 64-bit lanes of s, both less than 2^31
+            inline std::size_t add_lanes_epi64(__m128i s) noexcept
+            {
+                return static_cast<std::size_t>(_mm_cvtsi128_si32(s)) +
+                       static_cast<std::size_t>(
+                           _mm_cvtsi128_si32(_mm_srli_si128(s, 8)));
+            }
+
+            inline std::size_t horizontal_sum_sse2(__m128i acc) noexcept
+            {
+                return add_lanes_epi64(_mm_sad_epu8(acc, _mm_setzero_si128()));
+            }
+
+            inline std::size_t count_byte_sse2(const byte* first,
+                                               const byte* last,
+                                               byte v) noexcept
+            {
+                const __m128i needle = _mm_set1_epi8(static_cast<char>(v));
+                std::size_t n = 0;
+                while (last - first >= 16) {
+                    auto blocks = (last - first) / 16;
+                    if (blocks > max_byte_accumulations) {
+                        blocks = max_byte_accumulations;
+                    }
+                    __m128i acc = _mm_setzero_si128();
+                    for (; blocks != 0; --blocks, first += 16) {
+                        const __m128i chunk = _mm_loadu_si128(
+                            reinterpret_cast<const __m128i*>(first));
+                        // cmpeq is -1 on a hit
+                        acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(chunk, needle));
+                    }
+                    n += horizontal_sum_sse2(acc);
+                }
+                return n + count_byte_scalar(first, last, v);
+            }
+#endif
+
+#if PICORANGE_HAS_SSSE3 || PICORANGE_SIMD_RUNTIME_DISPATCH
+            PICORANGE_SIMD_TARGET("ssse3")
+            inline std::size_t count_in_set_ssse3(const byte* first,
+                                                  const byte* last,
+                                                  const byte_set& s) noexcept
+            {
+                const __m128i masks_lo = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(s.nibble_masks[0]));
+                const __m128i masks_hi = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(s.nibble_masks[1]));
+                const __m128i one = _mm_set1_epi8(1);
+                std::size_t n = 0;
+                while (last - first >= 16) {
+                    auto blocks = (last - first) / 16;
+                    if (blocks > max_byte_accumulations) {
+                        blocks = max_byte_accumulations;
+                    }
+                    __m128i acc = _mm_setzero_si128();
+                    for (; blocks != 0; --blocks, first += 16) {
+                        const __m128i chunk = _mm_loadu_si128(
+                            reinterpret_cast<const __m128i*>(first));
+                        const __m128i hit =
+                            classify_ssse3(chunk, masks_lo, masks_hi);
+                        acc = _mm_add_epi8(acc, _mm_min_epu8(hit, one));
+                    }
+                    n += horizontal_sum_sse2(acc);
+                }
+                return n + count_in_set_scalar(first, last, s);
+            }
+#endif
+
+#if PICORANGE_HAS_AVX2 || PICORANGE_SIMD_RUNTIME_DISPATCH
+            PICORANGE_SIMD_TARGET("avx2")
+            inline std::size_t horizontal_sum_avx2(__m256i acc) noexcept
+            {
+                const __m256i s = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+                return add_lanes_epi64(_mm_add_epi64(
+                    _mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1)));
+            }
+
+            PICORANGE_SIMD_TARGET("avx2")
+            inline std::size_t count_byte_avx2(const byte* first,
+                                               const byte* last,
+                                               byte v) noexcept
+            {
+                const __m256i needle = _mm256_set1_epi8(static_cast<char>(v));
+                std::size_t n = 0;
+                while (last - first >= 32) {
+                    auto blocks = (last - first) / 32;
+                    if (blocks > max_byte_accumulations) {
+                        blocks = max_byte_accumulations;
+                    }
+                    __m256i acc = _mm256_setzero_si256();
+                    for (; blocks != 0; --blocks, first += 32) {
+                        const __m256i chunk = _mm256_loadu_si256(
+                            reinterpret_cast<const __m256i*>(first));
+                        acc = _mm256_sub_epi8(acc,
+                                              _mm256_cmpeq_epi8(chunk, needle));
+                    }
+                    n += horizontal_sum_avx2(acc);
+                }
+                return n + count_byte_scalar(first, last, v);
+            }
+
+            PICORANGE_SIMD_TARGET("avx2")
+            inline std::size_t count_in_set_avx2(const byte* first,
+                                                 const byte* last,
+                                                 const byte_set& s) noexcept
+            {
+                const __m256i masks_lo = broadcast_masks_avx2(s.nibble_masks[0]);
+                const __m256i masks_hi = broadcast_masks_avx2(s.nibble_masks[1]);
+                const __m256i one = _mm256_set1_epi8(1);
+                std::size_t n = 0;
+                while (last - first >= 32) {
+                    auto blocks = (last - first) / 32;
+                    if (blocks > max_byte_accumulations) {
+                        blocks = max_byte_accumulations;
+                    }
+                    __m256i acc = _mm256_setzero_si256();
+                    for (; blocks != 0; --blocks, first += 32) {
+                        const __m256i chunk = _mm256_loadu_si256(
+                            reinterpret_cast<const __m256i*>(first));
+                        const __m256i hit =
+                            classify_avx2(chunk, masks_lo, masks_hi);
+                        acc = _mm256_add_epi8(acc, _mm256_min_epu8(hit, one));
+                    }
+                    n += horizontal_sum_avx2(acc);
+                }
+                return n + count_in_set_scalar(first, last, s);
+            }
+#endif
+
+            inline std::size_t count_byte(const byte* first,
+                                          const byte* last,
+                                          byte v) noexcept
+            {
+#if PICORANGE_HAS_AVX2
+                return count_byte_avx2(first, last, v);
+#elif PICORANGE_HAS_SSE2
+#if PICORANGE_SIMD_RUNTIME_DISPATCH
+                if (get_cpu_features().avx2) {
+                    return count_byte_avx2(first, last, v);
+                }
+#endif
+                return count_byte_sse2(first, last, v);
+#else
+                return count_byte_scalar(first, last, v);
+#endif
+            }
+
+            inline std::size_t count_in_set(const byte* first,
+                                            const byte* last,
+                                            const byte_set& s) noexcept
+            {
+#if PICORANGE_HAS_AVX2
+                return count_in_set_avx2(first, last, s);
+#else
+#if PICORANGE_SIMD_RUNTIME_DISPATCH
+                if (get_cpu_features().avx2) {
+                    return count_in_set_avx2(first, last, s);
+                }
+                if (get_cpu_features().ssse3) {
+                    return count_in_set_ssse3(first, last, s);
+                }
+#elif PICORANGE_HAS_SSSE3
+                return count_in_set_ssse3(first, last, s);
+#endif
+                return count_in_set_scalar(first, last, s);
+#endif
+            }
+
+            // count_utf8_code_points: number of bytes in [first, last), which
+            // aren't UTF-8 continuation bytes (10xxxxxx)
+
+            inline bool is_utf8_continuation(byte b) noexcept
+            {
+                return (b & 0xc0) == 0x80;
+            }
+
+            inline std::size_t count_utf8_code_points_scalar(
+                const byte* first,
+                const byte* last) noexcept
+            {
+                std::size_t n = 0;
+                for (; first != last; ++first) {
+                    n += static_cast<std::size_t>(
+                        !is_utf8_continuation(*first));
+                }
+                return n;
+            }
+
+#if PICORANGE_HAS_SSE2
+            // As signed bytes, continuation bytes are [-128, -65]
+            inline std::size_t count_utf8_code_points_sse2(
+                const byte* first,
+                const byte* last) noexcept
+            {
+                const __m128i max_continuation = _mm_set1_epi8(-65);
+                std::size_t n = 0;
+                while (last - first >= 16) {
+                    auto blocks = (last - first) / 16;
+                    if (blocks > max_byte_accumulations) {
+                        blocks = max_byte_accumulations;
+                    }
+                    __m128i acc = _mm_setzero_si128();
+                    for (; blocks != 0; --blocks, first += 16) {
+                        const __m128i chunk = _mm_loadu_si128(
+                            reinterpret_cast<const __m128i*>(first));
+                        acc = _mm_sub_epi8(
+                            acc, _mm_cmpgt_epi8(chunk, max_continuation));
+                    }
+                    n += horizontal_sum_sse2(acc);
+                }
+                return n + count_utf8_code_points_scalar(first, last);
+            }
+#endif
+
+#if PICORANGE_HAS_AVX2 || PICORANGE_SIMD_RUNTIME_DISPATCH
+            PICORANGE_SIMD_TARGET("avx2")
+            inline std::size_t count_utf8_code_points_avx2(
+                const byte* first,
+                const byte* last) noexcept
+            {
+                const __m256i max_continuation = _mm256_set1_epi8(-65);
+                std::size_t n = 0;
+                while (last - first >= 32) {
+                    auto blocks = (last - first) / 32;
+                    if (blocks > max_byte_accumulations) {
+                        blocks = max_byte_accumulations;
+                    }
+                    __m256i acc = _mm256_setzero_si256();
+                    for (; blocks != 0; --blocks, first += 32) {
+                        const __m256i chunk = _mm256_loadu_si256(
+                            reinterpret_cast<const __m256i*>(first));
+                        acc = _mm256_sub_epi8(
+                            acc, _mm256_cmpgt_epi8(chunk, max_continuation));
+                    }
+                    n += horizontal_sum_avx2(acc);
+                }
+                return n + count_utf8_code_points_scalar(first, last);
+            }
+#endif
+
+            inline std::size_t count_utf8_code_points(const byte* first,
+                                                      const byte* last) noexcept
+            {
+#if PICORANGE_HAS_AVX2
+                return count_utf8_code_points_avx2(first, last);
+#elif PICORANGE_HAS_SSE2
+#if PICORANGE_SIMD_RUNTIME_DISPATCH
+                if (get_cpu_features().avx2) {
+                    return count_utf8_code_points_avx2(first, last);
+                }
+#endif
+                return count_utf8_code_points_sse2(first, last);
+#else
+                return count_utf8_code_points_scalar(first, last);
+#endif
+            }
+
+            // validate_utf8: [first, last) is well-formed UTF-8
+
+            // The length of a sequence starting with lead, and the range of
+            // its second byte, which excludes overlong encodings, surrogates
+            // and code points above U+10FFFF. length is 0, if lead can't
+            // start a sequence.
+            struct utf8_lead {
+                unsigned length;
+                byte second_min;
+                byte second_max;
+            };
+
+            constexpr utf8_lead utf8_lead_info(byte lead) noexcept
+            {
+                return lead < 0x80   ? utf8_lead{1, 0, 0}
+                       : lead < 0xc2 ? utf8_lead{0, 0, 0}
+                       : lead < 0xe0 ? utf8_lead{2, 0x80, 0xbf}
+                       : lead == 0xe0 ? utf8_lead{3, 0xa0, 0xbf}
+                       : lead == 0xed ? utf8_lead{3, 0x80, 0x9f}
+                       : lead < 0xf0  ? utf8_lead{3, 0x80, 0xbf}
+                       : lead == 0xf0 ? utf8_lead{4, 0x90, 0xbf}
+                       : lead < 0xf4  ? utf8_lead{4, 0x80, 0xbf}
+                       : lead == 0xf4 ? utf8_lead{4, 0x80, 0x8f}
+                                      : utf8_lead{0, 0, 0};
+            }
+
+            inline bool validate_utf8_scalar(const byte* first,
+                                             const byte* last) noexcept
+            {
+                while (first != last) {
+                    if (*first < 0x80) {
+                        ++first;
+                        continue;
+                    }
+                    const auto lead = utf8_lead_info(*first);
+                    const auto length =
+                        static_cast<std::ptrdiff_t>(lead.length);
+                    if (length == 0 || last - first < length ||
+                        first[1] < lead.second_min ||
+                        first[1] > lead.second_max) {
+                        return false;
+                    }
+                    for (unsigned i = 2; i < lead.length; ++i) {
+                        if (!is_utf8_continuation(first[i])) {
+                            return false;
+                        }
+                    }
+                    first += length;
+                }
+                return true;
+            }
+
+#if PICORANGE_HAS_SSSE3 || PICORANGE_SIMD_RUNTIME_DISPATCH
+            // The vectorized validators look up every byte, together with the
+            // byte before it, in three nibble tables, after Keiser and Lemire,
+            // "Validating UTF-8 In Less Than One Instruction Per Byte". Every
+            // bit is an error, which the pair of bytes has, if the bit is set
+            // in all three lookups.
+            namespace utf8_error {
+                // 11______ 0_______, 11______ 11______
+                constexpr std::uint8_t too_short = 1 << 0;
+                // 0_______ 10______
+                constexpr std::uint8_t too_long = 1 << 1;
+                // 11100000 100_____
+                constexpr std::uint8_t overlong_3 = 1 << 2;
+                // 11110100 1001____, 11110100 101_____, 11110101+ 10______
+                constexpr std::uint8_t too_large = 1 << 3;
+                // 11101101 101_____
+                constexpr std::uint8_t surrogate = 1 << 4;
+                // 1100000_ 10______
+                constexpr std::uint8_t overlong_2 = 1 << 5;
+                // 11110101+ 1000____
+                constexpr std::uint8_t too_large_1000 = 1 << 6;
+                // 11110000 1000____
+                constexpr std::uint8_t overlong_4 = 1 << 6;
+                // 10______ 10______: an error, unless it's the third or the
+                // fourth byte of a sequence
+                constexpr std::uint8_t two_conts = 1 << 7;
+                constexpr std::uint8_t carry = too_short | too_long | two_conts;
+            }  // namespace utf8_error
+
+            // By the high and the low nibble of the previous byte, and the
+            // high nibble of the current byte
+            struct utf8_error_lookup {
+                std::uint8_t byte_1_high[16];
+                std::uint8_t byte_1_low[16];
+                std::uint8_t byte_2_high[16];
+            };
+
+            inline const utf8_error_lookup& utf8_error_tables() noexcept
+            {
+                using namespace utf8_error;
+                static const utf8_error_lookup tables = {
+                    {too_long, too_long, too_long, too_long, too_long,
+                     too_long, too_long, too_long, two_conts, two_conts,
+                     two_conts, two_conts, too_short | overlong_2, too_short,
+                     too_short | overlong_3 | surrogate,
+                     too_short | too_large | too_large_1000 | overlong_4},
+                    {carry | overlong_3 | overlong_2 | overlong_4,
+                     carry | overlong_2, carry, carry, carry | too_large,
+                     carry | too_large | too_large_1000,
+                     carry | too_large | too_large_1000,
+                     carry | too_large | too_large_1000,
+                     carry | too_large | too_large_1000,
+                     carry | too_large | too_large_1000,
+                     carry | too_large | too_large_1000,
+                     carry | too_large | too_large_1000,
+                     carry | too_large | too_large_1000,
+                     carry | too_large | too_large_1000 | surrogate,
+                     carry | too_large | too_large_1000,
+                     carry | too_large | too_large_1000},
+                    {too_short, too_short, too_short, too_short, too_short,
+                     too_short, too_short, too_short,
+                     too_long | overlong_2 | two_conts | overlong_3 |
+                         too_large_1000 | overlong_4,
+                     too_long | overlong_2 | two_conts | overlong_3 | too_large,
+                     too_long | overlong_2 | two_conts | surrogate | too_large,
+                     too_long | overlong_2 | two_conts | surrogate | too_large,
+                     too_short, too_short, too_short, too_short}};
+                return tables;
+            }
+
+            // Nonzero bytes where input, after prev_input, has an error
+            PICORANGE_SIMD_TARGET("ssse3")
+            inline __m128i utf8_errors_ssse3(__m128i input,
+                                             __m128i prev_input) noexcept
+            {
+                const auto& t = utf8_error_tables();
+                const __m128i nibble = _mm_set1_epi8(0x0f);
+                const __m128i prev1 = _mm_alignr_epi8(input, prev_input, 15);
+                const __m128i byte_1_high = _mm_shuffle_epi8(
+                    _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*>(t.byte_1_high)),
+                    _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+                const __m128i byte_1_low = _mm_shuffle_epi8(
+                    _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*>(t.byte_1_low)),
+                    _mm_and_si128(prev1, nibble));
+                const __m128i byte_2_high = _mm_shuffle_epi8(
+                    _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*>(t.byte_2_high)),
+                    _mm_and_si128(_mm_srli_epi16(input, 4), nibble));
+                const __m128i special = _mm_and_si128(
+                    _mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+
+                // The third and fourth bytes of 3- and 4-byte sequences must
+                // be the continuations flagged as two_conts
+                const __m128i prev2 = _mm_alignr_epi8(input, prev_input, 14);
+                const __m128i prev3 = _mm_alignr_epi8(input, prev_input, 13);
+                const __m128i must_be_continuation = _mm_or_si128(
+                    _mm_subs_epu8(prev2, _mm_set1_epi8(0xe0 - 0x80)),
+                    _mm_subs_epu8(prev3, _mm_set1_epi8(0xf0 - 0x80)));
+                return _mm_xor_si128(
+                    _mm_and_si128(must_be_continuation, _mm_set1_epi8(-128)),
+                    special);
+            }
+
+            PICORANGE_SIMD_TARGET("ssse3")
+            inline void validate_utf8_block_ssse3(__m128i input,
+                                                  __m128i& prev_input,
+                                                  __m128i& prev_incomplete,
+                                                  __m128i& error) noexcept
+            {
+                if (_mm_movemask_epi8(input) == 0) {
+                    // ASCII: only a sequence cut off by it is an error
+                    error = _mm_or_si128(error, prev_incomplete);
+                }
+                else {
+                    // Lead bytes too close to the end of the block
+                    const __m128i max_complete =
+                        _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                      -1, -1, -1, 0xf0 - 1 - 256,
+                                      0xe0 - 1 - 256, 0xc0 - 1 - 256);
+                    error = _mm_or_si128(error,
+                                         utf8_errors_ssse3(input, prev_input));
+                    prev_incomplete = _mm_subs_epu8(input, max_complete);
+                }
+                prev_input = input;
+            }
+
+            PICORANGE_SIMD_TARGET("ssse3")
+            inline bool validate_utf8_ssse3(const byte* first,
+                                            const byte* last) noexcept
+            {
+                __m128i prev_input = _mm_setzero_si128();
+                __m128i prev_incomplete = _mm_setzero_si128();
+                __m128i error = _mm_setzero_si128();
+                for (; last - first >= 16; first += 16) {
+                    validate_utf8_block_ssse3(
+                        _mm_loadu_si128(
+                            reinterpret_cast<const __m128i*>(first)),
+                        prev_input, prev_incomplete, error);
+                }
+                // Padded with ASCII zeros, which also catch a sequence cut off
+                // by the end of the input
+                byte tail[16] = {};
+                std::memcpy(tail, first,
+                            static_cast<std::size_t>(last - first));
+                validate_utf8_block_ssse3(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(tail)),
+                    prev_input, prev_incomplete, error);
+                return _mm_movemask_epi8(
+                           _mm_cmpeq_epi8(error, _mm_setzero_si128())) ==
+                       0xffff;
+            }
+#endif
+
+#if PICORANGE_HAS_AVX2 || PICORANGE_SIMD_RUNTIME_DISPATCH
+            // The bytes of the 32 bytes before input, from the end
+            template <int N>
+            PICORANGE_SIMD_TARGET("avx2")
+            __m256i utf8_prev_avx2(__m256i input, __m256i prev_input) noexcept
+            {
+                return _mm256_alignr_epi8(
+                    input, _mm256_permute2x128_si256(prev_input, input, 0x21),
+                    16 - N);
+            }
+
+            PICORANGE_SIMD_TARGET("avx2")
+            inline __m256i utf8_errors_avx2(__m256i input,
+                                            __m256i prev_input) noexcept
+            {
+                const auto& t = utf8_error_tables();
+                const __m256i nibble = _mm256_set1_epi8(0x0f);
+                const __m256i prev1 = utf8_prev_avx2<1>(input, prev_input);
+                const __m256i byte_1_high = _mm256_shuffle_epi8(
+                    broadcast_masks_avx2(t.byte_1_high),
+                    _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+                const __m256i byte_1_low = _mm256_shuffle_epi8(
+                    broadcast_masks_avx2(t.byte_1_low),
+                    _mm256_and_si256(prev1, nibble));
+                const __m256i byte_2_high = _mm256_shuffle_epi8(
+                    broadcast_masks_avx2(t.byte_2_high),
+                    _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+                const __m256i special = _mm256_and_si256(
+                    _mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+
+                const __m256i prev2 = utf8_prev_avx2<2>(input, prev_input);
+                const __m256i prev3 = utf8_prev_avx2<3>(input, prev_input);
+                const __m256i must_be_continuation = _mm256_or_si256(
+                    _mm256_subs_epu8(prev2, _mm256_set1_epi8(0xe0 - 0x80)),
+                    _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xf0 - 0x80)));
+                return _mm256_xor_si256(
+                    _mm256_and_si256(must_be_continuation,
+                                     _mm256_set1_epi8(-128)),
+                    special);
+            }
+
+            PICORANGE_SIMD_TARGET("avx2")
+            inline void validate_utf8_block_avx2(__m256i input,
+                                                 __m256i& prev_input,
+                                                 __m256i& prev_incomplete,
+                                                 __m256i& error) noexcept
+            {
+                if (_mm256_movemask_epi8(input) == 0) {
+                    error = _mm256_or_si256(error, prev_incomplete);
+                }
+                else {
+                    const __m256i max_complete = _mm256_setr_epi8(
+                        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                        -1, 0xf0 - 1 - 256, 0xe0 - 1 - 256, 0xc0 - 1 - 256);
+                    error = _mm256_or_si256(
+                        error, utf8_errors_avx2(input, prev_input));
+                    prev_incomplete = _mm256_subs_epu8(input, max_complete);
+                }
+                prev_input = input;
+            }
+
+            PICORANGE_SIMD_TARGET("avx2")
+            inline bool validate_utf8_avx2(const byte* first,
+                                           const byte* last) noexcept
+            {
+                __m256i prev_input = _mm256_setzero_si256();
+                __m256i prev_incomplete = _mm256_setzero_si256();
+                __m256i error = _mm256_setzero_si256();
+                for (; last - first >= 32; first += 32) {
+                    validate_utf8_block_avx2(
+                        _mm256_loadu_si256(
+                            reinterpret_cast<const __m256i*>(first)),
+                        prev_input, prev_incomplete, error);
+                }
+                byte tail[32] = {};
+                std::memcpy(tail, first,
+                            static_cast<std::size_t>(last - first));
+                validate_utf8_block_avx2(
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tail)),
+                    prev_input, prev_incomplete, error);
+                return _mm256_testz_si256(error, error) != 0;
+            }
+#endif
+
+            inline bool validate_utf8(const byte* first,
+                                      const byte* last) noexcept
+            {
+#if PICORANGE_HAS_AVX2
+                return validate_utf8_avx2(first, last);
+#else
+#if PICORANGE_SIMD_RUNTIME_DISPATCH
+                if (get_cpu_features().avx2) {
+                    return validate_utf8_avx2(first, last);
+                }
+                if (get_cpu_features().ssse3) {
+                    return validate_utf8_ssse3(first, last);
+                }
+#elif PICORANGE_HAS_SSSE3
+                return validate_utf8_ssse3(first, last);
+#endif
+                return validate_utf8_scalar(first, last);
+#endif
+            }
+
+            // byte_histogram: counts[b] += occurrences of b in [first, last)
+            //
+            // Runs of the same byte would make every increment wait for the
+            // store of the previous one. Four interleaved tables keep four
+            // independent chains in flight.
+            //
+            // The tables are kept across calls to add(), so that many short
+            // ranges, like the segments of a std::deque, can be counted
+            // without clearing and flushing them every time.
+            class byte_histogram_accumulator {
+            public:
+                byte_histogram_accumulator() noexcept
+                {
+                    std::memset(m_tables, 0, sizeof(m_tables));
+                }
+
+                void add(const byte* first,
+                         const byte* last,
+                         std::size_t* counts) noexcept
+                {
+                    while (first != last) {
+                        // Flush before the 32-bit counters can overflow
+                        auto n = last - first;
+                        if (n > max_pending - m_pending) {
+                            n = max_pending - m_pending;
+                        }
+                        const byte* const end = first + n;
+                        for (; end - first >= 4; first += 4) {
+                            ++m_tables[0][first[0]];
+                            ++m_tables[1][first[1]];
+                            ++m_tables[2][first[2]];
+                            ++m_tables[3][first[3]];
+                        }
+                        for (; first != end; ++first) {
+                            ++m_tables[0][*first];
+                        }
+                        m_pending += n;
+                        if (m_pending == max_pending) {
+                            flush(counts);
+                        }
+                    }
+                }
+
+                void flush(std::size_t* counts) noexcept
+                {
+                    for (unsigned b = 0; b < 256; ++b) {
+                        counts[b] += std::size_t{m_tables[0][b]} +
+                                     m_tables[1][b] + m_tables[2][b] +
+                                     m_tables[3][b];
+                    }
+                    std::memset(m_tables, 0, sizeof(m_tables));
+                    m_pending = 0;
+                }
+
+            private:
+                static constexpr std::ptrdiff_t max_pending =
+                    std::ptrdiff_t{1} << 30;
+
+                std::uint32_t m_tables[4][256];
+                std::ptrdiff_t m_pending{0};
+            };
+
+            inline void byte_histogram(const byte* first,
+                                       const byte* last,
+                                       std::size_t* counts) noexcept
+            {
+                byte_histogram_accumulator acc;
+                acc.add(first, last, counts);
+                acc.flush(counts);
+            }
+        }  // namespace simd
+    }      // namespace detail
+
+    PICORANGE_END_NAMESPACE
+}  // namespace picorange
+
+#endif  // PICORANGE_SIMD_H
@@ -0,0 +1,3278 @@
+// Copyright 2017-2019 Elias Kosunen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// This file is a part of picorange:
+//     https://github.com/eliaskosunen/picorange
+
+#ifndef PICORANGE_VIEWS_H
+#define PICORANGE_VIEWS_H
+
+#include "algorithm.h"
+#include "picorange.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace picorange {
+    PICORANGE_BEGIN_NAMESPACE
+
+    namespace detail {
+        // Function object, which can be applied to a range with
+        // `range | closure`, and composed with `closure | closure`
+        template <typename F>
+        struct range_adaptor_closure {
+            range_adaptor_closure() = default;
+            constexpr explicit range_adaptor_closure(F fn) : m_fn(std::move(fn))
+            {
+            }
+
+            template <typename R>
+            constexpr auto operator()(R&& r) const
+                -> decltype(std::declval<const F&>()(std::forward<R>(r)))
+            {
+                return m_fn(std::forward<R>(r));
+            }
+
+            F m_fn{};
+        };
+
+        template <typename First, typename Second>
+        struct composed_adaptor {
+            template <typename R>
+            constexpr auto operator()(R&& r) const
+                -> decltype(std::declval<const Second&>()(
+                    std::declval<const First&>()(std::forward<R>(r))))
+            {
+                return m_second(m_first(std::forward<R>(r)));
+            }
+
+            First m_first;
+            Second m_second;
+        };
+
+        template <typename R,
+                  typename F,
+                  typename std::enable_if<range<
+                      typename std::remove_reference<R>::type>::value>::type* =
+                      nullptr>
+        constexpr auto operator|(R&& r, const range_adaptor_closure<F>& c)
+            -> decltype(c(std::forward<R>(r)))
+        {
+            return c(std::forward<R>(r));
+        }
+
+        template <typename F, typename G>
+        constexpr auto operator|(const range_adaptor_closure<F>& first,
+                                 const range_adaptor_closure<G>& second)
+            -> range_adaptor_closure<
+                composed_adaptor<range_adaptor_closure<F>,
+                                 range_adaptor_closure<G>>>
+        {
+            return range_adaptor_closure<composed_adaptor<
+                range_adaptor_closure<F>, range_adaptor_closure<G>>>{
+                {first, second}};
+        }
+
+        // Binds the trailing argument of a two-argument adaptor,
+        // turning `views::filter(pred)` into a closure
+        template <typename Adaptor, typename Arg>
+        struct bind_back_adaptor {
+            template <typename R>
+            constexpr auto operator()(R&& r) const -> decltype(
+                Adaptor{}(std::forward<R>(r), std::declval<const Arg&>()))
+            {
+                return Adaptor{}(std::forward<R>(r), m_arg);
+            }
+
+            Arg m_arg;
+        };
+
+        template <typename Adaptor, typename Arg>
+        constexpr auto make_bound_adaptor(Arg&& arg) -> range_adaptor_closure<
+            bind_back_adaptor<Adaptor, typename std::decay<Arg>::type>>
+        {
+            return range_adaptor_closure<
+                bind_back_adaptor<Adaptor, typename std::decay<Arg>::type>>{
+                {std::forward<Arg>(arg)}};
+        }
+
+        // Memoizes the result of begin() for views, which compute it in
+        // linear time. The cached iterator refers into the view it was
+        // computed for, so copies and moves of the view start out empty.
+        template <typename T>
+        class non_propagating_cache {
+        public:
+            non_propagating_cache() noexcept {}
+            non_propagating_cache(const non_propagating_cache&) noexcept {}
+            non_propagating_cache(non_propagating_cache&& o) noexcept
+            {
+                o.reset();
+            }
+            non_propagating_cache& operator=(
+                const non_propagating_cache& o) noexcept
+            {
+                if (this != std::addressof(o)) {
+                    reset();
+                }
+                return *this;
+            }
+            non_propagating_cache& operator=(
+                non_propagating_cache&& o) noexcept
+            {
+                reset();
+                o.reset();
+                return *this;
+            }
+
+            ~non_propagating_cache()
+            {
+                reset();
+            }
+
+            bool has_value() const noexcept
+            {
+                return m_engaged;
+            }
+
+            T& operator*() noexcept
+            {
+                PICORANGE_EXPECT(m_engaged);
+                return *reinterpret_cast<T*>(m_storage);
+            }
+            const T& operator*() const noexcept
+            {
+                PICORANGE_EXPECT(m_engaged);
+                return *reinterpret_cast<const T*>(m_storage);
+            }
+
+            template <typename... Args>
+            T& emplace(Args&&... args)
+            {
+                reset();
+                ::new (static_cast<void*>(m_storage))
+                    T(std::forward<Args>(args)...);
+                m_engaged = true;
+                return **this;
+            }
+
+            void reset() noexcept
+            {
+                if (m_engaged) {
+                    (**this).~T();
+                    m_engaged = false;
+                }
+            }
+
+        private:
+            alignas(T) unsigned char m_storage[sizeof(T)];
+            bool m_engaged{false};
+        };
+
+        template <typename R, bool = range<R>::value>
+        struct is_forward_range : std::false_type {
+        };
+        template <typename R>
+        struct is_forward_range<R, true>
+            : std::is_base_of<forward_iterator_tag,
+                              iterator_category_t<iterator_t<R>>> {
+        };
+    }  // namespace detail
+
+#if PICORANGE_STD_RANGES
+    using std::ranges::drop_view;
+    using std::ranges::drop_while_view;
+    using std::ranges::filter_view;
+    using std::ranges::ref_view;
+    using std::ranges::single_view;
+    using std::ranges::take_view;
+    using std::ranges::take_while_view;
+    using std::ranges::transform_view;
+
+    namespace views {
+        template <typename R>
+        using all_t = std::views::all_t<R>;
+
+        namespace {
+            constexpr auto& all = std::views::all;
+            constexpr auto& single = std::views::single;
+            constexpr auto& transform = std::views::transform;
+            constexpr auto& filter = std::views::filter;
+            constexpr auto& take = std::views::take;
+            constexpr auto& drop = std::views::drop;
+            constexpr auto& take_while = std::views::take_while;
+            constexpr auto& drop_while = std::views::drop_while;
+            constexpr auto& counted = std::views::counted;
+        }  // namespace
+    }      // namespace views
+#else
+    namespace detail {
+        template <bool Const, typename T>
+        using maybe_const_t =
+            typename std::conditional<Const, const T, T>::type;
+
+        // The weaker one of two iterator categories
+        template <typename Tag, typename Max>
+        using capped_iterator_category_t =
+            typename std::conditional<std::is_base_of<Max, Tag>::value,
+                                      Max,
+                                      Tag>::type;
+
+        template <typename R, typename = void>
+        struct is_common_range : std::false_type {
+        };
+        template <typename R>
+        struct is_common_range<R, void_t<iterator_t<R>, sentinel_t<R>>>
+            : std::is_same<iterator_t<R>, sentinel_t<R>> {
+        };
+
+        template <typename R, bool = range<R>::value>
+        struct is_sized_random_access_range : std::false_type {
+        };
+        template <typename R>
+        struct is_sized_random_access_range<R, true>
+            : std::integral_constant<
+                  bool,
+                  sized_range<R>::value &&
+                      random_access_iterator<iterator_t<R>>::value> {
+        };
+
+        // Holds a function object of a view.
+        // Lambdas are neither default constructible nor copy assignable,
+        // but views need to be both, so those are stored in a manually
+        // managed buffer instead.
+        template <typename T,
+                  bool = std::is_default_constructible<T>::value &&
+                         std::is_copy_assignable<T>::value>
+        class movable_box {
+        public:
+            movable_box() = default;
+            constexpr movable_box(const T& t) : m_value(t) {}
+            constexpr movable_box(T&& t) : m_value(std::move(t)) {}
+
+            PICORANGE_CONSTEXPR14 T& operator*() noexcept
+            {
+                return m_value;
+            }
+            constexpr const T& operator*() const noexcept
+            {
+                return m_value;
+            }
+
+        private:
+            T m_value{};
+        };
+        template <typename T>
+        class movable_box<T, false> {
+        public:
+            movable_box() noexcept {}
+            movable_box(const T& t)
+            {
+                construct(t);
+            }
+            movable_box(T&& t)
+            {
+                construct(std::move(t));
+            }
+
+            movable_box(const movable_box& o)
+            {
+                if (o.m_engaged) {
+                    construct(*o);
+                }
+            }
+            movable_box(movable_box&& o)
+            {
+                if (o.m_engaged) {
+                    construct(std::move(*o));
+                }
+            }
+            movable_box& operator=(const movable_box& o)
+            {
+                if (this != std::addressof(o)) {
+                    reset();
+                    if (o.m_engaged) {
+                        construct(*o);
+                    }
+                }
+                return *this;
+            }
+            movable_box& operator=(movable_box&& o)
+            {
+                if (this != std::addressof(o)) {
+                    reset();
+                    if (o.m_engaged) {
+                        construct(std::move(*o));
+                    }
+                }
+                return *this;
+            }
+
+            ~movable_box()
+            {
+                reset();
+            }
+
+            T& operator*() noexcept
+            {
+                PICORANGE_EXPECT(m_engaged);
+                return *reinterpret_cast<T*>(m_storage);
+            }
+            const T& operator*() const noexcept
+            {
+                PICORANGE_EXPECT(m_engaged);
+                return *reinterpret_cast<const T*>(m_storage);
+            }
+
+        private:
+            template <typename... Args>
+            void construct(Args&&... args)
+            {
+                ::new (static_cast<void*>(m_storage))
+                    T(std::forward<Args>(args)...);
+                m_engaged = true;
+            }
+            void reset() noexcept
+            {
+                if (m_engaged) {
+                    (**this).~T();
+                    m_engaged = false;
+                }
+            }
+
+            alignas(T) unsigned char m_storage[sizeof(T)];
+            bool m_engaged{false};
+        };
+    }  // namespace detail
+
+    // single_view
+    template <typename T>
+    class single_view : public view_interface<single_view<T>> {
+        static_assert(std::is_object<T>::value, "");
+
+    public:
+        single_view() = default;
+        constexpr explicit single_view(const T& t) : m_value(t) {}
+        constexpr explicit single_view(T&& t) : m_value(std::move(t)) {}
+
+        PICORANGE_CONSTEXPR14 T* begin() noexcept
+        {
+            return data();
+        }
+        constexpr const T* begin() const noexcept
+        {
+            return data();
+        }
+        PICORANGE_CONSTEXPR14 T* end() noexcept
+        {
+            return data() + 1;
+        }
+        constexpr const T* end() const noexcept
+        {
+            return data() + 1;
+        }
+
+        static constexpr std::size_t size() noexcept
+        {
+            return 1;
+        }
+
+        PICORANGE_CONSTEXPR14 T* data() noexcept
+        {
+            return std::addressof(*m_value);
+        }
+        constexpr const T* data() const noexcept
+        {
+            return std::addressof(*m_value);
+        }
+
+    private:
+        detail::movable_box<T> m_value{};
+    };
+
+    // ref_view
+    template <typename R>
+    class ref_view : public view_interface<ref_view<R>> {
+        static_assert(range<R>::value && std::is_object<R>::value, "");
+
+    public:
+        ref_view() = default;
+        constexpr ref_view(R& r) noexcept : m_range(std::addressof(r)) {}
+
+        constexpr R& base() const
+        {
+            return *m_range;
+        }
+
+        constexpr iterator_t<R> begin() const
+        {
+            return ::picorange::begin(*m_range);
+        }
+        constexpr sentinel_t<R> end() const
+        {
+            return ::picorange::end(*m_range);
+        }
+
+        template <typename RR = R,
+                  typename std::enable_if<sized_range<RR>::value>::type* =
+                      nullptr>
+        constexpr auto size() const
+            -> decltype(::picorange::size(std::declval<RR&>()))
+        {
+            return ::picorange::size(*m_range);
+        }
+
+        template <typename RR = R,
+                  typename std::enable_if<contiguous_range<RR>::value>::type* =
+                      nullptr>
+        constexpr auto data() const
+            -> decltype(::picorange::data(std::declval<RR&>()))
+        {
+            return ::picorange::data(*m_range);
+        }
+
+    private:
+        R* m_range{nullptr};
+    };
+
+    // views::all
+    namespace views {
+        namespace _all {
+            struct fn {
+            private:
+                template <typename R,
+                          typename std::enable_if<view<
+                              typename std::decay<R>::type>::value>::type* =
+                              nullptr>
+                static constexpr auto impl(R&& r, priority_tag<2>) ->
+                    typename std::decay<R>::type
+                {
+                    return std::forward<R>(r);
+                }
+
+                template <typename R,
+                          typename std::enable_if<
+                              std::is_lvalue_reference<R>::value &&
+                              range<typename std::remove_reference<R>::type>::
+                                  value>::type* = nullptr>
+                static constexpr auto impl(R&& r, priority_tag<1>)
+                    -> ref_view<typename std::remove_reference<R>::type>
+                {
+                    return ref_view<typename std::remove_reference<R>::type>{
+                        r};
+                }
+
+                template <typename R,
+                          typename std::enable_if<
+                              forwarding_range<R>::value>::type* = nullptr>
+                static constexpr auto impl(R&& r, priority_tag<0>)
+                    -> subrange<iterator_t<R>, sentinel_t<R>>
+                {
+                    return {::picorange::begin(std::forward<R>(r)),
+                            ::picorange::end(std::forward<R>(r))};
+                }
+
+            public:
+                template <typename R>
+                constexpr auto operator()(R&& r) const
+                    -> decltype(fn::impl(std::forward<R>(r), priority_tag<2>{}))
+                {
+                    return fn::impl(std::forward<R>(r), priority_tag<2>{});
+                }
+            };
+        }  // namespace _all
+        namespace {
+            constexpr auto& all =
+                static_const<detail::range_adaptor_closure<_all::fn>>::value;
+        }
+
+        template <typename R>
+        using all_t = decltype(::picorange::views::all(std::declval<R>()));
+
+        // single
+        namespace _single {
+            struct fn {
+                template <typename T>
+                constexpr auto operator()(T&& t) const
+                    -> single_view<typename std::decay<T>::type>
+                {
+                    return single_view<typename std::decay<T>::type>{
+                        std::forward<T>(t)};
+                }
+            };
+        }  // namespace _single
+        namespace {
+            constexpr auto& single = static_const<_single::fn>::value;
+        }
+    }  // namespace views
+
+    // transform_view
+    template <typename V, typename F>
+    class transform_view : public view_interface<transform_view<V, F>> {
+        static_assert(view<V>::value, "");
+
+        template <bool Const>
+        class iterator {
+            friend class iterator<!Const>;
+
+            using parent_type = detail::maybe_const_t<Const, transform_view>;
+            using base_type = detail::maybe_const_t<Const, V>;
+            using base_iterator = iterator_t<base_type>;
+
+        public:
+            using iterator_category = detail::capped_iterator_category_t<
+                iterator_category_t<base_iterator>,
+                random_access_iterator_tag>;
+            using reference =
+                decltype(std::declval<detail::maybe_const_t<Const, F>&>()(
+                    *std::declval<const base_iterator&>()));
+            using value_type = remove_cvref_t<reference>;
+            using difference_type = iter_difference_t<base_iterator>;
+            using pointer = void;
+
+            iterator() = default;
+            constexpr iterator(parent_type& parent, base_iterator current)
+                : m_current(std::move(current)),
+                  m_parent(std::addressof(parent))
+            {
+            }
+            template <bool C = Const,
+                      typename std::enable_if<
+                          C && std::is_convertible<iterator_t<V>,
+                                                   base_iterator>::value>::
+                          type* = nullptr>
+            constexpr iterator(iterator<!C> i)
+                : m_current(std::move(i.m_current)), m_parent(i.m_parent)
+            {
+            }
+
+            constexpr const base_iterator& base() const noexcept
+            {
+                return m_current;
+            }
+
+            constexpr reference operator*() const
+            {
+                return (*m_parent->m_fun)(*m_current);
+            }
+
+            PICORANGE_CONSTEXPR14 iterator& operator++()
+            {
+                ++m_current;
+                return *this;
+            }
+            PICORANGE_CONSTEXPR14 iterator operator++(int)
+            {
+                auto tmp = *this;
+                ++*this;
+                return tmp;
+            }
+
+            template <typename B = base_iterator,
+                      typename std::enable_if<
+                          bidirectional_iterator<B>::value>::type* = nullptr>
+            PICORANGE_CONSTEXPR14 iterator& operator--()
+            {
+                --m_current;
+                return *this;
+            }
+            template <typename B = base_iterator,
+                      typename std::enable_if<
+                          bidirectional_iterator<B>::value>::type* = nullptr>
+            PICORANGE_CONSTEXPR14 iterator operator--(int)
+            {
+                auto tmp = *this;
+                --*this;
+                return tmp;
+            }
+
+            template <typename B = base_iterator,
+                      typename std::enable_if<
+                          random_access_iterator<B>::value>::type* = nullptr>
+            PICORANGE_CONSTEXPR14 iterator& operator+=(difference_type n)
+            {
+                m_current += n;
+                return *this;
+            }
+            template <typename B = base_iterator,
+                      typename std::enable_if<
+                          random_access_iterator<B>::value>::type* = nullptr>
+            PICORANGE_CONSTEXPR14 iterator& operator-=(difference_type n)
+            {
+                m_current -= n;
+                return *this;
+            }
+            template <typename B = base_iterator,
+                      typename std::enable_if<
+                          random_access_iterator<B>::value>::type* = nullptr>
+            constexpr reference operator[](difference_type n) const
+            {
+                return (*m_parent->m_fun)(m_current[n]);
+            }
+
+            friend constexpr bool operator==(const iterator& x,
+                                             const iterator& y)
+            {
+                return x.m_current == y.m_current;
+            }
+            friend constexpr bool operator!=(const iterator& x,
+                                             const iterator& y)
+            {
+                return !(x == y);
+            }
+
+            template <typename B = base_iterator,
+                      typename std::enable_if<
+                          random_access_iterator<B>::value>::type* = nullptr>
+            friend constexpr bool operator<(const iterator& x,
+                                            const iterator& y)
+            {
+                return x.m_current < y.m_current;
+            }
+            template <typename B = base_iterator,
+                      typename std::enable_if<
+                          random_access_iterator<B>::value>::type* = nullptr>
+            friend constexpr bool operator>(const iterator& x,
+                                            const iterator& y)
+            {
+                return y < x;
+            }
+            template <typename B = base_iterator,
+                      typename std::enable_if<
+                          random_access_iterator<B>::value>::type* = nullptr>
+            friend constexpr bool operator<=(const iterator& x,
+                                             const iterator& y)
+            {
+                return !(y < x);
+            }
+            template <typename B = base_iterator,
+                      typename std::enable_if<
+                          random_access_iterator<B>::value>::type* = nullptr>
+            friend constexpr bool operator>=(const iterator& x,
+                                             const iterator& y)
+            {
+                return !(x < y);
+            }
+
+            template <typename B = base_iterator,
+                      typename std::enable_if<
+                          random_access_iterator<B>::value>::type* = nullptr>
+            friend constexpr iterator operator+(iterator i, difference_type n)
+            {
+                return iterator{*i.m_parent, i.m_current + n};
+            }
+            template <typename B = base_iterator,
+                      typename std::enable_if<
+                          random_access_iterator<B>::value>::type* = nullptr>
+            friend constexpr iterator operator+(difference_type n, iterator i)
+            {
+                return iterator{*i.m_parent, i.m_current + n};
+            }
+            template <typename B = base_iterator,
+                      typename std::enable_if<
+                          random_access_iterator<B>::value>::type* = nullptr>
+            friend constexpr iterator operator-(iterator i, difference_type n)
+            {
+                return iterator{*i.m_parent, i.m_current - n};
+            }
+            template <typename B = base_iterator,
+                      typename std::enable_if<
+                          sized_sentinel_for<B, B>::value>::type* = nullptr>
+            friend constexpr difference_type operator-(const iterator& x,
+                                                       const iterator& y)
+            {
+                return x.m_current - y.m_current;
+            }
+
+        private:
+            base_iterator m_current{};
+            parent_type* m_parent{nullptr};
+        };
+
+        template <bool Const>
+        class sentinel {
+            friend class sentinel<!Const>;
+
+            using parent_type = detail::maybe_const_t<Const, transform_view>;
+            using base_type = detail::maybe_const_t<Const, V>;
+            using base_iterator = iterator_t<base_type>;
+            using base_sentinel = sentinel_t<base_type>;
+
+        public:
+            sentinel() = default;
+            constexpr sentinel(parent_type&, base_sentinel end)
+                : m_end(std::move(end))
+            {
+            }
+            template <bool C = Const,
+                      typename std::enable_if<
+                          C && std::is_convertible<sentinel_t<V>,
+                                                   base_sentinel>::value>::
+                          type* = nullptr>
+            constexpr sentinel(sentinel<!C> s) : m_end(std::move(s.m_end))
+            {
+            }
+
+            constexpr base_sentinel base() const
+            {
+                return m_end;
+            }
+
+            friend constexpr bool operator==(const iterator<Const>& x,
+                                             const sentinel& y)
+            {
+                return x.base() == y.m_end;
+            }
+            friend constexpr bool operator==(const sentinel& y,
+                                             const iterator<Const>& x)
+            {
+                return x.base() == y.m_end;
+            }
+            friend constexpr bool operator!=(const iterator<Const>& x,
+                                             const sentinel& y)
+            {
+                return !(x == y);
+            }
+            friend constexpr bool operator!=(const sentinel& y,
+                                             const iterator<Const>& x)
+            {
+                return !(x == y);
+            }
+
+            template <typename B = base_iterator,
+                      typename std::enable_if<
+                          sized_sentinel_for<base_sentinel, B>::value>::type* =
+                          nullptr>
+            friend constexpr iter_difference_t<B> operator-(
+                const iterator<Const>& x,
+                const sentinel& y)
+            {
+                return x.base() - y.m_end;
+            }
+            template <typename B = base_iterator,
+                      typename std::enable_if<
+                          sized_sentinel_for<base_sentinel, B>::value>::type* =
+                          nullptr>
+            friend constexpr iter_difference_t<B> operator-(
+                const sentinel& y,
+                const iterator<Const>& x)
+            {
+                return y.m_end - x.base();
+            }
+
+        private:
+            base_sentinel m_end{};
+        };
+
+        template <bool Const>
+        using end_type = typename std::conditional<
+            detail::is_common_range<detail::maybe_const_t<Const, V>>::value,
+            iterator<Const>,
+            sentinel<Const>>::type;
+
+    public:
+        transform_view() = default;
+        constexpr transform_view(V base, F fun)
+            : m_base(std::move(base)), m_fun(std::move(fun))
+        {
+        }
+
+        constexpr V base() const
+        {
+            return m_base;
+        }
+
+        PICORANGE_CONSTEXPR14 iterator<false> begin()
+        {
+            return {*this, ::picorange::begin(m_base)};
+        }
+        template <typename VV = V,
+                  typename = decltype(std::declval<const F&>()(
+                      *::picorange::begin(std::declval<const VV&>())))>
+        constexpr iterator<true> begin() const
+        {
+            return {*this, ::picorange::begin(m_base)};
+        }
+
+        PICORANGE_CONSTEXPR14 end_type<false> end()
+        {
+            return {*this, ::picorange::end(m_base)};
+        }
+        template <typename VV = V,
+                  typename = decltype(std::declval<const F&>()(
+                      *::picorange::begin(std::declval<const VV&>())))>
+        constexpr end_type<true> end() const
+        {
+            return {*this, ::picorange::end(m_base)};
+        }
+
+        template <typename VV = V,
+                  typename std::enable_if<sized_range<VV>::value>::type* =
+                      nullptr>
+        PICORANGE_CONSTEXPR14 auto size()
+            -> decltype(::picorange::size(std::declval<VV&>()))
+        {
+            return ::picorange::size(m_base);
+        }
+        template <typename VV = V,
+                  typename std::enable_if<
+                      sized_range<const VV>::value>::type* = nullptr>
+        constexpr auto size() const
+            -> decltype(::picorange::size(std::declval<const VV&>()))
+        {
+            return ::picorange::size(m_base);
+        }
+
+    private:
+        V m_base{};
+        detail::movable_box<F> m_fun{};
+    };
+
+    // filter_view
+    template <typename V, typename Pred>
+    class filter_view : public view_interface<filter_view<V, Pred>> {
+        static_assert(view<V>::value, "");
+
+        using base_iterator = iterator_t<V>;
+        using base_sentinel = sentinel_t<V>;
+
+        class iterator {
+        public:
+            using iterator_category = detail::capped_iterator_category_t<
+                iterator_category_t<base_iterator>,
+                bidirectional_iterator_tag>;
+            using value_type = iter_value_t<base_iterator>;
+            using difference_type = iter_difference_t<base_iterator>;
+            using reference = iter_reference_t<base_iterator>;
+            using pointer = void;
+
+            iterator() = default;
+            constexpr iterator(filter_view& parent, base_iterator current)
+                : m_current(std::move(current)),
+                  m_parent(std::addressof(parent))
+            {
+            }
+
+            constexpr const base_iterator& base() const noexcept
+            {
+                return m_current;
+            }
+
+            constexpr reference operator*() const
+            {
+                return *m_current;
+            }
+
+            PICORANGE_CONSTEXPR14 iterator& operator++()
+            {
+                m_current = m_parent->find_next(std::move(++m_current));
+                return *this;
+            }
+            PICORANGE_CONSTEXPR14 iterator operator++(int)
+            {
+                auto tmp = *this;
+                ++*this;
+                return tmp;
+            }
+
+            template <typename B = base_iterator,
+                      typename std::enable_if<
+                          bidirectional_iterator<B>::value>::type* = nullptr>
+            PICORANGE_CONSTEXPR14 iterator& operator--()
+            {
+                do {
+                    --m_current;
+                } while (!(*m_parent->m_pred)(*m_current));
+                return *this;
+            }
+            template <typename B = base_iterator,
+                      typename std::enable_if<
+                          bidirectional_iterator<B>::value>::type* = nullptr>
+            PICORANGE_CONSTEXPR14 iterator operator--(int)
+            {
+                auto tmp = *this;
+                --*this;
+                return tmp;
+            }
+
+            friend constexpr bool operator==(const iterator& x,
+                                             const iterator& y)
+            {
+                return x.m_current == y.m_current;
+            }
+            friend constexpr bool operator!=(const iterator& x,
+                                             const iterator& y)
+            {
+                return !(x == y);
+            }
+
+        private:
+            base_iterator m_current{};
+            filter_view* m_parent{nullptr};
+        };
+
+        class sentinel {
+        public:
+            sentinel() = default;
+            constexpr sentinel(filter_view&, base_sentinel end)
+                : m_end(std::move(end))
+            {
+            }
+
+            constexpr base_sentinel base() const
+            {
+                return m_end;
+            }
+
+            friend constexpr bool operator==(const iterator& x,
+                                             const sentinel& y)
+            {
+                return x.base() == y.m_end;
+            }
+            friend constexpr bool operator==(const sentinel& y,
+                                             const iterator& x)
+            {
+                return x.base() == y.m_end;
+            }
+            friend constexpr bool operator!=(const iterator& x,
+                                             const sentinel& y)
+            {
+                return !(x == y);
+            }
+            friend constexpr bool operator!=(const sentinel& y,
+                                             const iterator& x)
+            {
+                return !(x == y);
+            }
+
+        private:
+            base_sentinel m_end{};
+        };
+
+        using end_type =
+            typename std::conditional<detail::is_common_range<V>::value,
+                                      iterator,
+                                      sentinel>::type;
+
+    public:
+        filter_view() = default;
+        constexpr filter_view(V base, Pred pred)
+            : m_base(std::move(base)), m_pred(std::move(pred))
+        {
+        }
+
+        constexpr V base() const
+        {
+            return m_base;
+        }
+        constexpr const Pred& pred() const
+        {
+            return *m_pred;
+        }
+
+        // Not const: the first element is searched for once, and cached
+        // for forward ranges, making repeated calls O(1)
+        PICORANGE_CONSTEXPR14 iterator begin()
+        {
+            return {*this, find_begin(detail::is_forward_range<V>{})};
+        }
+        PICORANGE_CONSTEXPR14 end_type end()
+        {
+            return {*this, ::picorange::end(m_base)};
+        }
+
+    private:
+        PICORANGE_CONSTEXPR14 base_iterator find_begin(std::true_type)
+        {
+            if (!m_begin.has_value()) {
+                m_begin.emplace(find_next(::picorange::begin(m_base)));
+            }
+            return *m_begin;
+        }
+        PICORANGE_CONSTEXPR14 base_iterator find_begin(std::false_type)
+        {
+            return find_next(::picorange::begin(m_base));
+        }
+
+        PICORANGE_CONSTEXPR14 base_iterator find_next(base_iterator it)
+        {
+            const auto last = ::picorange::end(m_base);
+            while (it != last && !(*m_pred)(*it)) {
+                ++it;
+            }
+            return it;
+        }
+
+        V m_base{};
+        detail::movable_box<Pred> m_pred{};
+        detail::non_propagating_cache<base_iterator> m_begin{};
+    };
+
+    // take_view
+    template <typename V>
+    class take_view : public view_interface<take_view<V>> {
+        static_assert(view<V>::value, "");
+
+        // Unsized ranges can end before the count runs out
+        template <bool Const>
+        class sentinel {
+            friend class sentinel<!Const>;
+
+            using base_type = detail::maybe_const_t<Const, V>;
+            using base_iterator = iterator_t<base_type>;
+            using base_sentinel = sentinel_t<base_type>;
+            using iterator = counted_iterator<base_iterator>;
+
+        public:
+            sentinel() = default;
+            constexpr explicit sentinel(base_sentinel end)
+                : m_end(std::move(end))
+            {
+            }
+            template <bool C = Const,
+                      typename std::enable_if<
+                          C && std::is_convertible<sentinel_t<V>,
+                                                   base_sentinel>::value>::
+                          type* = nullptr>
+            constexpr sentinel(sentinel<!C> s) : m_end(std::move(s.m_end))
+            {
+            }
+
+            constexpr base_sentinel base() const
+            {
+                return m_end;
+            }
+
+            friend constexpr bool operator==(const iterator& x,
+                                             const sentinel& y)
+            {
+                return x.count() == 0 || x.base() == y.m_end;
+            }
+            friend constexpr bool operator==(const sentinel& y,
+                                             const iterator& x)
+            {
+                return x == y;
+            }
+            friend constexpr bool operator!=(const iterator& x,
+                                             const sentinel& y)
+            {
+                return !(x == y);
+            }
+            friend constexpr bool operator!=(const sentinel& y,
+                                             const iterator& x)
+            {
+                return !(x == y);
+            }
+
+        private:
+            base_sentinel m_end{};
+        };
+
+        // 2: sized random access ranges keep their own iterator type, so
+        //    that contiguity is preserved
+        // 1: other sized ranges use a counted_iterator and default_sentinel
+        // 0: unsized ranges use a counted_iterator and a sentinel
+        template <typename Base>
+        using kind = std::integral_constant<
+            int,
+            detail::is_sized_random_access_range<Base>::value
+                ? 2
+                : sized_range<Base>::value ? 1 : 0>;
+
+        template <typename Base>
+        static PICORANGE_CONSTEXPR14 range_difference_t<Base>
+        clamp_count(Base& base, range_difference_t<Base> n, std::true_type)
+        {
+            const auto s =
+                static_cast<range_difference_t<Base>>(::picorange::size(base));
+            return n < s ? n : s;
+        }
+        template <typename Base>
+        static constexpr range_difference_t<Base>
+        clamp_count(Base&, range_difference_t<Base> n, std::false_type)
+        {
+            return n;
+        }
+
+        template <typename Base>
+        static constexpr iterator_t<Base> begin_impl(
+            Base& base,
+            range_difference_t<Base>,
+            std::integral_constant<int, 2>)
+        {
+            return ::picorange::begin(base);
+        }
+        template <typename Base, int K>
+        static constexpr counted_iterator<iterator_t<Base>> begin_impl(
+            Base& base,
+            range_difference_t<Base> n,
+            std::integral_constant<int, K>)
+        {
+            return {::picorange::begin(base),
+                    take_view::clamp_count(base, n, sized_range<Base>{})};
+        }
+
+        template <typename Base>
+        static constexpr iterator_t<Base> end_impl(
+            Base& base,
+            range_difference_t<Base> n,
+            std::integral_constant<int, 2>)
+        {
+            return ::picorange::begin(base) +
+                   take_view::clamp_count(base, n, std::true_type{});
+        }
+        template <typename Base>
+        static constexpr default_sentinel_t end_impl(
+            Base&,
+            range_difference_t<Base>,
+            std::integral_constant<int, 1>)
+        {
+            return {};
+        }
+        template <typename Base>
+        static constexpr sentinel<std::is_const<Base>::value> end_impl(
+            Base& base,
+            range_difference_t<Base>,
+            std::integral_constant<int, 0>)
+        {
+            return sentinel<std::is_const<Base>::value>{
+                ::picorange::end(base)};
+        }
+
+    public:
+        take_view() = default;
+        PICORANGE_CONSTEXPR14 take_view(V base, range_difference_t<V> count)
+            : m_base(std::move(base)), m_count(count)
+        {
+            PICORANGE_EXPECT(count >= 0);
+        }
+
+        constexpr V base() const
+        {
+            return m_base;
+        }
+
+        PICORANGE_CONSTEXPR14 auto begin() -> decltype(
+            take_view::begin_impl(std::declval<V&>(), 0, kind<V>{}))
+        {
+            return take_view::begin_impl(m_base, m_count, kind<V>{});
+        }
+        template <typename VV = V,
+                  typename std::enable_if<range<const VV>::value>::type* =
+                      nullptr>
+        constexpr auto begin() const -> decltype(take_view::begin_impl(
+            std::declval<const VV&>(),
+            0,
+            kind<const VV>{}))
+        {
+            return take_view::begin_impl(m_base, m_count, kind<const VV>{});
+        }
+
+        PICORANGE_CONSTEXPR14 auto end() -> decltype(
+            take_view::end_impl(std::declval<V&>(), 0, kind<V>{}))
+        {
+            return take_view::end_impl(m_base, m_count, kind<V>{});
+        }
+        template <typename VV = V,
+                  typename std::enable_if<range<const VV>::value>::type* =
+                      nullptr>
+        constexpr auto end() const -> decltype(take_view::end_impl(
+            std::declval<const VV&>(),
+            0,
+            kind<const VV>{}))
+        {
+            return take_view::end_impl(m_base, m_count, kind<const VV>{});
+        }
+
+        template <typename VV = V,
+                  typename std::enable_if<sized_range<VV>::value>::type* =
+                      nullptr>
+        PICORANGE_CONSTEXPR14 auto size()
+            -> decltype(::picorange::size(std::declval<VV&>()))
+        {
+            const auto s = ::picorange::size(m_base);
+            const auto n = static_cast<decltype(s)>(m_count);
+            return n < s ? n : s;
+        }
+        template <typename VV = V,
+                  typename std::enable_if<
+                      sized_range<const VV>::value>::type* = nullptr>
+        PICORANGE_CONSTEXPR14 auto size() const
+            -> decltype(::picorange::size(std::declval<const VV&>()))
+        {
+            const auto s = ::picorange::size(m_base);
+            const auto n = static_cast<decltype(s)>(m_count);
+            return n < s ? n : s;
+        }
+
+    private:
+        V m_base{};
+        range_difference_t<V> m_count{0};
+    };
+
+    // drop_view
+    template <typename V>
+    class drop_view : public view_interface<drop_view<V>> {
+        static_assert(view<V>::value, "");
+
+        template <typename Base>
+        static PICORANGE_CONSTEXPR14 iterator_t<Base> begin_impl(
+            Base& base,
+            range_difference_t<Base> n)
+        {
+            auto it = ::picorange::begin(base);
+            ::picorange::advance(it, n, ::picorange::end(base));
+            return it;
+        }
+
+    public:
+        drop_view() = default;
+        PICORANGE_CONSTEXPR14 drop_view(V base, range_difference_t<V> count)
+            : m_base(std::move(base)), m_count(count)
+        {
+            PICORANGE_EXPECT(count >= 0);
+        }
+
+        constexpr V base() const
+        {
+            return m_base;
+        }
+
+        // Dropped elements are skipped with advance(), which is O(1) for
+        // sized random access ranges, and keeps the underlying iterator
+        // type. For other forward ranges, the result is cached.
+        PICORANGE_CONSTEXPR14 iterator_t<V> begin()
+        {
+            return cached_begin(std::integral_constant<
+                                bool,
+                                detail::is_forward_range<V>::value &&
+                                    !detail::is_sized_random_access_range<
+                                        V>::value>{});
+        }
+        template <typename VV = V,
+                  typename std::enable_if<range<const VV>::value>::type* =
+                      nullptr>
+        PICORANGE_CONSTEXPR14 iterator_t<const VV> begin() const
+        {
+            return drop_view::begin_impl(m_base, m_count);
+        }
+
+        PICORANGE_CONSTEXPR14 sentinel_t<V> end()
+        {
+            return ::picorange::end(m_base);
+        }
+        template <typename VV = V,
+                  typename std::enable_if<range<const VV>::value>::type* =
+                      nullptr>
+        constexpr sentinel_t<const VV> end() const
+        {
+            return ::picorange::end(m_base);
+        }
+
+        template <typename VV = V,
+                  typename std::enable_if<sized_range<VV>::value>::type* =
+                      nullptr>
+        PICORANGE_CONSTEXPR14 auto size()
+            -> decltype(::picorange::size(std::declval<VV&>()))
+        {
+            const auto s = ::picorange::size(m_base);
+            const auto n = static_cast<decltype(s)>(m_count);
+            return s < n ? decltype(s){0} : s - n;
+        }
+        template <typename VV = V,
+                  typename std::enable_if<
+                      sized_range<const VV>::value>::type* = nullptr>
+        PICORANGE_CONSTEXPR14 auto size() const
+            -> decltype(::picorange::size(std::declval<const VV&>()))
+        {
+            const auto s = ::picorange::size(m_base);
+            const auto n = static_cast<decltype(s)>(m_count);
+            return s < n ? decltype(s){0} : s - n;
+        }
+
+    private:
+        PICORANGE_CONSTEXPR14 iterator_t<V> cached_begin(std::true_type)
+        {
+            if (!m_begin.has_value()) {
+                m_begin.emplace(drop_view::begin_impl(m_base, m_count));
+            }
+            return *m_begin;
+        }
+        PICORANGE_CONSTEXPR14 iterator_t<V> cached_begin(std::false_type)
+        {
+            return drop_view::begin_impl(m_base, m_count);
+        }
+
+        V m_base{};
+        range_difference_t<V> m_count{0};
+        detail::non_propagating_cache<iterator_t<V>> m_begin{};
+    };
+
+    // take_while_view
+    template <typename V, typename Pred>
+    class take_while_view : public view_interface<take_while_view<V, Pred>> {
+        static_assert(view<V>::value, "");
+
+        template <bool Const>
+        class sentinel {
+            friend class sentinel<!Const>;
+
+            using base_type = detail::maybe_const_t<Const, V>;
+            using base_iterator = iterator_t<base_type>;
+            using base_sentinel = sentinel_t<base_type>;
+
+        public:
+            sentinel() = default;
+            constexpr sentinel(base_sentinel end, const Pred* pred)
+                : m_end(std::move(end)), m_pred(pred)
+            {
+            }
+            template <bool C = Const,
+                      typename std::enable_if<
+                          C && std::is_convertible<sentinel_t<V>,
+                                                   base_sentinel>::value>::
+                          type* = nullptr>
+            constexpr sentinel(sentinel<!C> s)
+                : m_end(std::move(s.m_end)), m_pred(s.m_pred)
+            {
+            }
+
+            constexpr base_sentinel base() const
+            {
+                return m_end;
+            }
+
+            friend constexpr bool operator==(const base_iterator& x,
+                                             const sentinel& y)
+            {
+                return x == y.m_end || !(*y.m_pred)(*x);
+            }
+            friend constexpr bool operator==(const sentinel& y,
+                                             const base_iterator& x)
+            {
+                return x == y;
+            }
+            friend constexpr bool operator!=(const base_iterator& x,
+                                             const sentinel& y)
+            {
+                return !(x == y);
+            }
+            friend constexpr bool operator!=(const sentinel& y,
+                                             const base_iterator& x)
+            {
+                return !(x == y);
+            }
+
+        private:
+            base_sentinel m_end{};
+            const Pred* m_pred{nullptr};
+        };
+
+    public:
+        take_while_view() = default;
+        constexpr take_while_view(V base, Pred pred)
+            : m_base(std::move(base)), m_pred(std::move(pred))
+        {
+        }
+
+        constexpr V base() const
+        {
+            return m_base;
+        }
+        constexpr const Pred& pred() const
+        {
+            return *m_pred;
+        }
+
+        PICORANGE_CONSTEXPR14 iterator_t<V> begin()
+        {
+            return ::picorange::begin(m_base);
+        }
+        template <typename VV = V,
+                  typename std::enable_if<range<const VV>::value>::type* =
+                      nullptr>
+        constexpr iterator_t<const VV> begin() const
+        {
+            return ::picorange::begin(m_base);
+        }
+
+        PICORANGE_CONSTEXPR14 sentinel<false> end()
+        {
+            return {::picorange::end(m_base), std::addressof(*m_pred)};
+        }
+        template <typename VV = V,
+                  typename std::enable_if<range<const VV>::value>::type* =
+                      nullptr>
+        constexpr sentinel<true> end() const
+        {
+            return {::picorange::end(m_base), std::addressof(*m_pred)};
+        }
+
+    private:
+        V m_base{};
+        detail::movable_box<Pred> m_pred{};
+    };
+
+    // drop_while_view
+    template <typename V, typename Pred>
+    class drop_while_view : public view_interface<drop_while_view<V, Pred>> {
+        static_assert(view<V>::value, "");
+
+    public:
+        drop_while_view() = default;
+        constexpr drop_while_view(V base, Pred pred)
+            : m_base(std::move(base)), m_pred(std::move(pred))
+        {
+        }
+
+        constexpr V base() const
+        {
+            return m_base;
+        }
+        constexpr const Pred& pred() const
+        {
+            return *m_pred;
+        }
+
+        // Cached for forward ranges, like in filter_view
+        PICORANGE_CONSTEXPR14 iterator_t<V> begin()
+        {
+            return find_begin(detail::is_forward_range<V>{});
+        }
+        PICORANGE_CONSTEXPR14 sentinel_t<V> end()
+        {
+            return ::picorange::end(m_base);
+        }
+
+    private:
+        PICORANGE_CONSTEXPR14 iterator_t<V> find_begin(std::true_type)
+        {
+            if (!m_begin.has_value()) {
+                m_begin.emplace(find_begin(std::false_type{}));
+            }
+            return *m_begin;
+        }
+        PICORANGE_CONSTEXPR14 iterator_t<V> find_begin(std::false_type)
+        {
+            auto it = ::picorange::begin(m_base);
+            const auto last = ::picorange::end(m_base);
+            while (it != last && (*m_pred)(*it)) {
+                ++it;
+            }
+            return it;
+        }
+
+        V m_base{};
+        detail::movable_box<Pred> m_pred{};
+        detail::non_propagating_cache<iterator_t<V>> m_begin{};
+    };
+
+    namespace views {
+        // transform
+        namespace _transform {
+            struct fn {
+                template <typename R, typename F>
+                constexpr auto operator()(R&& r, F&& f) const
+                    -> transform_view<all_t<R>, typename std::decay<F>::type>
+                {
+                    return transform_view<all_t<R>,
+                                          typename std::decay<F>::type>{
+                        ::picorange::views::all(std::forward<R>(r)),
+                        std::forward<F>(f)};
+                }
+
+                template <typename F>
+                constexpr auto operator()(F&& f) const
+                    -> decltype(detail::make_bound_adaptor<fn>(
+                        std::forward<F>(f)))
+                {
+                    return detail::make_bound_adaptor<fn>(std::forward<F>(f));
+                }
+            };
+        }  // namespace _transform
+        namespace {
+            constexpr auto& transform = static_const<_transform::fn>::value;
+        }
+
+        // filter
+        namespace _filter {
+            struct fn {
+                template <typename R, typename Pred>
+                constexpr auto operator()(R&& r, Pred&& pred) const
+                    -> filter_view<all_t<R>, typename std::decay<Pred>::type>
+                {
+                    return filter_view<all_t<R>,
+                                       typename std::decay<Pred>::type>{
+                        ::picorange::views::all(std::forward<R>(r)),
+                        std::forward<Pred>(pred)};
+                }
+
+                template <typename Pred>
+                constexpr auto operator()(Pred&& pred) const
+                    -> decltype(detail::make_bound_adaptor<fn>(
+                        std::forward<Pred>(pred)))
+                {
+                    return detail::make_bound_adaptor<fn>(
+                        std::forward<Pred>(pred));
+                }
+            };
+        }  // namespace _filter
+        namespace {
+            constexpr auto& filter = static_const<_filter::fn>::value;
+        }
+
+        // take
+        namespace _take {
+            struct fn {
+                template <typename R,
+                          typename N,
+                          typename std::enable_if<std::is_convertible<
+                              N,
+                              range_difference_t<all_t<R>>>::value>::type* =
+                              nullptr>
+                constexpr auto operator()(R&& r, N n) const
+                    -> take_view<all_t<R>>
+                {
+                    return take_view<all_t<R>>{
+                        ::picorange::views::all(std::forward<R>(r)),
+                        static_cast<range_difference_t<all_t<R>>>(n)};
+                }
+
+                template <typename N,
+                          typename std::enable_if<
+                              std::is_integral<N>::value>::type* = nullptr>
+                constexpr auto operator()(N n) const
+                    -> decltype(detail::make_bound_adaptor<fn>(n))
+                {
+                    return detail::make_bound_adaptor<fn>(n);
+                }
+            };
+        }  // namespace _take
+        namespace {
+            constexpr auto& take = static_const<_take::fn>::value;
+        }
+
+        // drop
+        namespace _drop {
+            struct fn {
+                template <typename R,
+                          typename N,
+                          typename std::enable_if<std::is_convertible<
+                              N,
+                              range_difference_t<all_t<R>>>::value>::type* =
+                              nullptr>
+                constexpr auto operator()(R&& r, N n) const
+                    -> drop_view<all_t<R>>
+                {
+                    return drop_view<all_t<R>>{
+                        ::picorange::views::all(std::forward<R>(r)),
+                        static_cast<range_difference_t<all_t<R>>>(n)};
+                }
+
+                template <typename N,
+                          typename std::enable_if<
+                              std::is_integral<N>::value>::type* = nullptr>
+                constexpr auto operator()(N n) const
+                    -> decltype(detail::make_bound_adaptor<fn>(n))
+                {
+                    return detail::make_bound_adaptor<fn>(n);
+                }
+            };
+        }  // namespace _drop
+        namespace {
+            constexpr auto& drop = static_const<_drop::fn>::value;
+        }
+
+        // take_while
+        namespace _take_while {
+            struct fn {
+                template <typename R, typename Pred>
+                constexpr auto operator()(R&& r, Pred&& pred) const
+                    -> take_while_view<all_t<R>,
+                                       typename std::decay<Pred>::type>
+                {
+                    return take_while_view<all_t<R>,
+                                           typename std::decay<Pred>::type>{
+                        ::picorange::views::all(std::forward<R>(r)),
+                        std::forward<Pred>(pred)};
+                }
+
+                template <typename Pred>
+                constexpr auto operator()(Pred&& pred) const
+                    -> decltype(detail::make_bound_adaptor<fn>(
+                        std::forward<Pred>(pred)))
+                {
+                    return detail::make_bound_adaptor<fn>(
+                        std::forward<Pred>(pred));
+                }
+            };
+        }  // namespace _take_while
+        namespace {
+            constexpr auto& take_while = static_const<_take_while::fn>::value;
+        }
+
+        // drop_while
+        namespace _drop_while {
+            struct fn {
+                template <typename R, typename Pred>
+                constexpr auto operator()(R&& r, Pred&& pred) const
+                    -> drop_while_view<all_t<R>,
+                                       typename std::decay<Pred>::type>
+                {
+                    return drop_while_view<all_t<R>,
+                                           typename std::decay<Pred>::type>{
+                        ::picorange::views::all(std::forward<R>(r)),
+                        std::forward<Pred>(pred)};
+                }
+
+                template <typename Pred>
+                constexpr auto operator()(Pred&& pred) const
+                    -> decltype(detail::make_bound_adaptor<fn>(
+                        std::forward<Pred>(pred)))
+                {
+                    return detail::make_bound_adaptor<fn>(
+                        std::forward<Pred>(pred));
+                }
+            };
+        }  // namespace _drop_while
+        namespace {
+            constexpr auto& drop_while = static_const<_drop_while::fn>::value;
+        }
+
+        // counted
+        namespace _counted {
+            struct fn {
+            private:
+                template <typename I,
+                          typename std::enable_if<
+                              contiguous_iterator<I>::value>::type* = nullptr>
+                static constexpr auto impl(const I& it,
+                                           iter_difference_t<I> n,
+                                           priority_tag<2>)
+                    -> subrange<typename std::add_pointer<
+                        iter_reference_t<I>>::type>
+                {
+                    return {::picorange::to_address(it),
+                            ::picorange::to_address(it) + n};
+                }
+
+                template <typename I,
+                          typename std::enable_if<
+                              random_access_iterator<I>::value>::type* =
+                              nullptr>
+                static constexpr auto impl(const I& it,
+                                           iter_difference_t<I> n,
+                                           priority_tag<1>) -> subrange<I>
+                {
+                    return {it, it + n};
+                }
+
+                template <typename I>
+                static constexpr auto impl(const I& it,
+                                           iter_difference_t<I> n,
+                                           priority_tag<0>)
+                    -> subrange<counted_iterator<I>, default_sentinel_t>
+                {
+                    return {counted_iterator<I>{it, n}, default_sentinel_t{}};
+                }
+
+            public:
+                template <typename I>
+                PICORANGE_CONSTEXPR14 auto operator()(
+                    I it,
+                    iter_difference_t<I> n) const
+                    -> decltype(fn::impl(it, n, priority_tag<2>{}))
+                {
+                    PICORANGE_EXPECT(n >= 0);
+                    return fn::impl(it, n, priority_tag<2>{});
+                }
+            };
+        }  // namespace _counted
+        namespace {
+            constexpr auto& counted = static_const<_counted::fn>::value;
+        }
+    }  // namespace views
+#endif
+
+    // basic_zstring_view
+    // View of a null-terminated string, ending at a null_sentinel_t.
+    // Iterating over it doesn't need the length, so it isn't computed up
+    // front: size() finds it on the first call with
+    // std::char_traits<CharT>::length, and remembers it.
+    template <typename CharT>
+    class basic_zstring_view
+        : public view_interface<basic_zstring_view<CharT>> {
+    public:
+        using value_type = CharT;
+        using size_type = std::size_t;
+
+        constexpr basic_zstring_view() noexcept = default;
+        constexpr basic_zstring_view(const CharT* str) noexcept : m_str(str)
+        {
+        }
+        PICORANGE_CONSTEXPR14 basic_zstring_view(const CharT* str,
+                                                 size_type len) noexcept
+            : m_str(str), m_size(len)
+        {
+            PICORANGE_EXPECT(str[len] == CharT{});
+        }
+        template <typename Traits, typename Allocator>
+        basic_zstring_view(
+            const std::basic_string<CharT, Traits, Allocator>& str) noexcept
+            : m_str(str.c_str()), m_size(str.size())
+        {
+        }
+
+        // The cached size is atomic, so copying and assignment load it
+        basic_zstring_view(const basic_zstring_view& other) noexcept
+            : m_str(other.m_str), m_size(other.cached_size())
+        {
+        }
+        basic_zstring_view& operator=(const basic_zstring_view& other) noexcept
+        {
+            m_str = other.m_str;
+            m_size.store(other.cached_size(), std::memory_order_relaxed);
+            return *this;
+        }
+
+        constexpr const CharT* begin() const noexcept
+        {
+            return m_str;
+        }
+        constexpr null_sentinel_t end() const noexcept
+        {
+            return {};
+        }
+
+        constexpr const CharT* data() const noexcept
+        {
+            return m_str;
+        }
+        constexpr const CharT* c_str() const noexcept
+        {
+            return m_str;
+        }
+
+        PICORANGE_NODISCARD constexpr bool empty() const noexcept
+        {
+            return *m_str == CharT{};
+        }
+        // Computed on first use, and cached. Concurrent calls on the same
+        // view may both compute it, but always store the same value.
+        size_type size() const noexcept
+        {
+            auto n = cached_size();
+            if (n == npos) {
+                n = std::char_traits<CharT>::length(m_str);
+                m_size.store(n, std::memory_order_relaxed);
+            }
+            return n;
+        }
+
+    private:
+        size_type cached_size() const noexcept
+        {
+            return m_size.load(std::memory_order_relaxed);
+        }
+
+        static constexpr size_type npos = static_cast<size_type>(-1);
+        static constexpr CharT s_empty{};
+
+        const CharT* m_str{&s_empty};
+        mutable std::atomic<size_type> m_size{npos};
+    };
+    template <typename CharT>
+    constexpr typename basic_zstring_view<CharT>::size_type
+        basic_zstring_view<CharT>::npos;
+    template <typename CharT>
+    constexpr CharT basic_zstring_view<CharT>::s_empty;
+
+    using zstring_view = basic_zstring_view<char>;
+    using wzstring_view = basic_zstring_view<wchar_t>;
+
+    // split_view
+    namespace detail {
+        template <typename R,
+                  bool = contiguous_range<R>::value && sized_range<R>::value>
+        struct is_contiguous_sized_range : std::false_type {
+        };
+        template <typename R>
+        struct is_contiguous_sized_range<R, true> : std::true_type {
+        };
+
+        // First occurrence of the n > 0 elements at pattern in
+        // [first, last), or last. Bytes are searched with the kernels in
+        // simd.h: find_byte for one, and find_bytes, which only compares
+        // the positions where the first and the last byte match, for more.
+        template <typename T>
+        const T* split_find(const T* first,
+                            const T* last,
+                            const T* pattern,
+                            std::size_t n,
+                            std::true_type)
+        {
+            const auto f = reinterpret_cast<const unsigned char*>(first);
+            const auto l = reinterpret_cast<const unsigned char*>(last);
+            const auto p = reinterpret_cast<const unsigned char*>(pattern);
+            const auto r = n == 1 ? simd::find_byte(f, l, *p)
+                                  : simd::find_bytes(f, l, p, n);
+            return first + (r - f);
+        }
+        template <typename T>
+        const T* split_find(const T* first,
+                            const T* last,
+                            const T* pattern,
+                            std::size_t n,
+                            std::false_type)
+        {
+            return n == 1 ? std::find(first, last, *pattern)
+                          : std::search(first, last, pattern, pattern + n);
+        }
+    }  // namespace detail
+
+    // A view of the parts of a contiguous range V between the occurrences
+    // of Pattern, as subrange<const T*>. Like in C++20, a delimiter at the
+    // end is followed by an empty part, an empty range has no parts, and
+    // an empty pattern splits the range into elements.
+    //
+    // The next delimiter is found when the iterator is incremented; the
+    // first one on the first call to begin(), which is cached.
+    template <typename V, typename Pattern>
+    class split_view : public view_interface<split_view<V, Pattern>> {
+        static_assert(detail::is_contiguous_sized_range<V>::value &&
+                          detail::is_contiguous_sized_range<Pattern>::value,
+                      "");
+        static_assert(
+            std::is_same<typename std::remove_cv<range_value_t<V>>::type,
+                         typename std::remove_cv<
+                             range_value_t<Pattern>>::type>::value,
+            "");
+
+        using element_type =
+            typename std::remove_cv<range_value_t<V>>::type;
+        using pointer_type = const element_type*;
+
+        struct match {
+            pointer_type begin;
+            pointer_type end;
+        };
+
+    public:
+        class iterator {
+            friend class split_view;
+
+        public:
+            using value_type = subrange<pointer_type>;
+            using difference_type = std::ptrdiff_t;
+            using reference = value_type;
+            using pointer = void;
+            using iterator_category = forward_iterator_tag;
+
+            iterator() = default;
+
+            value_type operator*() const
+            {
+                return {m_cur, m_next.begin};
+            }
+
+            iterator& operator++()
+            {
+                const auto last = m_parent->last();
+                m_cur = m_next.begin;
+                if (m_cur != last) {
+                    m_cur = m_next.end;
+                    if (m_cur == last) {
+                        m_trailing_empty = true;
+                        m_next = {m_cur, m_cur};
+                    }
+                    else {
+                        m_next = m_parent->find_next(m_cur);
+                    }
+                }
+                else {
+                    m_trailing_empty = false;
+                }
+                return *this;
+            }
+            iterator operator++(int)
+            {
+                auto tmp = *this;
+                ++*this;
+                return tmp;
+            }
+
+            friend bool operator==(const iterator& a, const iterator& b)
+            {
+                return a.m_cur == b.m_cur &&
+                       a.m_trailing_empty == b.m_trailing_empty;
+            }
+            friend bool operator!=(const iterator& a, const iterator& b)
+            {
+                return !(a == b);
+            }
+
+        private:
+            iterator(split_view* parent, pointer_type cur, match next)
+                : m_parent(parent), m_cur(cur), m_next(next)
+            {
+            }
+
+            split_view* m_parent{nullptr};
+            pointer_type m_cur{nullptr};
+            match m_next{nullptr, nullptr};
+            bool m_trailing_empty{false};
+        };
+
+        split_view() = default;
+        split_view(V base, Pattern pattern)
+            : m_base(std::move(base)), m_pattern(std::move(pattern))
+        {
+        }
+
+        V base() const
+        {
+            return m_base;
+        }
+
+        iterator begin()
+        {
+            if (!m_begin.has_value()) {
+                m_begin.emplace(find_next(first()));
+            }
+            return {this, first(), *m_begin};
+        }
+        iterator end()
+        {
+            return {this, last(), {last(), last()}};
+        }
+
+    private:
+        pointer_type first()
+        {
+            return ::picorange::data(m_base);
+        }
+        pointer_type last()
+        {
+            return first() + ::picorange::size(m_base);
+        }
+
+        match find_next(pointer_type it)
+        {
+            const auto end = last();
+            const auto n =
+                static_cast<std::size_t>(::picorange::size(m_pattern));
+            if (n == 0) {
+                return it == end ? match{end, end} : match{it + 1, it + 1};
+            }
+            const pointer_type pattern = ::picorange::data(m_pattern);
+            const auto m = detail::split_find(
+                it, end, pattern, n, detail::is_byte_like<element_type>{});
+            return m == end ? match{end, end} : match{m, m + n};
+        }
+
+        V m_base{};
+        Pattern m_pattern{};
+        detail::non_propagating_cache<match> m_begin{};
+    };
+
+    namespace views {
+        namespace _split {
+            // Contiguous ranges are split with split_view, by both split
+            // and lazy_split: their parts are subranges either way.
+            template <typename R, typename P, typename = void>
+            struct is_splittable_by_range : std::false_type {
+            };
+            template <typename R, typename P>
+            struct is_splittable_by_range<
+                R,
+                P,
+                typename std::enable_if<
+                    detail::is_contiguous_sized_range<all_t<R>>::value &&
+                    detail::is_contiguous_sized_range<all_t<P>>::value>::type>
+                : std::is_same<
+                      typename std::remove_cv<range_value_t<all_t<R>>>::type,
+                      typename std::remove_cv<
+                          range_value_t<all_t<P>>>::type> {
+            };
+
+            template <bool Lazy>
+            struct fn {
+            private:
+                template <typename R, typename P>
+                using range_split_t = split_view<all_t<R>, all_t<P>>;
+                template <typename R>
+                using value_split_t =
+                    split_view<all_t<R>, single_view<range_value_t<R>>>;
+
+#if PICORANGE_STD_RANGES
+                static constexpr auto& std_adaptor(std::false_type)
+                {
+                    return std::views::split;
+                }
+                static constexpr auto& std_adaptor(std::true_type)
+                {
+                    return std::views::lazy_split;
+                }
+#endif
+
+            public:
+                template <typename R,
+                          typename P,
+                          typename std::enable_if<
+                              is_splittable_by_range<R, P>::value>::type* =
+                              nullptr>
+                auto operator()(R&& r, P&& pattern) const
+                    -> range_split_t<R, P>
+                {
+                    return range_split_t<R, P>{
+                        ::picorange::views::all(std::forward<R>(r)),
+                        ::picorange::views::all(std::forward<P>(pattern))};
+                }
+
+                template <typename R,
+                          typename T,
+                          typename std::enable_if<
+                              !range<typename std::remove_reference<
+                                  T>::type>::value &&
+                              std::is_convertible<T, range_value_t<R>>::
+                                  value &&
+                              detail::is_contiguous_sized_range<
+                                  all_t<R>>::value>::type* = nullptr>
+                auto operator()(R&& r, T&& value) const -> value_split_t<R>
+                {
+                    return value_split_t<R>{
+                        ::picorange::views::all(std::forward<R>(r)),
+                        single_view<range_value_t<R>>{
+                            std::forward<T>(value)}};
+                }
+
+#if PICORANGE_STD_RANGES
+                // Other ranges are handed over to the standard library
+                template <typename R,
+                          typename P,
+                          typename std::enable_if<
+                              !detail::is_contiguous_sized_range<
+                                  all_t<R>>::value>::type* = nullptr>
+                auto operator()(R&& r, P&& pattern) const
+                    -> decltype(std_adaptor(std::bool_constant<Lazy>{})(
+                        std::forward<R>(r), std::forward<P>(pattern)))
+                {
+                    return std_adaptor(std::bool_constant<Lazy>{})(
+                        std::forward<R>(r), std::forward<P>(pattern));
+                }
+#endif
+
+                // A range pattern is bound as a view, so that a temporary
+                // pattern doesn't dangle
+                template <typename P,
+                          typename std::enable_if<range<
+                              typename std::remove_reference<P>::type>::
+                                                      value>::type* = nullptr>
+                constexpr auto operator()(P&& pattern) const
+                    -> decltype(detail::make_bound_adaptor<fn>(
+                        ::picorange::views::all(std::forward<P>(pattern))))
+                {
+                    return detail::make_bound_adaptor<fn>(
+                        ::picorange::views::all(std::forward<P>(pattern)));
+                }
+                template <typename T,
+                          typename std::enable_if<!range<
+                              typename std::remove_reference<T>::type>::
+                                                      value>::type* = nullptr>
+                constexpr auto operator()(T&& value) const
+                    -> decltype(detail::make_bound_adaptor<fn>(
+                        std::forward<T>(value)))
+                {
+                    return detail::make_bound_adaptor<fn>(
+                        std::forward<T>(value));
+                }
+            };
+        }  // namespace _split
+        namespace {
+            constexpr auto& split = static_const<_split::fn<false>>::value;
+            constexpr auto& lazy_split =
+                static_const<_split::fn<true>>::value;
+        }  // namespace
+    }      // namespace views
+
+    // lines_view
+
+    // Where views::lines ends a line
+    enum class line_terminator {
+        // At '\n'
+        lf,
+        // At '\n', without a '\r' before it, so that both LF and CRLF
+        // line endings are accepted
+        crlf
+    };
+
+    namespace detail {
+        template <typename CharT>
+        const CharT* find_newline(const CharT* first, const CharT* last)
+        {
+            const CharT nl = static_cast<CharT>('\n');
+            return split_find(first, last, &nl, 1, is_byte_like<CharT>{});
+        }
+
+        // The end of the line [first, eol) without its '\r', if it's
+        // ended by "\r\n". A '\r' at the end of input, without a '\n'
+        // after it, is a part of the line.
+        template <typename CharT>
+        const CharT* trim_cr(const CharT* first,
+                             const CharT* eol,
+                             bool newline,
+                             line_terminator t)
+        {
+            return t == line_terminator::crlf && newline && eol != first &&
+                           eol[-1] == static_cast<CharT>('\r')
+                       ? eol - 1
+                       : eol;
+        }
+    }  // namespace detail
+
+    // A view of the lines of a contiguous range V, as subrange<const T*>,
+    // without their line terminators. A terminator at the end isn't
+    // followed by an empty line.
+    template <typename V>
+    class lines_view : public view_interface<lines_view<V>> {
+        static_assert(detail::is_contiguous_sized_range<V>::value, "");
+
+        using element_type =
+            typename std::remove_cv<range_value_t<V>>::type;
+        using pointer_type = const element_type*;
+
+    public:
+        class iterator {
+            friend class lines_view;
+
+        public:
+            using value_type = subrange<pointer_type>;
+            using difference_type = std::ptrdiff_t;
+            using reference = value_type;
+            using pointer = void;
+            using iterator_category = forward_iterator_tag;
+
+            iterator() = default;
+
+            value_type operator*() const
+            {
+                return {m_cur,
+                        detail::trim_cr(m_cur, m_eol, m_eol != m_last,
+                                        m_terminator)};
+            }
+
+            iterator& operator++()
+            {
+                m_cur = m_eol == m_last ? m_last : m_eol + 1;
+                if (m_cur != m_last) {
+                    m_eol = detail::find_newline(m_cur, m_last);
+                }
+                return *this;
+            }
+            iterator operator++(int)
+            {
+                auto tmp = *this;
+                ++*this;
+                return tmp;
+            }
+
+            friend bool operator==(const iterator& a, const iterator& b)
+            {
+                return a.m_cur == b.m_cur;
+            }
+            friend bool operator!=(const iterator& a, const iterator& b)
+            {
+                return !(a == b);
+            }
+
+        private:
+            iterator(pointer_type cur,
+                     pointer_type eol,
+                     pointer_type last,
+                     line_terminator t)
+                : m_cur(cur), m_eol(eol), m_last(last), m_terminator(t)
+            {
+            }
+
+            pointer_type m_cur{nullptr};
+            pointer_type m_eol{nullptr};
+            pointer_type m_last{nullptr};
+            line_terminator m_terminator{line_terminator::lf};
+        };
+
+        lines_view() = default;
+        explicit lines_view(V base, line_terminator t = line_terminator::lf)
+            : m_base(std::move(base)), m_terminator(t)
+        {
+        }
+
+        V base() const
+        {
+            return m_base;
+        }
+
+        // The end of the first line is found on the first call, and cached
+        iterator begin()
+        {
+            const auto f = first();
+            const auto l = f + ::picorange::size(m_base);
+            if (!m_begin.has_value()) {
+                m_begin.emplace(detail::find_newline(f, l));
+            }
+            return {f, *m_begin, l, m_terminator};
+        }
+        iterator end()
+        {
+            const auto l = first() + ::picorange::size(m_base);
+            return {l, l, l, m_terminator};
+        }
+
+    private:
+        pointer_type first()
+        {
+            return ::picorange::data(m_base);
+        }
+
+        V m_base{};
+        line_terminator m_terminator{line_terminator::lf};
+        detail::non_propagating_cache<pointer_type> m_begin{};
+    };
+
+    namespace detail {
+        template <typename S>
+        using chunk_t = decltype(std::declval<S&>().chunk());
+        template <typename S>
+        using consume_t =
+            decltype(std::declval<S&>().consume(std::declval<std::size_t>()));
+
+        // Sources of contiguous chunks of input, like fd_input_range and
+        // pipeline_stage_view: chunk() is the unread part of the current
+        // chunk, and consume(n) marks the first n elements of it as read.
+        template <typename S, typename = void>
+        struct is_chunked_source : std::false_type {
+        };
+        template <typename S>
+        struct is_chunked_source<
+            S,
+            typename std::enable_if<exists<chunk_t, S>::value &&
+                                    exists<consume_t, S>::value>::type>
+            : is_contiguous_sized_range<chunk_t<S>> {
+        };
+    }  // namespace detail
+
+    // An input view of the lines read from a chunked source S, like
+    // fd_input_range.
+    //
+    // Lines within a chunk refer to the source's buffer; only a line
+    // straddling chunks is copied, into a buffer reused for every such
+    // line. Either way, a line is valid until the iterator is incremented.
+    template <typename S>
+    class chunked_lines_view : public view_interface<chunked_lines_view<S>> {
+        static_assert(detail::is_chunked_source<S>::value, "");
+
+        using element_type = typename std::remove_cv<
+            range_value_t<detail::chunk_t<S>>>::type;
+        using pointer_type = const element_type*;
+
+    public:
+        class iterator {
+        public:
+            using value_type = subrange<pointer_type>;
+            using difference_type = std::ptrdiff_t;
+            using reference = value_type;
+            using pointer = void;
+            using iterator_category = input_iterator_tag;
+
+            iterator() = default;
+            explicit iterator(chunked_lines_view* v) noexcept : m_view(v) {}
+
+            value_type operator*() const
+            {
+                PICORANGE_EXPECT(!at_end());
+                return m_view->m_line;
+            }
+
+            iterator& operator++()
+            {
+                m_view->next();
+                return *this;
+            }
+            void operator++(int)
+            {
+                ++*this;
+            }
+
+            friend bool operator==(const iterator& i,
+                                   default_sentinel_t) noexcept
+            {
+                return i.at_end();
+            }
+            friend bool operator==(default_sentinel_t,
+                                   const iterator& i) noexcept
+            {
+                return i.at_end();
+            }
+            friend bool operator!=(const iterator& i,
+                                   default_sentinel_t) noexcept
+            {
+                return !i.at_end();
+            }
+            friend bool operator!=(default_sentinel_t,
+                                   const iterator& i) noexcept
+            {
+                return !i.at_end();
+            }
+
+        private:
+            bool at_end() const noexcept
+            {
+                return !m_view || m_view->m_done;
+            }
+
+            chunked_lines_view* m_view{nullptr};
+        };
+
+        chunked_lines_view() = default;
+        explicit chunked_lines_view(S& source,
+                                    line_terminator t = line_terminator::lf)
+            : m_source(std::addressof(source)), m_terminator(t)
+        {
+        }
+
+        iterator begin()
+        {
+            if (!m_started) {
+                m_started = true;
+                next();
+            }
+            return iterator{this};
+        }
+        default_sentinel_t end() const noexcept
+        {
+            return {};
+        }
+
+    private:
+        void next()
+        {
+            if (m_pending != 0) {
+                m_source->consume(m_pending);
+                m_pending = 0;
+            }
+            m_stitch.clear();
+            for (;;) {
+                auto c = m_source->chunk();
+                const pointer_type b = ::picorange::data(c);
+                const pointer_type e = b + ::picorange::size(c);
+                if (b == e) {
+                    // The last line, without a terminator
+                    m_done = m_stitch.empty();
+                    set_line_from_stitch(false);
+                    return;
+                }
+
+                const auto eol = detail::find_newline(b, e);
+                if (eol == e) {
+                    m_stitch.insert(m_stitch.end(), b, e);
+                    m_source->consume(static_cast<std::size_t>(e - b));
+                    continue;
+                }
+                if (m_stitch.empty()) {
+                    // Consumed on the next call, so that the line stays
+                    // valid until then
+                    m_line = {b, detail::trim_cr(b, eol, true, m_terminator)};
+                    m_pending = static_cast<std::size_t>(eol - b) + 1;
+                    return;
+                }
+                m_stitch.insert(m_stitch.end(), b, eol);
+                m_source->consume(static_cast<std::size_t>(eol - b) + 1);
+                set_line_from_stitch(true);
+                return;
+            }
+        }
+
+        void set_line_from_stitch(bool newline)
+        {
+            const pointer_type b = m_stitch.data();
+            const pointer_type e = b + m_stitch.size();
+            m_line = {b, detail::trim_cr(b, e, newline, m_terminator)};
+        }
+
+        S* m_source{nullptr};
+        line_terminator m_terminator{line_terminator::lf};
+        std::vector<element_type> m_stitch{};
+        subrange<pointer_type> m_line{};
+        std::size_t m_pending{0};
+        bool m_started{false};
+        bool m_done{false};
+    };
+
+    namespace views {
+        namespace _lines {
+            struct fn {
+                fn() = default;
+                constexpr explicit fn(line_terminator t) : m_terminator(t) {}
+
+                template <typename R,
+                          typename std::enable_if<
+                              detail::is_contiguous_sized_range<
+                                  all_t<R>>::value>::type* = nullptr>
+                auto operator()(R&& r) const -> lines_view<all_t<R>>
+                {
+                    return lines_view<all_t<R>>{
+                        ::picorange::views::all(std::forward<R>(r)),
+                        m_terminator};
+                }
+
+                // Chunked sources are referred to, so they must be lvalues
+                template <typename S,
+                          typename std::enable_if<
+                              !detail::is_contiguous_sized_range<S>::value &&
+                              detail::is_chunked_source<S>::value>::type* =
+                              nullptr>
+                auto operator()(S& source) const -> chunked_lines_view<S>
+                {
+                    return chunked_lines_view<S>{source, m_terminator};
+                }
+
+                // Returns views::lines with the given line terminator
+                constexpr auto operator()(line_terminator t) const
+                    -> detail::range_adaptor_closure<fn>
+                {
+                    return detail::range_adaptor_closure<fn>{fn{t}};
+                }
+
+                line_terminator m_terminator{line_terminator::lf};
+            };
+        }  // namespace _lines
+        namespace {
+            constexpr auto& lines =
+                static_const<detail::range_adaptor_closure<_lines::fn>>::value;
+        }
+    }  // namespace views
+
+    // utf8_view
+
+    namespace detail {
+        template <typename T>
+        struct is_utf8_char : std::integral_constant<
+                                  bool,
+                                  std::is_same<T, char>::value
+#ifdef __cpp_char8_t
+                                      || std::is_same<T, char8_t>::value
+#endif
+                                  > {
+        };
+
+        template <typename R, typename = void>
+        struct is_utf8_range : std::false_type {
+        };
+        template <typename R>
+        struct is_utf8_range<
+            R,
+            typename std::enable_if<is_contiguous_sized_range<R>::value>::type>
+            : is_utf8_char<
+                  typename std::remove_cv<range_value_t<R>>::type> {
+        };
+
+        // The code point of the sequence at first, which ends at the next
+        // byte that isn't a continuation byte, or U+FFFD, if it's
+        // ill-formed
+        inline char32_t decode_utf8(const unsigned char* first,
+                                    const unsigned char* last) noexcept
+        {
+            const auto lead = simd::utf8_lead_info(*first);
+            const auto length = static_cast<std::ptrdiff_t>(lead.length);
+            if (length == 0 || last - first < length ||
+                (last - first > length &&
+                 simd::is_utf8_continuation(first[length]))) {
+                return 0xfffd;
+            }
+            if (length == 1) {
+                return *first;
+            }
+            if (first[1] < lead.second_min || first[1] > lead.second_max) {
+                return 0xfffd;
+            }
+            char32_t cp = *first & (0x7f >> length);
+            for (std::ptrdiff_t i = 1; i < length; ++i) {
+                if (!simd::is_utf8_continuation(first[i])) {
+                    return 0xfffd;
+                }
+                cp = (cp << 6) | (first[i] & 0x3f);
+            }
+            return cp;
+        }
+    }  // namespace detail
+
+    // A bidirectional view of the code points of a contiguous range of UTF-8
+    // char or char8_t, as char32_t.
+    //
+    // Every byte that isn't a continuation byte starts an element, so
+    // distance() counts them, 16 or 32 bytes at a time. Ill-formed sequences
+    // are U+FFFD; valid() checks for them.
+    template <typename V>
+    class utf8_view : public view_interface<utf8_view<V>> {
+        static_assert(detail::is_utf8_range<V>::value, "");
+
+        using element_type =
+            typename std::remove_cv<range_value_t<V>>::type;
+        using pointer_type = const unsigned char*;
+
+    public:
+        class iterator {
+            friend class utf8_view;
+
+        public:
+            using value_type = char32_t;
+            using difference_type = std::ptrdiff_t;
+            using reference = char32_t;
+            using pointer = void;
+            using iterator_category = bidirectional_iterator_tag;
+
+            iterator() = default;
+
+            char32_t operator*() const noexcept
+            {
+                return detail::decode_utf8(m_cur, m_last);
+            }
+
+            iterator& operator++() noexcept
+            {
+                ++m_cur;
+                while (m_cur != m_last &&
+                       detail::simd::is_utf8_continuation(*m_cur)) {
+                    ++m_cur;
+                }
+                return *this;
+            }
+            iterator operator++(int) noexcept
+            {
+                auto tmp = *this;
+                ++*this;
+                return tmp;
+            }
+
+            iterator& operator--() noexcept
+            {
+                --m_cur;
+                while (m_cur != m_first &&
+                       detail::simd::is_utf8_continuation(*m_cur)) {
+                    --m_cur;
+                }
+                return *this;
+            }
+            iterator operator--(int) noexcept
+            {
+                auto tmp = *this;
+                --*this;
+                return tmp;
+            }
+
+            // The first byte of the code point
+            const element_type* base() const noexcept
+            {
+                return reinterpret_cast<const element_type*>(m_cur);
+            }
+
+            // Used by distance(): the number of bytes, which aren't
+            // continuation bytes, and a stray continuation byte at the
+            // beginning, which starts an element, too
+            difference_type distance_to(const iterator& last) const noexcept
+            {
+                if (m_cur == last.m_cur) {
+                    return 0;
+                }
+                return static_cast<difference_type>(
+                    detail::simd::count_utf8_code_points(m_cur, last.m_cur) +
+                    detail::simd::is_utf8_continuation(*m_cur));
+            }
+
+            friend bool operator==(const iterator& a,
+                                   const iterator& b) noexcept
+            {
+                return a.m_cur == b.m_cur;
+            }
+            friend bool operator!=(const iterator& a,
+                                   const iterator& b) noexcept
+            {
+                return !(a == b);
+            }
+
+        private:
+            iterator(pointer_type first,
+                     pointer_type cur,
+                     pointer_type last) noexcept
+                : m_first(first), m_cur(cur), m_last(last)
+            {
+            }
+
+            pointer_type m_first{nullptr};
+            pointer_type m_cur{nullptr};
+            pointer_type m_last{nullptr};
+        };
+
+        utf8_view() = default;
+        explicit utf8_view(V base) : m_base(std::move(base)) {}
+
+        V base() const
+        {
+            return m_base;
+        }
+
+        iterator begin() const
+        {
+            return {first(), first(), last()};
+        }
+        iterator end() const
+        {
+            return {first(), last(), last()};
+        }
+
+        // The range is well-formed UTF-8
+        bool valid() const
+        {
+            return detail::simd::validate_utf8(first(), last());
+        }
+
+    private:
+        pointer_type first() const
+        {
+            return reinterpret_cast<pointer_type>(::picorange::data(m_base));
+        }
+        pointer_type last() const
+        {
+            return first() + ::picorange::size(m_base);
+        }
+
+        V m_base{};
+    };
+
+    namespace views {
+        namespace _utf8 {
+            struct fn {
+                template <typename R,
+                          typename std::enable_if<detail::is_utf8_range<
+                              all_t<R>>::value>::type* = nullptr>
+                auto operator()(R&& r) const -> utf8_view<all_t<R>>
+                {
+                    return utf8_view<all_t<R>>{
+                        ::picorange::views::all(std::forward<R>(r))};
+                }
+            };
+        }  // namespace _utf8
+        namespace {
+            constexpr auto& utf8 =
+                static_const<detail::range_adaptor_closure<_utf8::fn>>::value;
+        }
+    }  // namespace views
+
+    // any_input_view, any_forward_view
+
+    namespace detail {
+        // Elements copied at a time by type-erased views from ranges, which
+        // can't hand out their elements as contiguous chunks
+        template <typename T>
+        struct any_view_batch_size
+            : std::integral_constant<std::size_t,
+                                     sizeof(T) < 1024 ? 1024 / sizeof(T) : 1> {
+        };
+
+        // The chunked source behind V, if any: V itself, or the range a
+        // ref_view refers to, like an fd_input_range lvalue
+        template <typename V>
+        struct chunked_source_of {
+            using type = V;
+            static V& get(V& v) noexcept
+            {
+                return v;
+            }
+        };
+        template <typename R>
+        struct chunked_source_of<ref_view<R>> {
+            using type = R;
+            static R& get(ref_view<R>& v) noexcept
+            {
+                return v.base();
+            }
+        };
+
+        template <typename T, typename V, typename = void>
+        struct is_chunked_source_of : std::false_type {
+        };
+        template <typename T, typename V>
+        struct is_chunked_source_of<
+            T,
+            V,
+            typename std::enable_if<is_chunked_source<
+                typename chunked_source_of<V>::type>::value>::type>
+            : std::is_same<typename std::remove_cv<range_value_t<chunk_t<
+                               typename chunked_source_of<V>::type>>>::type,
+                           T> {
+        };
+
+        template <typename T, typename V, typename = void>
+        struct is_contiguous_source_of : std::false_type {
+        };
+        template <typename T, typename V>
+        struct is_contiguous_source_of<
+            T,
+            V,
+            typename std::enable_if<is_lowerable_to_pointers<
+                iterator_t<V>,
+                sentinel_t<V>>::value>::type>
+            : std::is_same<typename std::remove_cv<range_value_t<V>>::type,
+                           T> {
+        };
+
+        // The type-erased interface of any_input_view: one virtual call per
+        // batch of elements
+        template <typename T>
+        class any_input_source {
+        public:
+            any_input_source() = default;
+            any_input_source(const any_input_source&) = delete;
+            any_input_source& operator=(const any_input_source&) = delete;
+            virtual ~any_input_source() = default;
+
+            // The next elements, after the ones returned by the previous
+            // call. Empty only at the end.
+            virtual subrange<const T*> next_batch() = 0;
+        };
+
+        // Chunks of a chunked source, consumed when the next one is asked
+        // for
+        template <typename T, typename V>
+        class any_input_chunked_source final : public any_input_source<T> {
+        public:
+            explicit any_input_chunked_source(V base) : m_base(std::move(base))
+            {
+            }
+
+            subrange<const T*> next_batch() override
+            {
+                auto& source = chunked_source_of<V>::get(m_base);
+                if (m_pending != 0) {
+                    source.consume(m_pending);
+                }
+                auto c = source.chunk();
+                const T* first = ::picorange::data(c);
+                m_pending = static_cast<std::size_t>(::picorange::size(c));
+                return {first, first + m_pending};
+            }
+
+        private:
+            V m_base;
+            std::size_t m_pending{0};
+        };
+
+        // The whole range at once
+        template <typename T, typename V>
+        class any_input_contiguous_source final : public any_input_source<T> {
+        public:
+            explicit any_input_contiguous_source(V base)
+                : m_base(std::move(base))
+            {
+            }
+
+            subrange<const T*> next_batch() override
+            {
+                if (m_done) {
+                    return {};
+                }
+                m_done = true;
+                auto first = ::picorange::begin(m_base);
+                const auto n = ::picorange::distance(
+                    first, ::picorange::end(m_base));
+                const T* p = ::picorange::to_address(first);
+                return {p, p + n};
+            }
+
+        private:
+            V m_base;
+            bool m_done{false};
+        };
+
+        // Up to a batch of elements, copied into a buffer
+        template <typename T, typename V>
+        class any_input_copying_source final : public any_input_source<T> {
+        public:
+            explicit any_input_copying_source(V base)
+                : m_base(std::move(base)),
+                  m_it(::picorange::begin(m_base)),
+                  m_end(::picorange::end(m_base))
+            {
+            }
+
+            subrange<const T*> next_batch() override
+            {
+                std::size_t n = 0;
+                for (; n != m_buffer.size() && m_it != m_end; ++m_it, ++n) {
+                    m_buffer[n] = *m_it;
+                }
+                return {m_buffer.data(), m_buffer.data() + n};
+            }
+
+        private:
+            V m_base;
+            iterator_t<V> m_it;
+            sentinel_t<V> m_end;
+            std::array<T, any_view_batch_size<T>::value> m_buffer{};
+        };
+
+        template <typename T,
+                  typename V,
+                  typename std::enable_if<
+                      is_chunked_source_of<T, V>::value>::type* = nullptr>
+        std::unique_ptr<any_input_source<T>> make_any_input_source(
+            V base,
+            priority_tag<2>)
+        {
+            return std::unique_ptr<any_input_source<T>>{
+                new any_input_chunked_source<T, V>(std::move(base))};
+        }
+        template <typename T,
+                  typename V,
+                  typename std::enable_if<
+                      is_contiguous_source_of<T, V>::value>::type* = nullptr>
+        std::unique_ptr<any_input_source<T>> make_any_input_source(
+            V base,
+            priority_tag<1>)
+        {
+            return std::unique_ptr<any_input_source<T>>{
+                new any_input_contiguous_source<T, V>(std::move(base))};
+        }
+        template <typename T, typename V>
+        std::unique_ptr<any_input_source<T>> make_any_input_source(
+            V base,
+            priority_tag<0>)
+        {
+            return std::unique_ptr<any_input_source<T>>{
+                new any_input_copying_source<T, V>(std::move(base))};
+        }
+
+        // A batch of the elements behind an any_forward_view. Batches are
+        // filled once, in order, and kept until the view is destroyed, so
+        // that every element has one address, like in any forward range.
+        template <typename T>
+        struct any_forward_batch {
+            const T* first{nullptr};
+            const T* last{nullptr};
+            std::unique_ptr<T[]> buffer{};
+            std::unique_ptr<any_forward_batch> next{};
+        };
+
+        // The range behind an any_forward_view: one virtual call per batch
+        template <typename T>
+        class any_forward_range {
+        public:
+            using batch_type = any_forward_batch<T>;
+
+            any_forward_range() = default;
+            any_forward_range(const any_forward_range&) = delete;
+            any_forward_range& operator=(const any_forward_range&) = delete;
+
+            // Unlinked one by one, instead of recursively
+            virtual ~any_forward_range()
+            {
+                while (m_head) {
+                    m_head = std::move(m_head->next);
+                }
+            }
+
+            batch_type* first_batch()
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+                if (!m_head) {
+                    m_head.reset(new batch_type{});
+                    fill(*m_head);
+                }
+                return m_head.get();
+            }
+            batch_type* next_batch(batch_type* b)
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+                if (!b->next) {
+                    b->next.reset(new batch_type{});
+                    fill(*b->next);
+                }
+                return b->next.get();
+            }
+
+        private:
+            // Fills b with the elements after the previous batch. Empty only
+            // at the end.
+            virtual void fill(batch_type& b) = 0;
+
+            std::mutex m_mutex{};
+            std::unique_ptr<batch_type> m_head{};
+        };
+
+        // The whole range as one batch, without copying
+        template <typename T, typename V>
+        class any_forward_contiguous_range final
+            : public any_forward_range<T> {
+        public:
+            explicit any_forward_contiguous_range(V base)
+                : m_base(std::move(base))
+            {
+            }
+
+        private:
+            void fill(any_forward_batch<T>& b) override
+            {
+                if (m_done) {
+                    return;
+                }
+                m_done = true;
+                auto first = ::picorange::begin(m_base);
+                const auto n =
+                    ::picorange::distance(first, ::picorange::end(m_base));
+                b.first = ::picorange::to_address(first);
+                b.last = b.first + n;
+            }
+
+            V m_base;
+            bool m_done{false};
+        };
+
+        // Up to a batch of elements, copied into a buffer of every batch
+        template <typename T, typename V>
+        class any_forward_copying_range final : public any_forward_range<T> {
+        public:
+            explicit any_forward_copying_range(V base)
+                : m_base(std::move(base)),
+                  m_it(::picorange::begin(m_base)),
+                  m_end(::picorange::end(m_base))
+            {
+            }
+
+        private:
+            void fill(any_forward_batch<T>& b) override
+            {
+                if (m_it == m_end) {
+                    return;
+                }
+                const auto size = any_view_batch_size<T>::value;
+                b.buffer.reset(new T[size]);
+                std::size_t n = 0;
+                for (; n != size && m_it != m_end; ++m_it, ++n) {
+                    b.buffer[n] = *m_it;
+                }
+                b.first = b.buffer.get();
+                b.last = b.first + n;
+            }
+
+            V m_base;
+            iterator_t<V> m_it;
+            sentinel_t<V> m_end;
+        };
+
+        template <typename T, typename V>
+        using any_forward_range_impl_t = typename std::conditional<
+            is_contiguous_source_of<T, V>::value,
+            any_forward_contiguous_range<T, V>,
+            any_forward_copying_range<T, V>>::type;
+
+        template <typename R, typename T>
+        struct is_any_view_source
+            : std::is_convertible<range_reference_t<R>, T> {
+        };
+    }  // namespace detail
+
+    // A type-erased input view of the elements of any range convertible to
+    // T, like scnlib's erased ranges, but with one virtual call per batch of
+    // elements, instead of two per element.
+    //
+    // A batch is the rest of a contiguous range of T, a chunk() of a chunked
+    // source, like fd_input_range, or up to a fixed number of elements
+    // copied into a buffer. Like in a chunked source, the rest of the
+    // current batch is available as chunk(), and can be skipped with
+    // consume(n).
+    template <typename T>
+    class any_input_view : public view_interface<any_input_view<T>> {
+        static_assert(std::is_same<typename std::decay<T>::type, T>::value,
+                      "");
+
+        struct state {
+            std::unique_ptr<detail::any_input_source<T>> source;
+            const T* cur{nullptr};
+            const T* end{nullptr};
+            bool done{false};
+
+            // Gets the next batch only when the current one is used up and
+            // an element is needed, so that reading the last element of
+            // the input doesn't wait for more
+            void fill_if_empty()
+            {
+                if (cur == end && !done) {
+                    auto b = source->next_batch();
+                    cur = ::picorange::data(b);
+                    end = cur + ::picorange::size(b);
+                    done = cur == end;
+                }
+            }
+        };
+
+    public:
+        class iterator {
+        public:
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using reference = const T&;
+            using pointer = const T*;
+            using iterator_category = input_iterator_tag;
+
+            iterator() = default;
+            explicit iterator(state* s) noexcept : m_state(s) {}
+
+            reference operator*() const
+            {
+                m_state->fill_if_empty();
+                PICORANGE_EXPECT(m_state->cur != m_state->end);
+                return *m_state->cur;
+            }
+            pointer operator->() const
+            {
+                return std::addressof(**this);
+            }
+
+            iterator& operator++()
+            {
+                PICORANGE_EXPECT(m_state->cur != m_state->end);
+                ++m_state->cur;
+                return *this;
+            }
+            void operator++(int)
+            {
+                ++*this;
+            }
+
+            friend bool operator==(const iterator& i,
+                                   default_sentinel_t)
+            {
+                return i.at_end();
+            }
+            friend bool operator==(default_sentinel_t,
+                                   const iterator& i)
+            {
+                return i.at_end();
+            }
+            friend bool operator!=(const iterator& i,
+                                   default_sentinel_t)
+            {
+                return !i.at_end();
+            }
+            friend bool operator!=(default_sentinel_t,
+                                   const iterator& i)
+            {
+                return !i.at_end();
+            }
+
+        private:
+            bool at_end() const
+            {
+                if (!m_state) {
+                    return true;
+                }
+                m_state->fill_if_empty();
+                return m_state->cur == m_state->end;
+            }
+
+            state* m_state{nullptr};
+        };
+
+        any_input_view() = default;
+
+        // The first condition is checked first, so that copying doesn't
+        // depend on views::all_t<any_input_view&>
+        template <typename R,
+                  typename std::enable_if<
+                      !std::is_same<typename std::decay<R>::type,
+                                    any_input_view>::value>::type* = nullptr,
+                  typename std::enable_if<
+                      detail::is_any_view_source<views::all_t<R>,
+                                                 T>::value>::type* = nullptr>
+        explicit any_input_view(R&& r)
+            : m_state(std::make_shared<state>())
+        {
+            m_state->source = detail::make_any_input_source<T>(
+                ::picorange::views::all(std::forward<R>(r)),
+                priority_tag<2>{});
+        }
+
+        iterator begin()
+        {
+            return iterator{m_state.get()};
+        }
+        default_sentinel_t end() const noexcept
+        {
+            return {};
+        }
+
+        // The rest of the current batch, empty only at the end
+        subrange<const T*> chunk()
+        {
+            m_state->fill_if_empty();
+            return {m_state->cur, m_state->end};
+        }
+        // Marks the first n elements of chunk() as read. Doesn't get the
+        // next batch.
+        void consume(std::size_t n)
+        {
+            PICORANGE_EXPECT(
+                n <= static_cast<std::size_t>(m_state->end - m_state->cur));
+            m_state->cur += n;
+        }
+
+    private:
+        std::shared_ptr<state> m_state{};
+    };
+
+    // A type-erased forward view of the elements of any forward range
+    // convertible to T. Like any_input_view, it gets a batch of elements
+    // at a time, from the range behind it.
+    //
+    // Copied batches are shared by every iterator and copy of the view, and
+    // kept until the view is destroyed, so that references to the elements
+    // stay valid, like in any forward range. Iterators are two pointers and
+    // the batch they are in.
+    //
+    // A view of a range that isn't contiguous thus holds a copy of every
+    // element iterated over so far: O(n) memory for a full pass. Use an
+    // any_input_view to go through a large range once, in O(1) memory.
+    template <typename T>
+    class any_forward_view : public view_interface<any_forward_view<T>> {
+        static_assert(std::is_same<typename std::decay<T>::type, T>::value,
+                      "");
+
+        using range_type = detail::any_forward_range<T>;
+        using batch_type = detail::any_forward_batch<T>;
+
+    public:
+        class iterator {
+        public:
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using reference = const T&;
+            using pointer = const T*;
+            using iterator_category = forward_iterator_tag;
+
+            // The end
+            iterator() = default;
+            iterator(range_type* r, batch_type* b) : m_range(r)
+            {
+                set_batch(b);
+            }
+
+            reference operator*() const
+            {
+                PICORANGE_EXPECT(!at_end());
+                return *m_cur;
+            }
+            pointer operator->() const
+            {
+                return m_cur;
+            }
+
+            iterator& operator++()
+            {
+                if (++m_cur == m_end) {
+                    set_batch(m_range->next_batch(m_batch));
+                }
+                return *this;
+            }
+            iterator operator++(int)
+            {
+                auto tmp = *this;
+                ++*this;
+                return tmp;
+            }
+
+            // Every element has one address
+            friend bool operator==(const iterator& a,
+                                   const iterator& b) noexcept
+            {
+                if (a.at_end() || b.at_end()) {
+                    return a.at_end() == b.at_end();
+                }
+                return a.m_cur == b.m_cur;
+            }
+            friend bool operator!=(const iterator& a,
+                                   const iterator& b) noexcept
+            {
+                return !(a == b);
+            }
+
+        private:
+            bool at_end() const noexcept
+            {
+                return m_cur == m_end;
+            }
+
+            void set_batch(batch_type* b) noexcept
+            {
+                m_batch = b;
+                m_cur = b->first;
+                m_end = b->last;
+            }
+
+            range_type* m_range{nullptr};
+            batch_type* m_batch{nullptr};
+            const T* m_cur{nullptr};
+            const T* m_end{nullptr};
+        };
+
+        any_forward_view() = default;
+
+        template <typename R,
+                  typename std::enable_if<
+                      !std::is_same<typename std::decay<R>::type,
+                                    any_forward_view>::value>::type* = nullptr,
+                  typename std::enable_if<
+                      detail::is_any_view_source<views::all_t<R>, T>::value &&
+                      detail::is_forward_range<views::all_t<R>>::value>::type* =
+                      nullptr>
+        explicit any_forward_view(R&& r)
+            : m_range(std::make_shared<
+                      detail::any_forward_range_impl_t<T, views::all_t<R>>>(
+                  ::picorange::views::all(std::forward<R>(r))))
+        {
+        }
+
+        // A default-constructed view is empty
+        iterator begin() const
+        {
+            if (!m_range) {
+                return {};
+            }
+            return {m_range.get(), m_range->first_batch()};
+        }
+        iterator end() const
+        {
+            return {};
+        }
+
+    private:
+        std::shared_ptr<range_type> m_range{};
+    };
+
+    PICORANGE_END_NAMESPACE
+}  // namespace picorange
+
+#endif  // PICORANGE_VIEWS_H
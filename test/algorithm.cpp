@@ -0,0 +1,185 @@
+// Copyright 2017-2019 Elias Kosunen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// This file is a part of picorange:
+//     https://github.com/eliaskosunen/picorange
+
+#include "test.h"
+
+#include <picorange/algorithm.h>
+
+#include <algorithm>
+#include <deque>
+#include <iterator>
+#include <list>
+#include <string>
+#include <vector>
+
+namespace pr = picorange;
+
+// The iterators of std::vector and std::basic_string are contiguous before
+// C++20
+static_assert(pr::contiguous_iterator<std::vector<int>::iterator>::value, "");
+static_assert(pr::contiguous_iterator<std::string::const_iterator>::value,
+              "");
+static_assert(!pr::contiguous_iterator<std::vector<bool>::iterator>::value,
+              "");
+static_assert(!pr::contiguous_iterator<std::deque<int>::iterator>::value, "");
+
+namespace {
+    std::string make_text(std::size_t n, picorange_test::rng& r)
+    {
+        std::string s;
+        for (std::size_t i = 0; i < n; ++i) {
+            const auto k = r() % 20;
+            s += k < 8 ? "  \t\r\n,;\xff"[k]
+                       : static_cast<char>(k == 8 ? 0x80 : r() % 256);
+        }
+        return s;
+    }
+
+    void check_copy_n()
+    {
+        int a[4] = {1, 2, 3, 4};
+        int b[4] = {};
+        // Nothing is copied for n <= 0
+        auto r = pr::copy_n(a + 1, -1, b + 1);
+        PICORANGE_CHECK(r.in == a + 1 && r.out == b + 1);
+        PICORANGE_CHECK(std::count(b, b + 4, 0) == 4);
+        r = pr::copy_n(a, 0, b);
+        PICORANGE_CHECK(r.in == a && r.out == b);
+
+        std::vector<int> v;
+        pr::copy_n(a, -5, std::back_inserter(v));
+        PICORANGE_CHECK(v.empty());
+        std::list<int> l(a, a + 4);
+        auto lr = pr::copy_n(l.begin(), -2, std::back_inserter(v));
+        PICORANGE_CHECK(v.empty() && lr.in == l.begin());
+
+        r = pr::copy_n(a, 3, b);
+        PICORANGE_CHECK(r.in == a + 3 && r.out == b + 3);
+        PICORANGE_CHECK(std::equal(a, a + 3, b) && b[3] == 0);
+        pr::copy_n(l.begin(), 4, std::back_inserter(v));
+        PICORANGE_CHECK(std::equal(v.begin(), v.end(), a) && v.size() == 4);
+    }
+
+    void check_copy()
+    {
+        picorange_test::rng r{5};
+        for (std::size_t n : {0, 1, 15, 100, 5000}) {
+            const auto s = make_text(n, r);
+            // Contiguous, segmented and neither
+            std::string out(n, '\0');
+            PICORANGE_CHECK(pr::copy(s, out.begin()).out == out.end());
+            PICORANGE_CHECK(out == s);
+            std::deque<char> d(n);
+            PICORANGE_CHECK(pr::copy(s, d.begin()).out == d.end());
+            PICORANGE_CHECK(std::equal(d.begin(), d.end(), s.begin()));
+            std::string back(n, '\0');
+            PICORANGE_CHECK(pr::copy(d, back.begin()).out == back.end());
+            PICORANGE_CHECK(back == s);
+            std::list<char> l(n);
+            pr::copy(d, l.begin());
+            PICORANGE_CHECK(std::equal(l.begin(), l.end(), s.begin()));
+        }
+
+        // Short copies to a back_insert_iterator keep the geometric growth
+        const std::vector<int> a{1, 2, 3};
+        const std::deque<int> d(700, 4);
+        std::vector<int> v;
+        std::size_t reallocations = 0;
+        for (int i = 0; i < 10000; ++i) {
+            const auto capacity = v.capacity();
+            if (i % 2 == 0) {
+                pr::copy(a, std::back_inserter(v));
+            }
+            else {
+                pr::copy_n(d.begin(), 5, std::back_inserter(v));
+            }
+            reallocations += v.capacity() != capacity;
+        }
+        PICORANGE_CHECK(v.size() == 40000 && reallocations < 64);
+        PICORANGE_CHECK(v[0] == 1 && v[3] == 4 && v[39999] == 4);
+        pr::copy(d, std::back_inserter(v));
+        PICORANGE_CHECK(v.size() == 40700 && v.back() == 4);
+    }
+
+    void check_find_and_count()
+    {
+        picorange_test::rng r{7};
+        const pr::char_set ws{" \t\r\n"};
+        const pr::char_set delims{",;\"\xff\x80"};
+        for (std::size_t n : {0, 1, 31, 64, 1000, 10000}) {
+            const auto s = make_text(n, r);
+            const std::deque<char> d(s.begin(), s.end());
+            const std::list<char> l(s.begin(), s.end());
+
+            const auto nl = std::find(s.begin(), s.end(), '\n') - s.begin();
+            PICORANGE_CHECK(pr::find(s, '\n') - s.begin() == nl);
+            PICORANGE_CHECK(pr::find(d, '\n') - d.begin() == nl);
+            PICORANGE_CHECK(std::distance(l.begin(), pr::find(l, '\n')) ==
+                            nl);
+
+            const auto spaces = std::count(s.begin(), s.end(), ' ');
+            PICORANGE_CHECK(pr::count(s, ' ') == spaces);
+            PICORANGE_CHECK(pr::count(d, ' ') == spaces);
+            PICORANGE_CHECK(pr::count(l, ' ') == spaces);
+
+            const auto delim =
+                std::find_if(s.begin(), s.end(),
+                             [&](char c) { return delims.contains(c); }) -
+                s.begin();
+            PICORANGE_CHECK(pr::find_first_of(s, delims) - s.begin() ==
+                            delim);
+            PICORANGE_CHECK(pr::find_first_of(d, delims) - d.begin() ==
+                            delim);
+            PICORANGE_CHECK(std::distance(l.begin(),
+                                          pr::find_first_of(l, delims)) ==
+                            delim);
+
+            const auto word =
+                std::find_if(s.begin(), s.end(),
+                             [&](char c) { return !ws.contains(c); }) -
+                s.begin();
+            PICORANGE_CHECK(pr::find_first_not_of(s, ws) - s.begin() == word);
+            PICORANGE_CHECK(pr::skip_while_in(s, ws).begin() - s.begin() ==
+                            word);
+
+            const auto h = pr::byte_histogram(d);
+            PICORANGE_CHECK(h[static_cast<unsigned char>(' ')] ==
+                            static_cast<std::size_t>(spaces));
+        }
+    }
+
+    void check_is_valid_utf8()
+    {
+        const std::string valid = "a\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80";
+        PICORANGE_CHECK(pr::is_valid_utf8(valid));
+        const std::string truncated = valid.substr(0, valid.size() - 1);
+        PICORANGE_CHECK(!pr::is_valid_utf8(truncated));
+        const std::string surrogate = "\xed\xa0\x80";
+        PICORANGE_CHECK(!pr::is_valid_utf8(surrogate));
+        const std::vector<unsigned char> u(valid.begin(), valid.end());
+        PICORANGE_CHECK(pr::is_valid_utf8(u));
+    }
+}  // namespace
+
+int main()
+{
+    check_copy_n();
+    check_copy();
+    check_find_and_count();
+    check_is_valid_utf8();
+    return picorange_test::result();
+}
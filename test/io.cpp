@@ -0,0 +1,230 @@
+// Copyright 2017-2019 Elias Kosunen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// This file is a part of picorange:
+//     https://github.com/eliaskosunen/picorange
+
+#include "test.h"
+
+#include <picorange/io.h>
+#include <picorange/parallel.h>
+#include <picorange/views.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace pr = picorange;
+namespace views = picorange::views;
+
+namespace {
+    struct pipe_fds {
+        int read;
+        int write;
+    };
+
+    pipe_fds make_pipe()
+    {
+        int fds[2] = {-1, -1};
+        if (::pipe(fds) != 0) {
+            std::abort();
+        }
+        return {fds[0], fds[1]};
+    }
+
+    void write_all(int fd, const std::string& s, std::size_t step)
+    {
+        std::size_t off = 0;
+        while (off < s.size()) {
+            const auto n = ::write(fd, s.data() + off,
+                                   std::min(step, s.size() - off));
+            if (n <= 0) {
+                std::abort();
+            }
+            off += static_cast<std::size_t>(n);
+        }
+    }
+
+    std::string make_text(std::size_t n)
+    {
+        std::string s;
+        for (std::size_t i = 0; i < n; ++i) {
+            s += i % 10 == 9 ? '\n' : i % 10 == 8 ? '\r'
+                                  : static_cast<char>('a' + i % 26);
+        }
+        return s;
+    }
+
+    void check_fd_input_range()
+    {
+        const auto text = make_text(10000);
+        for (std::size_t buffer_size : {1, 7, 4096}) {
+            const auto p = make_pipe();
+            std::thread writer{[&] {
+                write_all(p.write, text, 100);
+                ::close(p.write);
+            }};
+            pr::fd_input_range in{p.read, buffer_size};
+            std::string got;
+            for (auto it = in.begin(); it != in.end(); ++it) {
+                got += *it;
+            }
+            writer.join();
+            ::close(p.read);
+            PICORANGE_CHECK(got == text && in.eof() && !in.error());
+        }
+    }
+
+    // Reading the last char available doesn't wait for more: a test that
+    // fails hangs, until alarm() ends it
+    void check_lazy_refill()
+    {
+        {
+            const auto p = make_pipe();
+            write_all(p.write, "ab", 2);
+            pr::fd_input_range in{p.read, 16};
+            auto it = in.begin();
+            PICORANGE_CHECK(*it == 'a');
+            ++it;
+            PICORANGE_CHECK(*it == 'b');
+            ++it;
+            write_all(p.write, "cd", 2);
+            ::close(p.write);
+            std::string rest;
+            for (; it != in.end(); ++it) {
+                rest += *it;
+            }
+            PICORANGE_CHECK(rest == "cd");
+            ::close(p.read);
+        }
+        {
+            const auto p = make_pipe();
+            write_all(p.write, "ab", 2);
+            pr::fd_input_range in{p.read, 16};
+            pr::any_input_view<char> v{in};
+            auto it = v.begin();
+            PICORANGE_CHECK(*it == 'a');
+            ++it;
+            PICORANGE_CHECK(*it == 'b');
+            ++it;
+            write_all(p.write, "cd", 2);
+            ::close(p.write);
+            std::string rest;
+            for (; it != v.end(); ++it) {
+                rest += *it;
+            }
+            PICORANGE_CHECK(rest == "cd");
+            ::close(p.read);
+        }
+        {
+            const auto p = make_pipe();
+            write_all(p.write, "ab", 2);
+            pr::fd_input_range in{p.read, 16};
+            pr::pipeline_stage_options opt;
+            opt.batch_size = 1;
+            auto stage = in | views::pipeline_stage(opt);
+            auto it = stage.begin();
+            PICORANGE_CHECK(*it == 'a');
+            ++it;
+            PICORANGE_CHECK(*it == 'b');
+            ++it;
+            write_all(p.write, "cd", 2);
+            ::close(p.write);
+            std::string rest;
+            for (; it != stage.end(); ++it) {
+                rest += *it;
+            }
+            PICORANGE_CHECK(rest == "cd");
+            ::close(p.read);
+        }
+    }
+
+    std::vector<std::string> read_lines(const std::string& text,
+                                        std::size_t buffer_size)
+    {
+        const auto p = make_pipe();
+        std::thread writer{[&] {
+            write_all(p.write, text, 3);
+            ::close(p.write);
+        }};
+        pr::fd_input_range in{p.read, buffer_size};
+        std::vector<std::string> out;
+        auto lines = views::lines(pr::line_terminator::crlf)(in);
+        for (auto it = lines.begin(); it != lines.end(); ++it) {
+            out.emplace_back((*it).begin(), (*it).end());
+        }
+        writer.join();
+        ::close(p.read);
+        return out;
+    }
+
+    void check_lines()
+    {
+        for (std::size_t buffer_size : {1, 2, 16}) {
+            PICORANGE_CHECK((read_lines("ab\r\ncd\n", buffer_size) ==
+                             std::vector<std::string>{"ab", "cd"}));
+            // A '\r' at the end of input is a part of the line
+            PICORANGE_CHECK((read_lines("x\n\r", buffer_size) ==
+                             std::vector<std::string>{"x", "\r"}));
+            PICORANGE_CHECK((read_lines("ab\r", buffer_size) ==
+                             std::vector<std::string>{"ab\r"}));
+        }
+    }
+
+    void check_mapped_file()
+    {
+        char name[] = "/tmp/picorange-test-XXXXXX";
+        const int fd = ::mkstemp(name);
+        if (!PICORANGE_CHECK(fd >= 0)) {
+            return;
+        }
+        ::unlink(name);
+        const auto text = make_text(100000);
+        write_all(fd, text, text.size());
+
+        pr::mapped_file_view whole{fd};
+        PICORANGE_CHECK(!whole.error());
+        PICORANGE_CHECK(std::string(whole.begin(), whole.end()) == text);
+        // Not page-aligned
+        pr::mapped_file_view part{fd, 5000, 123};
+        PICORANGE_CHECK(std::string(part.begin(), part.end()) ==
+                        text.substr(5000, 123));
+
+        pr::mapped_file_window window{fd, 4096};
+        std::string got;
+        while (!window.view().empty()) {
+            const auto& v = window.view();
+            // Leave a part of every window for the next one
+            const auto n = v.size() > 100 ? v.size() - 100 : v.size();
+            got.append(v.begin(), v.begin() + n);
+            window.advance(n);
+        }
+        PICORANGE_CHECK(got == text && !window.error());
+        ::close(fd);
+    }
+}  // namespace
+
+int main()
+{
+    ::alarm(60);
+    check_fd_input_range();
+    check_lazy_refill();
+    check_lines();
+    check_mapped_file();
+    return picorange_test::result();
+}
@@ -0,0 +1,92 @@
+// Copyright 2017-2019 Elias Kosunen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// This file is a part of picorange:
+//     https://github.com/eliaskosunen/picorange
+
+// Only picorange.h, included before the containers: the traits of their
+// iterators mustn't depend on which picorange headers are included
+#include "test.h"
+
+#include <picorange/picorange.h>
+
+#include <deque>
+#include <list>
+#include <string>
+#include <vector>
+
+namespace pr = picorange;
+
+#if !defined(_GLIBCXX_DEBUG)
+static_assert(pr::contiguous_iterator<std::vector<int>::iterator>::value, "");
+static_assert(
+    pr::contiguous_iterator<std::vector<const char*>::const_iterator>::value,
+    "");
+static_assert(pr::contiguous_iterator<std::string::iterator>::value, "");
+static_assert(pr::contiguous_iterator<std::u32string::const_iterator>::value,
+              "");
+#endif
+static_assert(!pr::contiguous_iterator<std::vector<bool>::iterator>::value,
+              "");
+static_assert(!pr::contiguous_iterator<std::deque<int>::iterator>::value, "");
+static_assert(!pr::contiguous_iterator<std::list<int>::iterator>::value, "");
+
+#if defined(__GLIBCXX__) && !defined(_GLIBCXX_DEBUG)
+static_assert(pr::is_segmented_iterator<std::deque<int>::iterator>::value, "");
+static_assert(
+    pr::is_segmented_iterator<std::deque<char>::const_iterator>::value,
+    "");
+#endif
+static_assert(!pr::is_segmented_iterator<std::vector<int>::iterator>::value,
+              "");
+
+namespace {
+    void check_to_address()
+    {
+        std::vector<int> v{1, 2, 3};
+        PICORANGE_CHECK(pr::to_address(v.begin() + 1) == v.data() + 1);
+        std::string s = "abc";
+        PICORANGE_CHECK(pr::to_address(s.cend()) == s.data() + 3);
+    }
+
+    void check_deque_segments()
+    {
+#if defined(__GLIBCXX__) && !defined(_GLIBCXX_DEBUG)
+        using traits = pr::segmented_iterator_traits<std::deque<int>::iterator>;
+        std::deque<int> d;
+        for (int i = 0; i < 1000; ++i) {
+            d.push_front(-i);
+            d.push_back(i);
+        }
+        for (auto it = d.begin(); it != d.end(); ++it) {
+            const auto seg = traits::segment(it);
+            const auto local = traits::local(it);
+            PICORANGE_CHECK(local == &*it);
+            PICORANGE_CHECK(traits::begin(seg) <= local &&
+                            local < traits::end(seg));
+            PICORANGE_CHECK(traits::compose(seg, local) == it);
+            if (local + 1 == traits::end(seg)) {
+                PICORANGE_CHECK(traits::compose(seg, local + 1) == it + 1);
+            }
+        }
+#endif
+    }
+}  // namespace
+
+int main()
+{
+    check_to_address();
+    check_deque_segments();
+    return picorange_test::result();
+}
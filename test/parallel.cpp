@@ -0,0 +1,258 @@
+// Copyright 2017-2019 Elias Kosunen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// This file is a part of picorange:
+//     https://github.com/eliaskosunen/picorange
+
+#include "test.h"
+
+#include <picorange/parallel.h>
+#include <picorange/views.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pr = picorange;
+namespace views = picorange::views;
+
+namespace {
+    // Runs every task on a thread of its own
+    class thread_per_task_executor {
+    public:
+        explicit thread_per_task_executor(std::size_t n) : m_size(n) {}
+        ~thread_per_task_executor()
+        {
+            for (auto& t : m_threads) {
+                t.join();
+            }
+        }
+
+        void post(std::function<void()> task)
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_threads.emplace_back(std::move(task));
+        }
+        std::size_t size() const
+        {
+            return m_size;
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::vector<std::thread> m_threads;
+        std::size_t m_size;
+    };
+
+    struct concat {
+        std::string operator()(std::string a, const std::string& b) const
+        {
+            return a + b;
+        }
+    };
+
+    // The parallel algorithms give the same results as the serial ones,
+    // with chunks of a few elements
+    void check_algorithms(pr::par::executor_ref executor)
+    {
+        picorange_test::rng r{13};
+        for (std::size_t n : {0, 1, 17, 1000, 20000}) {
+            std::vector<std::int64_t> v(n);
+            for (auto& x : v) {
+                x = static_cast<std::int64_t>(r() % 1000);
+            }
+            for (std::size_t grain : {1, 3, 100}) {
+                pr::par::options opt;
+                opt.grain_size = grain;
+                opt.serial_threshold = 0;
+                opt.executor = executor;
+
+                auto w = v;
+                pr::par::for_each(opt, w, [](std::int64_t& x) { x *= 3; });
+                std::vector<std::int64_t> expected(n);
+                std::transform(v.begin(), v.end(), expected.begin(),
+                               [](std::int64_t x) { return x * 3; });
+                PICORANGE_CHECK(w == expected);
+
+                std::vector<std::int64_t> out(n);
+                const auto t = pr::par::transform(
+                    opt, v, out.begin(), [](std::int64_t x) { return x * 3; });
+                PICORANGE_CHECK(t.in == v.end() && t.out == out.end());
+                PICORANGE_CHECK(out == expected);
+
+                const auto sum =
+                    std::accumulate(v.begin(), v.end(), std::int64_t{0});
+                PICORANGE_CHECK(pr::par::reduce(opt, v, std::int64_t{0}) ==
+                                sum);
+                PICORANGE_CHECK(
+                    pr::par::transform_reduce(
+                        opt, v, std::int64_t{0}, std::plus<std::int64_t>{},
+                        [](std::int64_t x) { return x % 7; }) ==
+                    std::accumulate(v.begin(), v.end(), std::int64_t{0},
+                                    [](std::int64_t a, std::int64_t x) {
+                                        return a + x % 7;
+                                    }));
+
+                const auto is_small = [](std::int64_t x) { return x < 10; };
+                PICORANGE_CHECK(pr::par::count_if(opt, v, is_small) ==
+                                std::count_if(v.begin(), v.end(), is_small));
+                PICORANGE_CHECK(pr::par::find_if(opt, v, is_small) ==
+                                std::find_if(v.begin(), v.end(), is_small));
+                const auto is_negative = [](std::int64_t x) { return x < 0; };
+                PICORANGE_CHECK(pr::par::find_if(opt, v, is_negative) ==
+                                v.end());
+            }
+        }
+
+        // The chunks are combined in order
+        std::vector<std::string> letters(3000);
+        for (std::size_t i = 0; i < letters.size(); ++i) {
+            letters[i] = std::string(1, static_cast<char>('a' + i % 26));
+        }
+        pr::par::options opt;
+        opt.grain_size = 1;
+        opt.serial_threshold = 0;
+        opt.executor = executor;
+        PICORANGE_CHECK(pr::par::reduce(opt, letters, std::string{},
+                                        concat{}) ==
+                        std::accumulate(letters.begin(), letters.end(),
+                                        std::string{}));
+
+        // Every element is visited once
+        std::vector<std::atomic<int>> hits(5000);
+        for (auto& h : hits) {
+            h = 0;
+        }
+        pr::par::for_each(opt, hits, [](std::atomic<int>& h) { ++h; });
+        PICORANGE_CHECK(std::all_of(
+            hits.begin(), hits.end(),
+            [](const std::atomic<int>& h) { return h == 1; }));
+
+        // An exception from a chunk is rethrown
+        std::vector<int> ints(5000);
+        std::iota(ints.begin(), ints.end(), 0);
+        bool thrown = false;
+        try {
+            pr::par::for_each(opt, ints, [](int x) {
+                if (x == 4000) {
+                    throw std::runtime_error{"for_each"};
+                }
+            });
+        }
+        catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        PICORANGE_CHECK(thrown);
+    }
+
+    struct throw_at {
+        int n;
+        int operator()(int x) const
+        {
+            if (x == n) {
+                throw std::runtime_error{"pipeline_stage"};
+            }
+            return x;
+        }
+    };
+
+    void check_pipeline_stage()
+    {
+        std::vector<int> v(10000);
+        std::iota(v.begin(), v.end(), 0);
+
+        pr::pipeline_stage_options small;
+        small.batch_size = 7;
+        small.queue_size = 2;
+        {
+            auto stage = v | views::transform([](int x) { return x * 2; }) |
+                         views::pipeline_stage(small);
+            std::vector<int> got;
+            for (auto it = stage.begin(); it != stage.end(); ++it) {
+                got.push_back(*it);
+            }
+            PICORANGE_CHECK(got.size() == v.size());
+            for (std::size_t i = 0; i < got.size(); ++i) {
+                PICORANGE_CHECK(got[i] == 2 * v[i]);
+            }
+        }
+
+        // The elements before an exception are seen, then it's rethrown,
+        // at every position within a batch
+        for (int at : {0, 1, 6, 7, 5000, 9999}) {
+            auto stage = v | views::transform(throw_at{at}) |
+                         views::pipeline_stage(small);
+            int n = 0;
+            bool thrown = false;
+            try {
+                for (auto it = stage.begin(); it != stage.end(); ++it) {
+                    PICORANGE_CHECK(*it == n);
+                    ++n;
+                }
+            }
+            catch (const std::runtime_error&) {
+                thrown = true;
+            }
+            PICORANGE_CHECK(thrown && n == at);
+        }
+
+        // chunk() and consume(), moving the elements out
+        {
+            std::vector<std::string> strs(1000, std::string(40, 'x'));
+            auto stage = strs | views::pipeline_stage(small);
+            std::size_t total = 0;
+            for (auto c = stage.chunk(); !c.empty(); c = stage.chunk()) {
+                for (auto& s : c) {
+                    const std::string moved = std::move(s);
+                    total += moved.size();
+                }
+                stage.consume(c.size());
+            }
+            PICORANGE_CHECK(total == 40000);
+        }
+
+        // Destroyed while the producer waits for room in the queue, and
+        // without being started
+        {
+            auto stage = v | views::pipeline_stage(small);
+            PICORANGE_CHECK(*stage.begin() == 0);
+        }
+        {
+            auto stage = v | views::pipeline_stage;
+            (void)stage;
+        }
+
+        std::vector<int> empty;
+        auto stage = empty | views::pipeline_stage;
+        PICORANGE_CHECK(stage.begin() == stage.end());
+    }
+}  // namespace
+
+int main()
+{
+    pr::par::thread_pool pool{3};
+    check_algorithms(pool);
+    thread_per_task_executor per_task{4};
+    check_algorithms(per_task);
+    check_algorithms(pr::par::executor_ref{});
+    check_pipeline_stage();
+    return picorange_test::result();
+}
@@ -0,0 +1,437 @@
+// Copyright 2017-2019 Elias Kosunen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// This file is a part of picorange:
+//     https://github.com/eliaskosunen/picorange
+
+// The SIMD kernels in simd.h, checked against scalar references in windows
+// at every offset within a 64-byte block, and of every length up to a few
+// vectors, so that every alignment and tail length is covered. Kernels for
+// instruction sets the CPU doesn't have are skipped.
+
+#include "test.h"
+
+#include <picorange/simd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace simd = picorange::detail::simd;
+using simd::byte;
+
+namespace {
+    constexpr std::size_t max_offset = 64;
+    constexpr std::size_t max_length = 160;
+    constexpr std::size_t buffer_size = max_offset + max_length;
+
+    struct buffer {
+        alignas(64) byte data[buffer_size];
+    };
+
+#if PICORANGE_HAS_SSSE3 || PICORANGE_SIMD_RUNTIME_DISPATCH
+    bool has_ssse3()
+    {
+        return simd::get_cpu_features().ssse3;
+    }
+#endif
+#if PICORANGE_HAS_AVX2 || PICORANGE_SIMD_RUNTIME_DISPATCH
+    bool has_avx2()
+    {
+        return simd::get_cpu_features().avx2;
+    }
+#endif
+
+    // Bytes of alphabet, or every byte but 0, if it's empty
+    void fill(buffer& b, const std::string& alphabet, picorange_test::rng& r)
+    {
+        for (auto& c : b.data) {
+            c = alphabet.empty()
+                    ? static_cast<byte>(1 + r() % 255)
+                    : static_cast<byte>(alphabet[r() % alphabet.size()]);
+        }
+    }
+
+    template <typename F>
+    void for_each_window(const buffer& b, F f)
+    {
+        for (std::size_t off = 0; off < max_offset; ++off) {
+            for (std::size_t n = 0; n <= max_length; ++n) {
+                f(b.data + off, b.data + off + n);
+            }
+        }
+    }
+
+    void check_find_byte(const buffer& b)
+    {
+        for_each_window(b, [](const byte* first, const byte* last) {
+            // The last byte of the window is found at its first occurrence,
+            // 0 isn't found at all
+            const byte values[] = {first == last ? byte{'a'} : last[-1], 0};
+            for (const byte v : values) {
+                const auto expected = std::find(first, last, v);
+                PICORANGE_CHECK(simd::find_byte_scalar(first, last, v) ==
+                                expected);
+#if PICORANGE_HAS_SSE2
+                PICORANGE_CHECK(simd::find_byte_sse2(first, last, v) ==
+                                expected);
+#endif
+#if PICORANGE_HAS_AVX2 || PICORANGE_SIMD_RUNTIME_DISPATCH
+                if (has_avx2()) {
+                    PICORANGE_CHECK(simd::find_byte_avx2(first, last, v) ==
+                                    expected);
+                }
+#endif
+                PICORANGE_CHECK(simd::find_byte(first, last, v) == expected);
+            }
+        });
+    }
+
+    void check_mismatch_bytes(const buffer& b)
+    {
+        buffer other = b;
+        for_each_window(b, [&](const byte* first, const byte* last) {
+            const auto n = static_cast<std::size_t>(last - first);
+            byte* const copy = other.data + (first - b.data);
+            // No difference, and one at the beginning, the middle and the
+            // end
+            const std::size_t positions[] = {n, 0, n / 2, n - 1};
+            for (const auto pos : positions) {
+                if (pos >= n && pos != n) {
+                    continue;
+                }
+                if (pos != n) {
+                    copy[pos] = static_cast<byte>(~copy[pos]);
+                }
+                const auto expected = static_cast<std::size_t>(
+                    std::mismatch(first, last, copy).first - first);
+                PICORANGE_CHECK(simd::mismatch_bytes_scalar(first, copy, n) ==
+                                expected);
+#if PICORANGE_HAS_SSE2
+                PICORANGE_CHECK(simd::mismatch_bytes_sse2(first, copy, n) ==
+                                expected);
+#endif
+#if PICORANGE_HAS_AVX2 || PICORANGE_SIMD_RUNTIME_DISPATCH
+                if (has_avx2()) {
+                    PICORANGE_CHECK(simd::mismatch_bytes_avx2(
+                                        first, copy, n) == expected);
+                }
+#endif
+                PICORANGE_CHECK(simd::mismatch_bytes(first, copy, n) ==
+                                expected);
+                if (pos != n) {
+                    copy[pos] = static_cast<byte>(~copy[pos]);
+                }
+            }
+        });
+    }
+
+    void check_find_bytes(const buffer& b)
+    {
+        for_each_window(b, [&](const byte* first, const byte* last) {
+            const std::size_t lengths[] = {2, 3, 5, 17, 33};
+            for (const auto k : lengths) {
+                // The end of the window, which is found at least there,
+                // and the beginning of the buffer, which may not be
+                const byte* const needles[] = {
+                    static_cast<std::size_t>(last - first) >= k ? last - k
+                                                                : b.data,
+                    b.data};
+                for (const auto needle : needles) {
+                    const auto expected =
+                        std::search(first, last, needle, needle + k);
+                    PICORANGE_CHECK(simd::find_bytes_scalar(
+                                        first, last, needle, k) == expected);
+#if PICORANGE_HAS_SSE2
+                    PICORANGE_CHECK(simd::find_bytes_sse2(
+                                        first, last, needle, k) == expected);
+#endif
+#if PICORANGE_HAS_AVX2 || PICORANGE_SIMD_RUNTIME_DISPATCH
+                    if (has_avx2()) {
+                        PICORANGE_CHECK(simd::find_bytes_avx2(first, last,
+                                                              needle, k) ==
+                                        expected);
+                    }
+#endif
+                    PICORANGE_CHECK(simd::find_bytes(first, last, needle,
+                                                     k) == expected);
+                }
+            }
+        });
+    }
+
+    std::vector<simd::byte_set> make_sets()
+    {
+        std::vector<simd::byte_set> sets;
+        // Empty, one byte, and bytes from both halves of the nibble table
+        sets.push_back(simd::byte_set{});
+        simd::byte_set one{};
+        one.insert('a');
+        sets.push_back(one);
+        simd::byte_set mixed{};
+        for (const byte c : {byte{'\n'}, byte{'c'}, byte{0x80}, byte{0xff}}) {
+            mixed.insert(c);
+        }
+        sets.push_back(mixed);
+        // Everything but 'a'
+        simd::byte_set most{};
+        for (unsigned c = 0; c < 256; ++c) {
+            if (c != 'a') {
+                most.insert(static_cast<byte>(c));
+            }
+        }
+        sets.push_back(most);
+        return sets;
+    }
+
+    void check_find_in_set(const buffer& b)
+    {
+        const auto sets = make_sets();
+        for_each_window(b, [&](const byte* first, const byte* last) {
+            for (const auto& s : sets) {
+                const auto expected = std::find_if(
+                    first, last, [&](byte c) { return s.contains(c); });
+                PICORANGE_CHECK(simd::find_in_set_scalar(first, last, s) ==
+                                expected);
+#if PICORANGE_HAS_SSSE3 || PICORANGE_SIMD_RUNTIME_DISPATCH
+                if (has_ssse3()) {
+                    PICORANGE_CHECK(simd::find_in_set_ssse3(first, last, s) ==
+                                    expected);
+                }
+#endif
+#if PICORANGE_HAS_AVX2 || PICORANGE_SIMD_RUNTIME_DISPATCH
+                if (has_avx2()) {
+                    PICORANGE_CHECK(simd::find_in_set_avx2(first, last, s) ==
+                                    expected);
+                }
+#endif
+                PICORANGE_CHECK(simd::find_in_set(first, last, s) ==
+                                expected);
+            }
+        });
+    }
+
+    void check_count(const buffer& b)
+    {
+        const auto sets = make_sets();
+        for_each_window(b, [&](const byte* first, const byte* last) {
+            for (const byte v : {byte{'a'}, byte{0xff}}) {
+                const auto expected =
+                    static_cast<std::size_t>(std::count(first, last, v));
+                PICORANGE_CHECK(simd::count_byte_scalar(first, last, v) ==
+                                expected);
+#if PICORANGE_HAS_SSE2
+                PICORANGE_CHECK(simd::count_byte_sse2(first, last, v) ==
+                                expected);
+#endif
+#if PICORANGE_HAS_AVX2 || PICORANGE_SIMD_RUNTIME_DISPATCH
+                if (has_avx2()) {
+                    PICORANGE_CHECK(simd::count_byte_avx2(first, last, v) ==
+                                    expected);
+                }
+#endif
+                PICORANGE_CHECK(simd::count_byte(first, last, v) == expected);
+            }
+            for (const auto& s : sets) {
+                const auto expected = static_cast<std::size_t>(std::count_if(
+                    first, last, [&](byte c) { return s.contains(c); }));
+                PICORANGE_CHECK(simd::count_in_set_scalar(first, last, s) ==
+                                expected);
+#if PICORANGE_HAS_SSSE3 || PICORANGE_SIMD_RUNTIME_DISPATCH
+                if (has_ssse3()) {
+                    PICORANGE_CHECK(simd::count_in_set_ssse3(first, last,
+                                                             s) == expected);
+                }
+#endif
+#if PICORANGE_HAS_AVX2 || PICORANGE_SIMD_RUNTIME_DISPATCH
+                if (has_avx2()) {
+                    PICORANGE_CHECK(simd::count_in_set_avx2(first, last, s) ==
+                                    expected);
+                }
+#endif
+                PICORANGE_CHECK(simd::count_in_set(first, last, s) ==
+                                expected);
+            }
+        });
+    }
+
+    void check_byte_histogram(const buffer& b)
+    {
+        for_each_window(b, [](const byte* first, const byte* last) {
+            std::size_t expected[256] = {};
+            for (auto p = first; p != last; ++p) {
+                ++expected[*p];
+            }
+            std::size_t counts[256] = {};
+            simd::byte_histogram(first, last, counts);
+            PICORANGE_CHECK(std::equal(counts, counts + 256, expected));
+        });
+    }
+
+    void check_count_utf8_code_points(const buffer& b)
+    {
+        for_each_window(b, [](const byte* first, const byte* last) {
+            const auto expected = static_cast<std::size_t>(
+                std::count_if(first, last, [](byte c) {
+                    return (c & 0xc0) != 0x80;
+                }));
+            PICORANGE_CHECK(simd::count_utf8_code_points_scalar(
+                                first, last) == expected);
+#if PICORANGE_HAS_SSE2
+            PICORANGE_CHECK(simd::count_utf8_code_points_sse2(first, last) ==
+                            expected);
+#endif
+#if PICORANGE_HAS_AVX2 || PICORANGE_SIMD_RUNTIME_DISPATCH
+            if (has_avx2()) {
+                PICORANGE_CHECK(simd::count_utf8_code_points_avx2(
+                                    first, last) == expected);
+            }
+#endif
+            PICORANGE_CHECK(simd::count_utf8_code_points(first, last) ==
+                            expected);
+        });
+    }
+
+    // Decodes every code point, unlike the kernels
+    bool is_valid_utf8(const byte* first, const byte* last)
+    {
+        static const std::uint32_t min_code_point[] = {0, 0x80, 0x800,
+                                                       0x10000};
+        while (first != last) {
+            const byte c = *first;
+            std::size_t n = 0;
+            std::uint32_t cp = 0;
+            if (c < 0x80) {
+                ++first;
+                continue;
+            }
+            if ((c & 0xe0) == 0xc0) {
+                n = 1;
+                cp = c & 0x1fu;
+            }
+            else if ((c & 0xf0) == 0xe0) {
+                n = 2;
+                cp = c & 0x0fu;
+            }
+            else if ((c & 0xf8) == 0xf0) {
+                n = 3;
+                cp = c & 0x07u;
+            }
+            else {
+                return false;
+            }
+            if (static_cast<std::size_t>(last - first) <= n) {
+                return false;
+            }
+            for (std::size_t i = 1; i <= n; ++i) {
+                if ((first[i] & 0xc0) != 0x80) {
+                    return false;
+                }
+                cp = (cp << 6) | (first[i] & 0x3fu);
+            }
+            if (cp < min_code_point[n] || cp > 0x10ffff ||
+                (cp >= 0xd800 && cp <= 0xdfff)) {
+                return false;
+            }
+            first += n + 1;
+        }
+        return true;
+    }
+
+    bool validate_utf8_kernels(const byte* first,
+                               const byte* last,
+                               bool expected)
+    {
+        bool ok = PICORANGE_CHECK(simd::validate_utf8_scalar(first, last) ==
+                                  expected);
+#if PICORANGE_HAS_SSSE3 || PICORANGE_SIMD_RUNTIME_DISPATCH
+        if (has_ssse3()) {
+            ok &= PICORANGE_CHECK(simd::validate_utf8_ssse3(first, last) ==
+                                  expected);
+        }
+#endif
+#if PICORANGE_HAS_AVX2 || PICORANGE_SIMD_RUNTIME_DISPATCH
+        if (has_avx2()) {
+            ok &= PICORANGE_CHECK(simd::validate_utf8_avx2(first, last) ==
+                                  expected);
+        }
+#endif
+        ok &= PICORANGE_CHECK(simd::validate_utf8(first, last) == expected);
+        return ok;
+    }
+
+    // Text of whole code points, valid or not, copied to every offset
+    void check_validate_utf8()
+    {
+        static const char* const valid[] = {
+            "a", "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80",
+            // The ends of the ranges, around the surrogates
+            "\x7f", "\xc2\x80", "\xdf\xbf", "\xe0\xa0\x80", "\xed\x9f\xbf",
+            "\xee\x80\x80", "\xef\xbf\xbf", "\xf0\x90\x80\x80",
+            "\xf4\x8f\xbf\xbf"};
+        static const char* const invalid[] = {
+            // Stray continuation, overlong, surrogate, out of range,
+            // truncated, and bytes that are never valid
+            "\x80", "\xc0\xaf", "\xe0\x80\xaf", "\xed\xa0\x80",
+            "\xf4\x90\x80\x80", "\xe2\x82", "\xf0\x9f\x98", "\xf8", "\xff"};
+        picorange_test::rng r{3};
+        buffer b{};
+        for (std::size_t off = 0; off < max_offset; ++off) {
+            for (std::size_t n = 0; n <= max_length; ++n) {
+                // Mostly ASCII half of the time, for the ASCII fast path
+                const bool ascii = r() % 2 == 0;
+                std::string text;
+                while (text.size() < n) {
+                    const auto k = r() % 16;
+                    text += ascii && k < 14 ? valid[0]
+                                            : valid[k % (sizeof(valid) /
+                                                         sizeof(*valid))];
+                }
+                // Invalid at a random position, half of the time
+                if (r() % 2 == 0 && !text.empty()) {
+                    const auto pos = r() % text.size();
+                    text.insert(pos, invalid[r() % (sizeof(invalid) /
+                                                    sizeof(*invalid))]);
+                }
+                text.resize(std::min(text.size(), max_length));
+                std::memcpy(b.data + off, text.data(), text.size());
+                const byte* const first = b.data + off;
+                const byte* const last = first + text.size();
+                validate_utf8_kernels(first, last,
+                                      is_valid_utf8(first, last));
+            }
+        }
+    }
+}  // namespace
+
+int main()
+{
+    picorange_test::rng r{1};
+    buffer b{};
+    // Few distinct bytes, so that there are matches everywhere, and all of
+    // them, so that there are long runs without one
+    for (const std::string alphabet : {"abc\xff", ""}) {
+        fill(b, alphabet, r);
+        check_find_byte(b);
+        check_mismatch_bytes(b);
+        check_find_bytes(b);
+        check_find_in_set(b);
+        check_count(b);
+        check_byte_histogram(b);
+        check_count_utf8_code_points(b);
+    }
+    check_validate_utf8();
+    return picorange_test::result();
+}
@@ -0,0 +1,77 @@
+// Copyright 2017-2019 Elias Kosunen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// This file is a part of picorange:
+//     https://github.com/eliaskosunen/picorange
+
+// Minimal checks shared by the tests. Unlike assert, they aren't disabled
+// by NDEBUG, and a failed check doesn't stop the test.
+
+#ifndef PICORANGE_TEST_H
+#define PICORANGE_TEST_H
+
+#include <cstdint>
+#include <cstdio>
+
+#define PICORANGE_CHECK(...)                                              \
+    ::picorange_test::check(static_cast<bool>(__VA_ARGS__), #__VA_ARGS__, \
+                            __FILE__, __LINE__)
+
+namespace picorange_test {
+    inline int& failures()
+    {
+        static int n = 0;
+        return n;
+    }
+
+    inline bool check(bool ok, const char* expr, const char* file, int line)
+    {
+        if (!ok) {
+            // Only the first ones, a loop can fail a lot of times
+            if (failures() < 20) {
+                std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line,
+                             expr);
+            }
+            ++failures();
+        }
+        return ok;
+    }
+
+    // The exit status of a test
+    inline int result()
+    {
+        if (failures() != 0) {
+            std::fprintf(stderr, "%d checks failed\n", failures());
+            return 1;
+        }
+        return 0;
+    }
+
+    // Deterministic pseudo-random numbers, the same on every platform
+    class rng {
+    public:
+        explicit rng(std::uint32_t seed) : m_state(seed) {}
+
+        std::uint32_t operator()()
+        {
+            m_state = m_state * 1103515245u + 12345u;
+            return m_state >> 8;
+        }
+
+    private:
+        std::uint32_t m_state;
+    };
+}  // namespace picorange_test
+
+#endif  // PICORANGE_TEST_H
@@ -0,0 +1,265 @@
+// Copyright 2017-2019 Elias Kosunen
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// This file is a part of picorange:
+//     https://github.com/eliaskosunen/picorange
+
+#include "test.h"
+
+#include <picorange/views.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <list>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pr = picorange;
+namespace views = picorange::views;
+
+namespace {
+    using strings = std::vector<std::string>;
+
+    template <typename V>
+    strings collect_lines(V&& v)
+    {
+        strings out;
+        for (auto it = v.begin(); it != v.end(); ++it) {
+            const auto line = *it;
+            out.emplace_back(line.begin(), line.end());
+        }
+        return out;
+    }
+
+    template <typename V>
+    std::string collect(V& v)
+    {
+        std::string out;
+        for (auto it = v.begin(); it != v.end(); ++it) {
+            out += static_cast<char>(*it);
+        }
+        return out;
+    }
+
+    // A chunked source over a string, a few chars at a time
+    struct string_source {
+        std::string text;
+        std::size_t chunk_size;
+        std::size_t pos;
+
+        pr::subrange<const char*> chunk()
+        {
+            const auto n = std::min(chunk_size, text.size() - pos);
+            return {text.data() + pos, text.data() + pos + n};
+        }
+        void consume(std::size_t n)
+        {
+            pos += n;
+        }
+    };
+
+    // The lines of text, both from the contiguous and the chunked view
+    strings lines(const std::string& text, pr::line_terminator t)
+    {
+        const auto expected = collect_lines(views::lines(t)(text));
+        for (std::size_t k : {1, 2, 3, 64}) {
+            string_source source{text, k, 0};
+            PICORANGE_CHECK(collect_lines(views::lines(t)(source)) ==
+                            expected);
+        }
+        return expected;
+    }
+
+    void check_lines()
+    {
+        using pr::line_terminator;
+        PICORANGE_CHECK(lines("", line_terminator::lf).empty());
+        PICORANGE_CHECK(lines("\n", line_terminator::lf) == strings{""});
+        PICORANGE_CHECK((lines("ab\ncd\r\n\nlast", line_terminator::lf) ==
+                         strings{"ab", "cd\r", "", "last"}));
+        PICORANGE_CHECK((lines("ab\ncd\r\n\nlast", line_terminator::crlf) ==
+                         strings{"ab", "cd", "", "last"}));
+        // A '\r' without a '\n' after it is a part of the line
+        PICORANGE_CHECK((lines("x\n\r", line_terminator::crlf) ==
+                         strings{"x", "\r"}));
+        PICORANGE_CHECK((lines("ab\r", line_terminator::crlf) ==
+                         strings{"ab\r"}));
+        PICORANGE_CHECK((lines("ab\r\n", line_terminator::crlf) ==
+                         strings{"ab"}));
+        PICORANGE_CHECK((lines("\r\r\n\r", line_terminator::crlf) ==
+                         strings{"\r", "\r"}));
+
+        // Long lines, straddling chunks
+        picorange_test::rng r{11};
+        std::string text;
+        for (int i = 0; i < 2000; ++i) {
+            const auto k = r() % 10;
+            text += k == 0 ? '\n' : k == 1 ? '\r' : static_cast<char>('a' + k);
+        }
+        for (auto t : {line_terminator::lf, line_terminator::crlf}) {
+            strings expected;
+            std::string line;
+            for (char c : text) {
+                if (c != '\n') {
+                    line += c;
+                    continue;
+                }
+                if (t == line_terminator::crlf && !line.empty() &&
+                    line.back() == '\r') {
+                    line.pop_back();
+                }
+                expected.push_back(line);
+                line.clear();
+            }
+            expected.push_back(line);
+            PICORANGE_CHECK(lines(text, t) == expected);
+        }
+    }
+
+    void check_utf8()
+    {
+        const std::string text = "a\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80";
+        auto v = views::utf8(text);
+        std::vector<char32_t> cps;
+        for (auto it = v.begin(); it != v.end(); ++it) {
+            cps.push_back(*it);
+        }
+        PICORANGE_CHECK((cps == std::vector<char32_t>{U'a', 0xe9, 0x20ac,
+                                                      0x1f600}));
+        PICORANGE_CHECK(pr::distance(v) == 4);
+
+        // Every byte that isn't a continuation byte starts an element, so
+        // stray continuation bytes make the one before them U+FFFD
+        const std::string invalid = "a\x80\x80z\xff";
+        auto w = views::utf8(invalid);
+        cps.clear();
+        for (auto it = w.begin(); it != w.end(); ++it) {
+            cps.push_back(*it);
+        }
+        PICORANGE_CHECK((cps == std::vector<char32_t>{0xfffd, U'z', 0xfffd}));
+        PICORANGE_CHECK(pr::distance(w) == 3);
+    }
+
+    void check_any_input_view()
+    {
+        for (std::size_t n : {0, 1, 1023, 1024, 1025, 5000}) {
+            std::string s;
+            for (std::size_t i = 0; i < n; ++i) {
+                s += static_cast<char>('a' + i % 26);
+            }
+            const std::list<char> l(s.begin(), s.end());
+            const std::deque<char> d(s.begin(), s.end());
+            pr::any_input_view<char> vs(s);
+            PICORANGE_CHECK(collect(vs) == s);
+            pr::any_input_view<char> vl(l);
+            PICORANGE_CHECK(collect(vl) == s);
+            pr::any_input_view<char> vd(d);
+            PICORANGE_CHECK(collect(vd) == s);
+
+            // Batches
+            pr::any_input_view<char> v(l);
+            std::string got;
+            for (auto c = v.chunk(); !c.empty(); c = v.chunk()) {
+                got.append(c.begin(), c.end());
+                v.consume(c.size());
+            }
+            PICORANGE_CHECK(got == s);
+        }
+    }
+
+    void check_any_forward_view()
+    {
+        const pr::any_forward_view<int> none{};
+        PICORANGE_CHECK(none.empty() && none.begin() == none.end());
+        PICORANGE_CHECK(pr::distance(none) == 0);
+
+        std::list<int> l;
+        for (int i = 0; i < 3000; ++i) {
+            l.push_back(i);
+        }
+        pr::any_forward_view<int> v(l);
+        PICORANGE_CHECK(pr::distance(v) == 3000);
+
+        // References stay valid after the iterator is incremented
+        auto it = v.begin();
+        std::vector<const int*> refs;
+        for (int i = 0; i < 3000; ++i) {
+            const int& r = *it++;
+            refs.push_back(&r);
+        }
+        PICORANGE_CHECK(it == v.end());
+        for (int i = 0; i < 3000; ++i) {
+            PICORANGE_CHECK(*refs[static_cast<std::size_t>(i)] == i);
+        }
+
+        // Equal iterators refer to the same element, also across copies of
+        // the view
+        auto a = v.begin();
+        auto b = v.begin();
+        for (int i = 0; i < 2000; ++i, ++a, ++b) {
+            PICORANGE_CHECK(a == b && &*a == &*b);
+        }
+        const auto copy = v;
+        auto c = copy.begin();
+        for (int i = 0; i < 2000; ++i) {
+            ++c;
+        }
+        PICORANGE_CHECK(c == a && &*c == &*a && *c == 2000);
+
+        // Multipass
+        auto d = a;
+        ++a;
+        PICORANGE_CHECK(*d == 2000 && *a == 2001 && !(a == d));
+    }
+
+    void check_zstring_view()
+    {
+        const std::string s(100000, 'x');
+        const pr::zstring_view z{s.c_str()};
+        std::atomic<int> wrong{0};
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i) {
+            threads.emplace_back([&] {
+                if (z.size() != s.size()) {
+                    ++wrong;
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        PICORANGE_CHECK(wrong == 0);
+
+        pr::zstring_view copy = z;
+        PICORANGE_CHECK(copy.size() == s.size() && copy.data() == s.c_str());
+        pr::zstring_view assigned;
+        PICORANGE_CHECK(assigned.empty() && assigned.size() == 0);
+        assigned = pr::zstring_view{"abc"};
+        PICORANGE_CHECK(assigned.size() == 3 &&
+                        std::strcmp(assigned.c_str(), "abc") == 0);
+    }
+}  // namespace
+
+int main()
+{
+    check_lines();
+    check_utf8();
+    check_any_input_view();
+    check_any_forward_view();
+    check_zstring_view();
+    return picorange_test::result();
+}